@@ -129,6 +129,12 @@ class UnityTestRunnerGenerator
                            .map { |line| line.gsub(substring_unre, substring_unsubs) } # unhide the problematic characters previously removed
 
     lines.each_with_index do |line, _index|
+      # find tests registered with UNITY_TEST(name) from extras/register
+      if line =~ /^\s*UNITY_TEST\s*\(\s*(\w+)\s*\)\s*$/
+        tests_and_line_numbers << { test: Regexp.last_match(1), args: nil, call: nil, params: nil, line_number: 0 }
+        next
+      end
+
       # find tests
       next unless line =~ /^((?:\s*(?:TEST_CASE|TEST_RANGE)\s*\(.*?\)\s*)*)\s*void\s+((?:#{@options[:test_prefix]}).*)\s*\(\s*(.*)\s*\)/m
 
@@ -167,7 +173,7 @@ class UnityTestRunnerGenerator
     source_index = 0
     tests_and_line_numbers.size.times do |i|
       source_lines[source_index..-1].each_with_index do |line, index|
-        next unless line =~ /\s+#{tests_and_line_numbers[i][:test]}(?:\s|\()/
+        next unless line =~ /\s+#{tests_and_line_numbers[i][:test]}(?:\s|\()|UNITY_TEST\s*\(\s*#{tests_and_line_numbers[i][:test]}\s*\)/
 
         source_index += index
         tests_and_line_numbers[i][:line_number] = source_index + 1
@@ -406,6 +412,26 @@ class UnityTestRunnerGenerator
     else
       output.puts("  UnityBegin(\"#{filename.gsub(/\\/, '\\\\\\')}\");")
     end
+    if @options[:cmdline_args] && !tests.empty?
+      create_scheduled_tests(output, filename, tests)
+    else
+      create_run_tests(output, tests)
+    end
+    output.puts
+    output.puts('  CMock_Guts_MemFreeFinal();') unless used_mocks.empty?
+    if @options[:has_suite_teardown]
+      if @options[:omit_begin_end]
+        output.puts('  (void) suite_teardown(0);')
+      else
+        output.puts('  return suiteTearDown(UnityEnd());')
+      end
+    else
+      output.puts('  return UnityEnd();') unless @options[:omit_begin_end]
+    end
+    output.puts('}')
+  end
+
+  def create_run_tests(output, tests)
     tests.each do |test|
       if (!@options[:use_param_tests]) || test[:args].nil? || test[:args].empty?
         output.puts("  run_test(#{test[:test]}, \"#{test[:test]}\", #{test[:line_number]});")
@@ -417,18 +443,34 @@ class UnityTestRunnerGenerator
         end
       end
     end
-    output.puts
-    output.puts('  CMock_Guts_MemFreeFinal();') unless used_mocks.empty?
-    if @options[:has_suite_teardown]
-      if @options[:omit_begin_end]
-        output.puts('  (void) suite_teardown(0);')
+  end
+
+  # With command line arguments the tests go in a table, so --shard, --shuffle and --order
+  # can pick and reorder them before they run
+  def create_scheduled_tests(output, filename, tests)
+    group = File.basename(filename, '.*').dump
+    output.puts('  {')
+    output.puts('    UnityTestEntry runner_tests[] = {')
+    tests.each do |test|
+      if (!@options[:use_param_tests]) || test[:args].nil? || test[:args].empty?
+        output.puts("      { #{test[:test]}, #{group}, \"#{test[:test]}\", #{test[:line_number]}, NULL },")
       else
-        output.puts('  return suiteTearDown(UnityEnd());')
+        test[:args].each.with_index(1) do |args, idx|
+          wrapper = "runner_args#{idx}_#{test[:test]}"
+          testname = "#{test[:test]}(#{args})".dump
+          output.puts("      { #{wrapper}, #{group}, #{testname}, #{test[:line_number]}, NULL },")
+        end
       end
-    else
-      output.puts('  return UnityEnd();') unless @options[:omit_begin_end]
     end
-    output.puts('}')
+    output.puts('    };')
+    output.puts('    UNITY_UINT32 runner_count = (UNITY_UINT32)(sizeof(runner_tests) / sizeof(runner_tests[0]));')
+    output.puts('    UNITY_UINT32 i;')
+    output.puts('    runner_count = UnityScheduleTests(runner_tests, runner_count);')
+    output.puts('    for (i = 0; i < runner_count; i++)')
+    output.puts('    {')
+    output.puts('      run_test(runner_tests[i].Func, runner_tests[i].Name, runner_tests[i].Line);')
+    output.puts('    }')
+    output.puts('  }')
   end
 
   def create_h_file(output, filename, tests, testfile_includes, used_mocks)
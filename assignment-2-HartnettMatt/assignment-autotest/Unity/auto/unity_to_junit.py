@@ -79,9 +79,14 @@ class UnityTestSummary:
                                 tmp_tc.add_skipped_info(message=" ")
                         elif str(tmp_tc_line['tc_status']) == 'FAIL':
                             if 'tc_msg' in tmp_tc_line:
+                                # Slowdowns reported against a perf baseline get a type of their own
+                                failure_type = None
+                                if str(tmp_tc_line['tc_msg']).startswith('Slower than baseline'):
+                                    failure_type = 'performance'
                                 tmp_tc.add_failure_info(message=tmp_tc_line['tc_msg'],
                                                         output=r'[File]={0}, [Line]={1}'.format(
-                                                            tmp_tc_line['tc_file_name'], tmp_tc_line['tc_line_nr']))
+                                                            tmp_tc_line['tc_file_name'], tmp_tc_line['tc_line_nr']),
+                                                        failure_type=failure_type)
                             else:
                                 tmp_tc.add_failure_info(message=" ")
 
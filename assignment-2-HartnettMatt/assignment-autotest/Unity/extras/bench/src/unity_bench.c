@@ -0,0 +1,384 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#if !defined(_GNU_SOURCE) && defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#if !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "unity_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__) && !defined(UNITY_BENCH_EXCLUDE_PERF)
+#define UNITY_BENCH_PERF
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define UNITY_BENCH_MAX_ITERATIONS 0x40000000u
+
+enum
+{
+    UNITY_BENCH_IDLE = 0,
+    UNITY_BENCH_START,
+    UNITY_BENCH_CALIBRATE,
+    UNITY_BENCH_MEASURE
+};
+
+UNITY_UINT32 UnityBenchCountdown;
+
+static struct
+{
+    int Phase;
+    const char* Name;
+    UNITY_LINE_TYPE Line;
+    UNITY_UINT32 Iterations;
+    UNITY_UINT32 Count;
+    unsigned long long BeginNs;
+    unsigned long long SampleStartNs;
+    unsigned long long PerfStart[2];
+    double SampleNs[UNITY_BENCH_SAMPLES];
+    double SampleCycles[UNITY_BENCH_SAMPLES];
+    double SampleInstructions[UNITY_BENCH_SAMPLES];
+    int HavePerf;
+    UnityBenchResult Result;
+} UnityBench;
+
+static volatile double UnityBenchSink;
+
+/*-----------------------------------------------*/
+unsigned long long UnityBenchClockNs(void)
+{
+    struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+void UnityBenchKeep(double value)
+{
+    UnityBenchSink = value;
+}
+
+/*-----------------------------------------------
+ * CPU counters
+ *-----------------------------------------------*/
+
+#ifdef UNITY_BENCH_PERF
+static int UnityBenchPerfFd = -2; /* -2 not opened yet, -1 unavailable */
+
+static int UnityBenchPerfOpen(unsigned long long config, int group)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/* Counts user space cycles and instructions of this thread, if allowed */
+static int UnityBenchPerfInit(void)
+{
+    if (UnityBenchPerfFd == -2)
+    {
+        UnityBenchPerfFd = UnityBenchPerfOpen(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if ((UnityBenchPerfFd >= 0) &&
+            (UnityBenchPerfOpen(PERF_COUNT_HW_INSTRUCTIONS, UnityBenchPerfFd) < 0))
+        {
+            close(UnityBenchPerfFd);
+            UnityBenchPerfFd = -1;
+        }
+    }
+    return UnityBenchPerfFd >= 0;
+}
+
+static void UnityBenchPerfRead(unsigned long long counts[2])
+{
+    /* nr, then cycles and instructions */
+    unsigned long long values[3] = { 0, 0, 0 };
+
+    if (read(UnityBenchPerfFd, values, sizeof(values)) != (ssize_t)sizeof(values))
+    {
+        values[1] = values[2] = 0;
+    }
+    counts[0] = values[1];
+    counts[1] = values[2];
+}
+#else
+static int UnityBenchPerfInit(void)
+{
+    return 0;
+}
+
+static void UnityBenchPerfRead(unsigned long long counts[2])
+{
+    counts[0] = counts[1] = 0;
+}
+#endif
+
+/*-----------------------------------------------
+ * Statistics
+ *-----------------------------------------------*/
+
+static int UnityBenchCompare(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Linear interpolation between the closest ranks of sorted[0..count) */
+static double UnityBenchPercentile(const double* sorted, const UNITY_UINT32 count, const double fraction)
+{
+    double rank = fraction * (double)(count - 1);
+    UNITY_UINT32 below = (UNITY_UINT32)rank;
+
+    if (below + 1 >= count)
+    {
+        return sorted[count - 1];
+    }
+    return sorted[below] + (rank - (double)below) * (sorted[below + 1] - sorted[below]);
+}
+
+static double UnityBenchMedian(const double* samples, const UNITY_UINT32 count)
+{
+    double sorted[UNITY_BENCH_SAMPLES];
+
+    memcpy(sorted, samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), UnityBenchCompare);
+    return UnityBenchPercentile(sorted, count, 0.5);
+}
+
+void UnityBenchComputeStats(const double* samples, const UNITY_UINT32 count, UnityBenchResult* result)
+{
+    double sorted[UNITY_BENCH_SAMPLES];
+    double deviation[UNITY_BENCH_SAMPLES];
+    double sum = 0.0;
+    UNITY_UINT32 n = (count < UNITY_BENCH_SAMPLES) ? count : UNITY_BENCH_SAMPLES;
+    UNITY_UINT32 i;
+
+    result->Samples = n;
+    if (n == 0)
+    {
+        result->MinNs = result->MedianNs = result->MadNs = result->P90Ns = 0.0;
+        result->P99Ns = result->MaxNs = result->MeanNs = 0.0;
+        return;
+    }
+
+    memcpy(sorted, samples, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), UnityBenchCompare);
+    for (i = 0; i < n; i++)
+    {
+        sum += sorted[i];
+    }
+    result->MinNs = sorted[0];
+    result->MedianNs = UnityBenchPercentile(sorted, n, 0.5);
+    result->P90Ns = UnityBenchPercentile(sorted, n, 0.9);
+    result->P99Ns = UnityBenchPercentile(sorted, n, 0.99);
+    result->MaxNs = sorted[n - 1];
+    result->MeanNs = sum / (double)n;
+
+    for (i = 0; i < n; i++)
+    {
+        deviation[i] = (sorted[i] > result->MedianNs) ? sorted[i] - result->MedianNs
+                                                      : result->MedianNs - sorted[i];
+    }
+    result->MadNs = UnityBenchMedian(deviation, n);
+}
+
+/*-----------------------------------------------
+ * Output
+ *-----------------------------------------------*/
+
+/* Copies name with anything but letters, digits, '_', '-' and '.' made '_',
+ * so the BENCH line splits on spaces and '=' */
+static void UnityBenchCleanName(char* out, const size_t size, const char* name)
+{
+    size_t i;
+
+    for (i = 0; (i + 1 < size) && name && name[i]; i++)
+    {
+        char c = name[i];
+        int keep = ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+                   ((c >= '0') && (c <= '9')) || (c == '_') || (c == '-') || (c == '.');
+        out[i] = keep ? c : '_';
+    }
+    out[i] = '\0';
+}
+
+/* One line of key=value pairs, with no ':' so it isn't taken for a result */
+static void UnityBenchPrint(const UnityBenchResult* r)
+{
+    char name[64];
+    char test[64];
+    char line[512];
+    int len;
+
+    UnityBenchCleanName(name, sizeof(name), r->Name);
+    UnityBenchCleanName(test, sizeof(test), Unity.CurrentTestName);
+    len = snprintf(line, sizeof(line),
+                   "BENCH test=%s name=%s line=%lu samples=%lu iterations=%lu median_ns=%.3f "
+                   "mad_ns=%.3f min_ns=%.3f p90_ns=%.3f p99_ns=%.3f max_ns=%.3f mean_ns=%.3f",
+                   test, name, (unsigned long)UnityBench.Line, (unsigned long)r->Samples,
+                   (unsigned long)r->Iterations, r->MedianNs, r->MadNs, r->MinNs, r->P90Ns,
+                   r->P99Ns, r->MaxNs, r->MeanNs);
+    if ((r->Cycles >= 0.0) && (len > 0) && ((size_t)len < sizeof(line)))
+    {
+        snprintf(line + len, sizeof(line) - (size_t)len, " cycles=%.1f instructions=%.1f",
+                 r->Cycles, r->Instructions);
+    }
+    UnityPrint(line);
+    UNITY_PRINT_EOL();
+}
+
+/*-----------------------------------------------
+ * Benchmark loop
+ *-----------------------------------------------*/
+
+void UnityBenchBegin(const char* name, const UNITY_LINE_TYPE line)
+{
+    UnityBench.Phase = UNITY_BENCH_START;
+    UnityBench.Name = name;
+    UnityBench.Line = line;
+    UnityBench.Iterations = 1;
+    UnityBench.Count = 0;
+    UnityBench.Result.Samples = 0;
+    UnityBench.HavePerf = UnityBenchPerfInit();
+    UnityBench.BeginNs = UNITY_BENCH_CLOCK_NS();
+}
+
+static void UnityBenchFinish(void)
+{
+    UnityBenchResult* r = &UnityBench.Result;
+
+    UnityBenchComputeStats(UnityBench.SampleNs, UnityBench.Count, r);
+    r->Name = UnityBench.Name;
+    r->Iterations = UnityBench.Iterations;
+    r->Cycles = UnityBench.HavePerf ? UnityBenchMedian(UnityBench.SampleCycles, UnityBench.Count) : -1.0;
+    r->Instructions = UnityBench.HavePerf ? UnityBenchMedian(UnityBench.SampleInstructions, UnityBench.Count) : -1.0;
+    UnityBench.Phase = UNITY_BENCH_IDLE;
+    UnityBenchPrint(r);
+}
+
+/* Ends the sample that just ran and returns the iterations of the next one,
+ * or 0 once the benchmark is done */
+UNITY_UINT32 UnityBenchNext(void)
+{
+    unsigned long long now = UNITY_BENCH_CLOCK_NS();
+    unsigned long long elapsed = now - UnityBench.SampleStartNs;
+    unsigned long long perf[2];
+
+    if (UnityBench.HavePerf)
+    {
+        UnityBenchPerfRead(perf);
+    }
+
+    switch (UnityBench.Phase)
+    {
+        case UNITY_BENCH_START:
+            UnityBench.Phase = UNITY_BENCH_CALIBRATE;
+            break;
+
+        case UNITY_BENCH_CALIBRATE:
+            /* Grow the iterations until a sample takes about UNITY_BENCH_SAMPLE_NS */
+            if ((elapsed < UNITY_BENCH_SAMPLE_NS / 2) && (UnityBench.Iterations < UNITY_BENCH_MAX_ITERATIONS))
+            {
+                unsigned long long next = (elapsed == 0) ? (unsigned long long)UnityBench.Iterations * 10u
+                                        : (unsigned long long)UnityBench.Iterations * UNITY_BENCH_SAMPLE_NS / elapsed;
+
+                if (next > (unsigned long long)UnityBench.Iterations * 10u)
+                {
+                    next = (unsigned long long)UnityBench.Iterations * 10u;
+                }
+                if (next <= UnityBench.Iterations)
+                {
+                    next = (unsigned long long)UnityBench.Iterations + 1u;
+                }
+                UnityBench.Iterations = (next > UNITY_BENCH_MAX_ITERATIONS) ? UNITY_BENCH_MAX_ITERATIONS
+                                                                             : (UNITY_UINT32)next;
+            }
+            else if (now - UnityBench.BeginNs >= UNITY_BENCH_WARMUP_NS)
+            {
+                UnityBench.Phase = UNITY_BENCH_MEASURE;
+            }
+            break;
+
+        case UNITY_BENCH_MEASURE:
+            UnityBench.SampleNs[UnityBench.Count] = (double)elapsed / (double)UnityBench.Iterations;
+            if (UnityBench.HavePerf)
+            {
+                UnityBench.SampleCycles[UnityBench.Count] =
+                    (double)(perf[0] - UnityBench.PerfStart[0]) / (double)UnityBench.Iterations;
+                UnityBench.SampleInstructions[UnityBench.Count] =
+                    (double)(perf[1] - UnityBench.PerfStart[1]) / (double)UnityBench.Iterations;
+            }
+            UnityBench.Count++;
+            if ((UnityBench.Count == UNITY_BENCH_SAMPLES) ||
+                ((UnityBench.Count >= UNITY_BENCH_MIN_SAMPLES) && (now - UnityBench.BeginNs >= UNITY_BENCH_MAX_NS)))
+            {
+                UnityBenchFinish();
+                return 0;
+            }
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (UnityBench.HavePerf)
+    {
+        UnityBenchPerfRead(UnityBench.PerfStart);
+    }
+    UnityBench.SampleStartNs = UNITY_BENCH_CLOCK_NS();
+    return UnityBench.Iterations;
+}
+
+const UnityBenchResult* UnityBenchLastResult(void)
+{
+    return &UnityBench.Result;
+}
+
+/*-----------------------------------------------
+ * Assertions
+ *-----------------------------------------------*/
+
+void UnityBenchAssertFasterThanNs(const double limit_ns, const char* msg, const UNITY_LINE_TYPE line)
+{
+    const UnityBenchResult* r = &UnityBench.Result;
+    char text[256];
+
+    if (Unity.CurrentTestFailed || Unity.CurrentTestIgnored)
+    {
+        return;
+    }
+    if (r->Samples == 0)
+    {
+        UnityFail("No benchmark has run", line);
+    }
+    if (r->MedianNs < limit_ns)
+    {
+        return;
+    }
+    snprintf(text, sizeof(text), "Benchmark %s median %.1f ns, expected faster than %.1f ns%s%s",
+             r->Name ? r->Name : "", r->MedianNs, limit_ns, msg ? ". " : "", msg ? msg : "");
+    UnityFail(text, line);
+}
@@ -0,0 +1,96 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#ifndef UNITY_BENCH_H_
+#define UNITY_BENCH_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "unity.h"
+
+/* Timed samples per benchmark, the statistics are taken over these */
+#ifndef UNITY_BENCH_SAMPLES
+#define UNITY_BENCH_SAMPLES 31
+#endif
+
+/* Fewest samples, even when a benchmark runs past UNITY_BENCH_MAX_NS */
+#ifndef UNITY_BENCH_MIN_SAMPLES
+#define UNITY_BENCH_MIN_SAMPLES 5
+#endif
+
+/* How long one sample should take, the iteration count is calibrated to it */
+#ifndef UNITY_BENCH_SAMPLE_NS
+#define UNITY_BENCH_SAMPLE_NS 1000000
+#endif
+
+/* Time spent calibrating and warming up caches and branch predictors first */
+#ifndef UNITY_BENCH_WARMUP_NS
+#define UNITY_BENCH_WARMUP_NS 10000000
+#endif
+
+/* Past this, a benchmark stops as soon as it has UNITY_BENCH_MIN_SAMPLES */
+#ifndef UNITY_BENCH_MAX_NS
+#define UNITY_BENCH_MAX_NS 1000000000
+#endif
+
+/* Nanosecond clock, CLOCK_MONOTONIC_RAW by default */
+#ifndef UNITY_BENCH_CLOCK_NS
+#define UNITY_BENCH_CLOCK_NS() UnityBenchClockNs()
+#endif
+unsigned long long UnityBenchClockNs(void);
+
+/* Keeps the compiler from optimising away a value the benchmark computes */
+#if defined(__GNUC__) || defined(__clang__)
+#define UNITY_BENCH_KEEP(value) __asm__ __volatile__("" : : "g"(value) : "memory")
+#else
+#define UNITY_BENCH_KEEP(value) UnityBenchKeep((double)(value))
+#endif
+void UnityBenchKeep(double value);
+
+/* Statistics of one benchmark, all per call of the benchmarked code */
+typedef struct UNITY_BENCH_RESULT_T
+{
+    const char* Name;
+    UNITY_UINT32 Samples;
+    UNITY_UINT32 Iterations;    /* Calls timed together in each sample */
+    double MinNs;
+    double MedianNs;
+    double MadNs;               /* Median absolute deviation from MedianNs */
+    double P90Ns;
+    double P99Ns;
+    double MaxNs;
+    double MeanNs;
+    double Cycles;              /* Medians from the CPU's counters, */
+    double Instructions;        /* negative when they aren't available */
+} UnityBenchResult;
+
+/* TEST_BENCHMARK(name) { code } runs code repeatedly, prints a BENCH line
+ * with the statistics and keeps them for the assertions below */
+#define TEST_BENCHMARK(name)                                                   \
+    for (UnityBenchBegin((name), __LINE__); (UnityBenchCountdown = UnityBenchNext()) > 0; ) \
+        while (UnityBenchCountdown-- > 0)
+
+#define TEST_ASSERT_BENCH_FASTER_THAN_NS(limit_ns)                             \
+    UnityBenchAssertFasterThanNs((double)(limit_ns), NULL, (UNITY_LINE_TYPE)__LINE__)
+#define TEST_ASSERT_BENCH_FASTER_THAN_NS_MESSAGE(limit_ns, message)            \
+    UnityBenchAssertFasterThanNs((double)(limit_ns), (message), (UNITY_LINE_TYPE)__LINE__)
+
+extern UNITY_UINT32 UnityBenchCountdown;
+
+void UnityBenchBegin(const char* name, const UNITY_LINE_TYPE line);
+UNITY_UINT32 UnityBenchNext(void);
+const UnityBenchResult* UnityBenchLastResult(void);
+void UnityBenchComputeStats(const double* samples, const UNITY_UINT32 count, UnityBenchResult* result);
+void UnityBenchAssertFasterThanNs(const double limit_ns, const char* msg, const UNITY_LINE_TYPE line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_bench.h"
+#include "unity_output_Spy.h"
+#include <string.h>
+
+/* This test module includes the following tests: */
+
+void test_StatsOfOddSampleCount(void);
+void test_StatsOfEvenSampleCount(void);
+void test_StatsOfOneSample(void);
+void test_BenchmarkTakesAllSamples(void);
+void test_BenchmarkPrintsBenchLine(void);
+void test_FasterThanPassesUnderLimit(void);
+void test_FasterThanFailsOverLimit(void);
+void test_FasterThanFailsWithoutBenchmark(void);
+
+/* It makes use of the following features */
+void setUp(void);
+void tearDown(void);
+
+/* Let's Go! */
+void setUp(void)
+{
+    UnityOutputCharSpy_Create(1000);
+}
+
+void tearDown(void)
+{
+    UnityOutputCharSpy_Destroy();
+}
+
+#define EXPECT_ABORT_BEGIN \
+  { \
+    jmp_buf TestAbortFrame;   \
+    memcpy(TestAbortFrame, Unity.AbortFrame, sizeof(jmp_buf)); \
+    if (TEST_PROTECT()) \
+    {
+
+#define EXPECT_ABORT_END \
+    } \
+    memcpy(Unity.AbortFrame, TestAbortFrame, sizeof(jmp_buf)); \
+  }
+
+static volatile unsigned int Calls;
+
+static void RunTinyBenchmark(void)
+{
+    Calls = 0;
+    TEST_BENCHMARK("tiny increment")
+    {
+        Calls++;
+    }
+}
+
+void test_StatsOfOddSampleCount(void)
+{
+    const double samples[] = { 5.0, 1.0, 3.0, 2.0, 4.0 };
+    UnityBenchResult r;
+
+    UnityBenchComputeStats(samples, 5, &r);
+    TEST_ASSERT_EQUAL_UINT32(5, r.Samples);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, r.MinNs);
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, r.MedianNs);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, r.MadNs);
+    TEST_ASSERT_EQUAL_DOUBLE(4.6, r.P90Ns);
+    TEST_ASSERT_EQUAL_DOUBLE(4.96, r.P99Ns);
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, r.MaxNs);
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, r.MeanNs);
+}
+
+void test_StatsOfEvenSampleCount(void)
+{
+    const double samples[] = { 10.0, 40.0, 20.0, 100.0 };
+    UnityBenchResult r;
+
+    UnityBenchComputeStats(samples, 4, &r);
+    TEST_ASSERT_EQUAL_DOUBLE(30.0, r.MedianNs);
+    /* Deviations 20, 10, 10, 70 */
+    TEST_ASSERT_EQUAL_DOUBLE(15.0, r.MadNs);
+    TEST_ASSERT_EQUAL_DOUBLE(42.5, r.MeanNs);
+}
+
+void test_StatsOfOneSample(void)
+{
+    const double samples[] = { 7.0 };
+    UnityBenchResult r;
+
+    UnityBenchComputeStats(samples, 1, &r);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, r.MinNs);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, r.MedianNs);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, r.P99Ns);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, r.MadNs);
+}
+
+void test_BenchmarkTakesAllSamples(void)
+{
+    const UnityBenchResult* r;
+
+    RunTinyBenchmark();
+    r = UnityBenchLastResult();
+    TEST_ASSERT_EQUAL_STRING("tiny increment", r->Name);
+    TEST_ASSERT_EQUAL_UINT32(UNITY_BENCH_SAMPLES, r->Samples);
+    /* A cheap body is calibrated to many calls per sample */
+    TEST_ASSERT_GREATER_THAN_UINT32(100, r->Iterations);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(r->Samples * r->Iterations, Calls);
+    TEST_ASSERT_TRUE(r->MedianNs > 0.0);
+    TEST_ASSERT_TRUE(r->MinNs <= r->MedianNs);
+    TEST_ASSERT_TRUE(r->MedianNs <= r->P90Ns);
+    TEST_ASSERT_TRUE(r->P90Ns <= r->P99Ns);
+    TEST_ASSERT_TRUE(r->P99Ns <= r->MaxNs);
+}
+
+void test_BenchmarkPrintsBenchLine(void)
+{
+    const char* out;
+
+    UnityOutputCharSpy_Enable(1);
+    RunTinyBenchmark();
+    UnityOutputCharSpy_Enable(0);
+    out = UnityOutputCharSpy_Get();
+    TEST_ASSERT_EQUAL_STRING_LEN("BENCH test=test_BenchmarkPrintsBenchLine name=tiny_increment line=",
+                                 out, 65);
+    TEST_ASSERT_NOT_NULL(strstr(out, " samples=31 "));
+    TEST_ASSERT_NOT_NULL(strstr(out, " median_ns="));
+    TEST_ASSERT_NOT_NULL(strstr(out, " mad_ns="));
+    TEST_ASSERT_NOT_NULL(strstr(out, " p99_ns="));
+    /* Never mistaken for a "file:line:test:STATUS" result */
+    TEST_ASSERT_NULL(strchr(out, ':'));
+    TEST_ASSERT_EQUAL_CHAR('\n', out[strlen(out) - 1]);
+}
+
+void test_FasterThanPassesUnderLimit(void)
+{
+    RunTinyBenchmark();
+    TEST_ASSERT_BENCH_FASTER_THAN_NS(1000000);
+}
+
+void test_FasterThanFailsOverLimit(void)
+{
+    RunTinyBenchmark();
+    UnityOutputCharSpy_Enable(1);
+    EXPECT_ABORT_BEGIN
+    TEST_ASSERT_BENCH_FASTER_THAN_NS_MESSAGE(0, "too slow");
+    EXPECT_ABORT_END
+    UnityOutputCharSpy_Enable(0);
+    Unity.CurrentTestFailed = 0;
+    TEST_ASSERT_NOT_NULL(strstr(UnityOutputCharSpy_Get(), "Benchmark tiny increment median "));
+    TEST_ASSERT_NOT_NULL(strstr(UnityOutputCharSpy_Get(), " ns, expected faster than 0.0 ns. too slow"));
+}
+
+void test_FasterThanFailsWithoutBenchmark(void)
+{
+    UnityBenchBegin("never run", __LINE__);
+    UnityOutputCharSpy_Enable(1);
+    EXPECT_ABORT_BEGIN
+    TEST_ASSERT_BENCH_FASTER_THAN_NS(1000000);
+    EXPECT_ABORT_END
+    UnityOutputCharSpy_Enable(0);
+    Unity.CurrentTestFailed = 0;
+    TEST_ASSERT_NOT_NULL(strstr(UnityOutputCharSpy_Get(), "No benchmark has run"));
+}
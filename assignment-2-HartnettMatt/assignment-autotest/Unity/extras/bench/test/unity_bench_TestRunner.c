@@ -0,0 +1,31 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_bench.h"
+
+extern void test_StatsOfOddSampleCount(void);
+extern void test_StatsOfEvenSampleCount(void);
+extern void test_StatsOfOneSample(void);
+extern void test_BenchmarkTakesAllSamples(void);
+extern void test_BenchmarkPrintsBenchLine(void);
+extern void test_FasterThanPassesUnderLimit(void);
+extern void test_FasterThanFailsOverLimit(void);
+extern void test_FasterThanFailsWithoutBenchmark(void);
+
+int main(void)
+{
+    UnityBegin("unity_bench_Test.c");
+    RUN_TEST(test_StatsOfOddSampleCount);
+    RUN_TEST(test_StatsOfEvenSampleCount);
+    RUN_TEST(test_StatsOfOneSample);
+    RUN_TEST(test_BenchmarkTakesAllSamples);
+    RUN_TEST(test_BenchmarkPrintsBenchLine);
+    RUN_TEST(test_FasterThanPassesUnderLimit);
+    RUN_TEST(test_FasterThanFailsOverLimit);
+    RUN_TEST(test_FasterThanFailsWithoutBenchmark);
+    return UnityEnd();
+}
@@ -0,0 +1,134 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_bench.h"
+#include <stdio.h>
+
+/* Selection of 100k synthetic tests by the -n and -x filters of UnityParseOptions, which
+ * should cost time in proportion to the length of the test names and not the patterns */
+
+void test_FilterSelectsSyntheticTests(void);
+void test_FilterSelectionOf100kTests(void);
+#ifdef UNITY_INCLUDE_REGEX
+void test_RegexFilterSelectionOf100kTests(void);
+#endif
+
+void setUp(void);
+void tearDown(void);
+
+/* 100 files of 1000 tests, named test_group<i % 100>_case_<i / 100> */
+#define FILTER_TESTS    100000
+#define FILTER_FILES    100
+
+static char names[FILTER_TESTS][32];
+static char files[FILTER_FILES][32];
+
+static char argProgram[] = "filter_bench";
+static char argInclude[] = "-n";
+static char argExclude[] = "-x";
+static char globIncludes[] = "test_suite07:*,*_case_1?";
+static char globExcludes[] = "*group3_*";
+#ifdef UNITY_INCLUDE_REGEX
+static char regexIncludes[] = "test_suite07:*,/_case_1[0-9]+$/";
+static char regexExcludes[] = "/group3_/";
+#endif
+
+void setUp(void)
+{
+    unsigned int i;
+
+    if (names[0][0] != 0)
+        return;
+    for (i = 0; i < FILTER_FILES; i++)
+        sprintf(files[i], "tests/test_suite%02u.c", i);
+    for (i = 0; i < FILTER_TESTS; i++)
+        sprintf(names[i], "test_group%u_case_%u", i % 100, i / 100);
+}
+
+void tearDown(void)
+{
+    char* noOptions[1];
+
+    noOptions[0] = argProgram;
+    UnityParseOptions(1, noOptions);
+}
+
+static int parseFilters(char* includes, char* excludes)
+{
+    char* argv[5];
+
+    argv[0] = argProgram;
+    argv[1] = argInclude;
+    argv[2] = includes;
+    argv[3] = argExclude;
+    argv[4] = excludes;
+    return UnityParseOptions(5, argv);
+}
+
+static unsigned long selectTests(void)
+{
+    const char* savedFile = Unity.TestFile;
+    const char* savedName = Unity.CurrentTestName;
+    unsigned long selected = 0;
+    unsigned int i;
+
+    for (i = 0; i < FILTER_TESTS; i++)
+    {
+        Unity.TestFile = files[i / (FILTER_TESTS / FILTER_FILES)];
+        Unity.CurrentTestName = names[i];
+        selected += (unsigned long)UnityTestMatches();
+    }
+    Unity.TestFile = savedFile;
+    Unity.CurrentTestName = savedName;
+    return selected;
+}
+
+/* What the filters above pick: all of file 7, and cases 10-19 and 100-199, but not group 3 */
+static unsigned long expectedSelection(void)
+{
+    unsigned long selected = 0;
+    unsigned int i;
+
+    for (i = 0; i < FILTER_TESTS; i++)
+    {
+        unsigned int testCase = i / 100;
+        int included = (i / 1000 == 7) || (testCase >= 10 && testCase <= 19) ||
+                       (testCase >= 100 && testCase <= 199);
+        if (included && (i % 100 != 3))
+            selected++;
+    }
+    return selected;
+}
+
+void test_FilterSelectsSyntheticTests(void)
+{
+    TEST_ASSERT_EQUAL(0, parseFilters(globIncludes, globExcludes));
+    TEST_ASSERT_EQUAL_UINT32(expectedSelection(), selectTests());
+}
+
+void test_FilterSelectionOf100kTests(void)
+{
+    TEST_ASSERT_EQUAL(0, parseFilters(globIncludes, globExcludes));
+    TEST_BENCHMARK("select 100k tests by glob")
+    {
+        UNITY_BENCH_KEEP(selectTests());
+    }
+    /* About a microsecond a test would already mean something scans far more than names */
+    TEST_ASSERT_BENCH_FASTER_THAN_NS(100e6);
+}
+
+#ifdef UNITY_INCLUDE_REGEX
+void test_RegexFilterSelectionOf100kTests(void)
+{
+    TEST_ASSERT_EQUAL(0, parseFilters(regexIncludes, regexExcludes));
+    TEST_ASSERT_EQUAL_UINT32(expectedSelection(), selectTests());
+    TEST_BENCHMARK("select 100k tests by regex")
+    {
+        UNITY_BENCH_KEEP(selectTests());
+    }
+}
+#endif
@@ -0,0 +1,25 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_bench.h"
+
+extern void test_FilterSelectsSyntheticTests(void);
+extern void test_FilterSelectionOf100kTests(void);
+#ifdef UNITY_INCLUDE_REGEX
+extern void test_RegexFilterSelectionOf100kTests(void);
+#endif
+
+int main(void)
+{
+    UnityBegin("unity_filter_Bench.c");
+    RUN_TEST(test_FilterSelectsSyntheticTests);
+    RUN_TEST(test_FilterSelectionOf100kTests);
+#ifdef UNITY_INCLUDE_REGEX
+    RUN_TEST(test_RegexFilterSelectionOf100kTests);
+#endif
+    return UnityEnd();
+}
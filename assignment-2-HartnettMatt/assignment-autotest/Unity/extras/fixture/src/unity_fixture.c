@@ -8,6 +8,9 @@
 #include "unity_fixture.h"
 #include "unity_internals.h"
 #include <string.h>
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+#include <stdlib.h>
+#endif
 
 struct UNITY_FIXTURE_T UnityFixture;
 
@@ -27,6 +30,97 @@ static void announceTestRun(unsigned int runNumber)
     UNITY_PRINT_EOL();
 }
 
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+/* With command line arguments, the selected tests are first collected from runAllTests, so
+ * that UnityScheduleTests can shard and reorder them, and then run from the table */
+struct FixtureTest
+{
+    unityfunction* setup;
+    unityfunction* teardown;
+    const char* printableName;
+    const char* file;
+};
+
+static UnityTestEntry* collected = NULL;
+static struct FixtureTest* collectedFixtures = NULL;
+static UNITY_UINT32 collectedCount = 0;
+static UNITY_UINT32 collectedSize = 0;
+static int collecting = 0;
+
+static void collectTest(unityfunction* setup,
+                        unityfunction* testBody,
+                        unityfunction* teardown,
+                        const char* printableName,
+                        const char* group,
+                        const char* name,
+                        const char* file,
+                        unsigned int line)
+{
+    UnityTestEntry* test;
+    struct FixtureTest* fixture;
+
+    if (collectedCount == collectedSize)
+    {
+        UNITY_UINT32 size = collectedSize ? collectedSize * 2 : 64;
+        UnityTestEntry* tests = (UnityTestEntry*)realloc(collected, size * sizeof(*tests));
+        struct FixtureTest* fixtures = (struct FixtureTest*)realloc(collectedFixtures, size * sizeof(*fixtures));
+        if (tests != NULL)
+            collected = tests;
+        if (fixtures != NULL)
+            collectedFixtures = fixtures;
+        if (tests == NULL || fixtures == NULL)
+        {
+            UnityPrint("Out of memory collecting the tests, skipping ");
+            UnityPrint(printableName);
+            UNITY_PRINT_EOL();
+            return;
+        }
+        collectedSize = size;
+    }
+    test = &collected[collectedCount];
+    fixture = &collectedFixtures[collectedCount];
+    test->Func = testBody;
+    test->Group = group;
+    test->Name = name;
+    test->Line = (int)line;
+    test->Data = fixture;
+    fixture->setup = setup;
+    fixture->teardown = teardown;
+    fixture->printableName = printableName;
+    fixture->file = file;
+    collectedCount++;
+}
+
+static void runScheduledTests(void (*runAllTests)(void))
+{
+    UNITY_UINT32 count;
+    UNITY_UINT32 i;
+
+    collectedCount = 0;
+    collecting = 1;
+    runAllTests();
+    collecting = 0;
+
+    count = UnityScheduleTests(collected, collectedCount);
+    for (i = 0; i < count; i++)
+    {
+        const UnityTestEntry* test = &collected[i];
+        const struct FixtureTest* fixture = (const struct FixtureTest*)test->Data;
+        if (test->Func == NULL)
+            UnityIgnoreTest(fixture->printableName, test->Group, test->Name);
+        else
+            UnityTestRunner(fixture->setup, test->Func, fixture->teardown, fixture->printableName,
+                            test->Group, test->Name, fixture->file, (unsigned int)test->Line);
+    }
+
+    free(collected);
+    free(collectedFixtures);
+    collected = NULL;
+    collectedFixtures = NULL;
+    collectedSize = 0;
+}
+#endif
+
 int UnityMain(int argc, const char* argv[], void (*runAllTests)(void))
 {
     int result = UnityGetCommandLineOptions(argc, argv);
@@ -38,7 +132,11 @@ int UnityMain(int argc, const char* argv[], void (*runAllTests)(void))
     {
         UnityBegin(argv[0]);
         announceTestRun(r);
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+        runScheduledTests(runAllTests);
+#else
         runAllTests();
+#endif
         if (!UnityFixture.Verbose) UNITY_PRINT_EOL();
         UnityEnd();
     }
@@ -74,6 +172,13 @@ void UnityTestRunner(unityfunction* setup,
 {
     if (testSelected(name) && groupSelected(group))
     {
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+        if (collecting)
+        {
+            collectTest(setup, testBody, teardown, printableName, group, name, file, line);
+            return;
+        }
+#endif
         Unity.TestFile = file;
         Unity.CurrentTestName = printableName;
         Unity.CurrentTestLineNumber = line;
@@ -119,6 +224,13 @@ void UnityIgnoreTest(const char* printableName, const char* group, const char* n
 {
     if (testSelected(name) && groupSelected(group))
     {
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+        if (collecting)
+        {
+            collectTest(NULL, NULL, NULL, printableName, group, name, NULL, 0);
+            return;
+        }
+#endif
         Unity.NumberOfTests++;
         Unity.TestIgnores++;
         if (UnityFixture.Verbose)
@@ -186,6 +298,9 @@ int UnityGetCommandLineOptions(int argc, const char* argv[])
     UnityFixture.GroupFilter = 0;
     UnityFixture.NameFilter = 0;
     UnityFixture.RepeatCount = 1;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    UnityParseScheduleOption(NULL);
+#endif
 
     if (argc == 1)
         return 0;
@@ -213,6 +328,16 @@ int UnityGetCommandLineOptions(int argc, const char* argv[])
             UNITY_PRINT_EOL();
             UnityPrint("  -r NUMBER   Repeatedly run all tests NUMBER times");
             UNITY_PRINT_EOL();
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+            UnityPrint("  --shard=I/N       Only run the I-th of N shards of the tests (from 1)");
+            UNITY_PRINT_EOL();
+            UnityPrint("  --shuffle[=SEED]  Run the tests in a random order");
+            UNITY_PRINT_EOL();
+            UnityPrint("  --order=duration  Run the longest tests first, by the timings in");
+            UNITY_PRINT_EOL();
+            UnityPrint("                    --durations=FILE (" UNITY_DURATIONS_FILE ")");
+            UNITY_PRINT_EOL();
+#endif
             UnityPrint("  -h, --help  Display this help message");
             UNITY_PRINT_EOL();
             UNITY_PRINT_EOL();
@@ -272,6 +397,15 @@ int UnityGetCommandLineOptions(int argc, const char* argv[])
                 }
             }
         }
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            /* --shard, --shuffle, --order and --durations, anything else is ignored */
+            if (UnityParseScheduleOption(argv[i]) == 1)
+                return 1;
+            i++;
+        }
+#endif
         else
         {
             /* ignore unknown parameter */
@@ -239,6 +239,86 @@ TEST(UnityCommandOptions, GroupFilterReallyFilters)
     TEST_ASSERT_EQUAL(saved, Unity.NumberOfTests);
 }
 
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+static const char* scheduleOptions[] = {
+        "testrunner.exe",
+        "--shard=2/3",
+        "--shuffle=1234",
+        "--order=duration",
+        "--durations=timings.txt",
+        "--unknown"
+};
+
+TEST(UnityCommandOptions, ScheduleOptions)
+{
+    TEST_ASSERT_EQUAL(0, UnityGetCommandLineOptions(6, scheduleOptions));
+    TEST_ASSERT_EQUAL(0, UnityParseScheduleOption("--shard=1/1"));
+    TEST_ASSERT_EQUAL(0, UnityParseScheduleOption("--shuffle"));
+    TEST_ASSERT_EQUAL(0, UnityParseScheduleOption("--order=declared"));
+    TEST_ASSERT_EQUAL(-1, UnityParseScheduleOption("--unknown"));
+    UnityParseScheduleOption(NULL);
+}
+
+static const char* badShard[] = {
+        "testrunner.exe",
+        "--shard=4/3"
+};
+
+TEST(UnityCommandOptions, BadScheduleOptionsFail)
+{
+    UNITY_OUTPUT_CHAR('\n'); /* The errors are printed */
+    TEST_ASSERT_EQUAL(1, UnityGetCommandLineOptions(2, badShard));
+    TEST_ASSERT_EQUAL(1, UnityParseScheduleOption("--shard=0/3"));
+    TEST_ASSERT_EQUAL(1, UnityParseScheduleOption("--shard=1/"));
+    TEST_ASSERT_EQUAL(1, UnityParseScheduleOption("--shuffle=seed"));
+    TEST_ASSERT_EQUAL(1, UnityParseScheduleOption("--order=sideways"));
+    UnityParseScheduleOption(NULL);
+}
+
+static const char* shardOptions[][2] = {
+        { "testrunner.exe", "--shard=1/3" },
+        { "testrunner.exe", "--shard=2/3" },
+        { "testrunner.exe", "--shard=3/3" }
+};
+
+TEST(UnityCommandOptions, ShardsSplitTheTests)
+{
+    static const char* names[] = {
+        "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+        "india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa"
+    };
+    UnityTestEntry tests[16];
+    int seen[16];
+    UNITY_UINT32 total = 0;
+    UNITY_UINT32 count;
+    UNITY_UINT32 i;
+    int shard;
+
+    memset(seen, 0, sizeof(seen));
+    for (shard = 0; shard < 3; shard++)
+    {
+        for (i = 0; i < 16; i++)
+        {
+            tests[i].Func = NULL;
+            tests[i].Group = "Group";
+            tests[i].Name = names[i];
+            tests[i].Line = (int)i;
+            tests[i].Data = &seen[i];
+        }
+        TEST_ASSERT_EQUAL(0, UnityGetCommandLineOptions(2, shardOptions[shard]));
+        count = UnityScheduleTests(tests, 16);
+        for (i = 0; i < count; i++)
+            (*(int*)tests[i].Data)++;
+        total += count;
+    }
+    UnityParseScheduleOption(NULL);
+
+    TEST_ASSERT_EQUAL(16, total);
+    for (i = 0; i < 16; i++)
+        TEST_ASSERT_EQUAL(1, seen[i]);
+}
+#endif
+
 IGNORE_TEST(UnityCommandOptions, TestShouldBeIgnored)
 {
     TEST_FAIL_MESSAGE("This test should not run!");
@@ -28,5 +28,10 @@ TEST_GROUP_RUNNER(UnityCommandOptions)
     RUN_TEST_CASE(UnityCommandOptions, UnknownCommandIsIgnored);
     RUN_TEST_CASE(UnityCommandOptions, GroupOrNameFilterWithoutStringFails);
     RUN_TEST_CASE(UnityCommandOptions, GroupFilterReallyFilters);
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    RUN_TEST_CASE(UnityCommandOptions, ScheduleOptions);
+    RUN_TEST_CASE(UnityCommandOptions, BadScheduleOptionsFail);
+    RUN_TEST_CASE(UnityCommandOptions, ShardsSplitTheTests);
+#endif
     RUN_TEST_CASE(UnityCommandOptions, TestShouldBeIgnored);
 }
@@ -0,0 +1,245 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity_register.h"
+#include <string.h>
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+#include <stdlib.h>
+#endif
+
+static UnityRegisteredTest* UnityRegistryFirst;
+static UnityRegisteredTest* UnityRegistryLast;
+static UnityRegisteredFixture* UnityRegistryFixtures;
+
+static int UnitySameFile(const char* a, const char* b)
+{
+    return (a == b) || (strcmp(a, b) == 0);
+}
+
+/*-----------------------------------------------*/
+void UnityRegisterTest(UnityRegisteredTest* test)
+{
+    UnityRegisteredTest* after = UnityRegistryLast;
+    UnityRegisteredTest* other;
+
+    /* The constructors of a file normally run one after the other, so its tests are already
+     * together. If not, the test still goes after the last one from its file */
+    if ((after != NULL) && !UnitySameFile(after->File, test->File))
+    {
+        for (other = UnityRegistryFirst; other != NULL; other = other->Next)
+        {
+            if (UnitySameFile(other->File, test->File))
+            {
+                after = other;
+            }
+        }
+    }
+    if (after == NULL)
+    {
+        test->Next = NULL;
+        UnityRegistryFirst = test;
+    }
+    else
+    {
+        test->Next = after->Next;
+        after->Next = test;
+    }
+    if (test->Next == NULL)
+    {
+        UnityRegistryLast = test;
+    }
+}
+
+/*-----------------------------------------------*/
+void UnityRegisterFixture(UnityRegisteredFixture* fixture)
+{
+    fixture->Next = UnityRegistryFixtures;
+    UnityRegistryFixtures = fixture;
+}
+
+/*-----------------------------------------------*/
+const UnityRegisteredTest* UnityRegisteredTests(void)
+{
+    return UnityRegistryFirst;
+}
+
+/*-----------------------------------------------*/
+static void UnityRunRegistered(UnityTestFunction func, const char* name, int line,
+                               UnityTestFunction setUpFunc, UnityTestFunction tearDownFunc)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = (UNITY_LINE_TYPE)line;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+    {
+        return;
+    }
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_ISOLATE_BEGIN();
+    UNITY_EXEC_TIME_START();
+    if (TEST_PROTECT())
+    {
+        if (setUpFunc != NULL)
+        {
+            setUpFunc();
+        }
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        if (tearDownFunc != NULL)
+        {
+            tearDownFunc();
+        }
+    }
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+    UNITY_ISOLATE_END();
+}
+
+/* Runs the tests of the file of first, and returns the first test of the next file */
+static const UnityRegisteredTest* UnityRunRegisteredGroup(const UnityRegisteredTest* first)
+{
+    UnityTestFunction setUpFunc = NULL;
+    UnityTestFunction tearDownFunc = NULL;
+    const UnityRegisteredFixture* fixture;
+    const UnityRegisteredTest* test;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    UNITY_UINT32 count = 0;
+    UNITY_UINT32 i;
+    UnityTestEntry* entries;
+    char* group;
+    const char* base;
+    const char* end;
+#endif
+
+    for (fixture = UnityRegistryFixtures; fixture != NULL; fixture = fixture->Next)
+    {
+        if (UnitySameFile(fixture->File, first->File))
+        {
+            if (fixture->SetUp != NULL)
+            {
+                setUpFunc = fixture->SetUp;
+            }
+            if (fixture->TearDown != NULL)
+            {
+                tearDownFunc = fixture->TearDown;
+            }
+        }
+    }
+    Unity.TestFile = first->File;
+
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    /* In a table, so --shard, --shuffle and --order can pick and reorder the tests. The
+     * group is the file's base name, as in the runners generate_test_runner.rb writes */
+    for (test = first; (test != NULL) && UnitySameFile(test->File, first->File); test = test->Next)
+    {
+        count++;
+    }
+    base = first->File + strlen(first->File);
+    while ((base > first->File) && (base[-1] != '/') && (base[-1] != '\\'))
+    {
+        base--;
+    }
+    end = strrchr(base, '.');
+    if (end == NULL)
+    {
+        end = base + strlen(base);
+    }
+    entries = (UnityTestEntry*)malloc(count * sizeof(UnityTestEntry));
+    group = (char*)malloc((size_t)(end - base) + 1);
+    if ((entries != NULL) && (group != NULL))
+    {
+        memcpy(group, base, (size_t)(end - base));
+        group[end - base] = '\0';
+        for (i = 0, test = first; i < count; i++, test = test->Next)
+        {
+            entries[i].Func = test->Func;
+            entries[i].Group = group;
+            entries[i].Name = test->Name;
+            entries[i].Line = test->Line;
+            entries[i].Data = NULL;
+        }
+        count = UnityScheduleTests(entries, count);
+        for (i = 0; i < count; i++)
+        {
+            UnityRunRegistered(entries[i].Func, entries[i].Name, entries[i].Line, setUpFunc, tearDownFunc);
+        }
+        free(entries);
+        free(group);
+        return test;
+    }
+    free(entries);
+    free(group);
+#endif
+
+    for (test = first; (test != NULL) && UnitySameFile(test->File, first->File); test = test->Next)
+    {
+        UnityRunRegistered(test->Func, test->Name, test->Line, setUpFunc, tearDownFunc);
+    }
+    return test;
+}
+
+/*-----------------------------------------------*/
+int UnityRunRegisteredFile(const char* file)
+{
+    const UnityRegisteredTest* test = UnityRegistryFirst;
+
+    while ((test != NULL) && !UnitySameFile(test->File, file))
+    {
+        test = test->Next;
+    }
+    UnityBegin(file);
+    if (test != NULL)
+    {
+        UnityRunRegisteredGroup(test);
+    }
+    return UnityEnd();
+}
+
+/*-----------------------------------------------*/
+int UnityRunRegisteredTests(int argc, char** argv)
+{
+    const UnityRegisteredTest* test;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    const UnityRegisteredTest* previous = NULL;
+    int parse_status = UnityParseOptions(argc, argv);
+
+    if (parse_status != 0)
+    {
+        if (parse_status < 0)
+        {
+            for (test = UnityRegistryFirst; test != NULL; test = test->Next)
+            {
+                if ((previous == NULL) || !UnitySameFile(test->File, previous->File))
+                {
+                    UnityPrint(test->File);
+                    UNITY_PRINT_EOL();
+                }
+                UnityPrint("  ");
+                UnityPrint(test->Name);
+                UNITY_PRINT_EOL();
+                previous = test;
+            }
+            return 0;
+        }
+        return parse_status;
+    }
+#else
+    (void)argc;
+    (void)argv;
+#endif
+
+    UnityBegin((UnityRegistryFirst != NULL) ? UnityRegistryFirst->File : "");
+    test = UnityRegistryFirst;
+    while (test != NULL)
+    {
+        test = UnityRunRegisteredGroup(test);
+    }
+    return UnityEnd();
+}
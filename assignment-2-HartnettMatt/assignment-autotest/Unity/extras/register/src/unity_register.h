@@ -0,0 +1,106 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#ifndef UNITY_REGISTER_H_
+#define UNITY_REGISTER_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "unity.h"
+
+/* A test found by UNITY_TEST or UNITY_TEST_CASE. Tests of the same file are kept next to
+ * each other in the registry, in the order their file registered them */
+typedef struct UNITY_REGISTERED_TEST_T
+{
+    UnityTestFunction Func;
+    const char* Name;
+    const char* File;
+    int Line;
+    const char* Params;         /* The arguments of a UNITY_TEST_CASE as written, or NULL */
+    struct UNITY_REGISTERED_TEST_T* Next;
+} UnityRegisteredTest;
+
+/* The setUp or tearDown of the tests of one file */
+typedef struct UNITY_REGISTERED_FIXTURE_T
+{
+    const char* File;
+    UnityTestFunction SetUp;
+    UnityTestFunction TearDown;
+    struct UNITY_REGISTERED_FIXTURE_T* Next;
+} UnityRegisteredFixture;
+
+/* Runs a registering function before main(). Only GCC and Clang are supported, through
+ * their constructor attribute */
+#if defined(__GNUC__) || defined(__clang__)
+#define UNITY_REGISTER_CONSTRUCTOR(func) \
+    static void func(void) __attribute__((constructor)); \
+    static void func(void)
+#else
+#error "Unity Register needs __attribute__((constructor)) from GCC or Clang"
+#endif
+
+/* UNITY_TEST(name) { body } defines the test function name and registers it */
+#define UNITY_TEST(name)                                                       \
+    void name(void);                                                           \
+    static UnityRegisteredTest UnityRegistered_##name =                        \
+        { name, #name, __FILE__, __LINE__, NULL, NULL };                       \
+    UNITY_REGISTER_CONSTRUCTOR(UnityRegister_##name)                           \
+    {                                                                          \
+        UnityRegisterTest(&UnityRegistered_##name);                            \
+    }                                                                          \
+    void name(void)
+
+/* UNITY_TEST_CASE(func, (args)) registers the test "func(args)", which calls func with args.
+ * func must be declared before it, and a file can't have two cases of func on one line */
+#define UNITY_TEST_CASE(func, args) UNITY_TEST_CASE_AT(func, args, __LINE__)
+#define UNITY_TEST_CASE_AT(func, args, line) UNITY_TEST_CASE_AT_LINE(func, args, line)
+#define UNITY_TEST_CASE_AT_LINE(func, args, line)                              \
+    static void UnityCase_##func##_##line(void)                                \
+    {                                                                          \
+        func args;                                                             \
+    }                                                                          \
+    static UnityRegisteredTest UnityRegistered_##func##_##line =               \
+        { UnityCase_##func##_##line, #func #args, __FILE__, line, #args, NULL }; \
+    UNITY_REGISTER_CONSTRUCTOR(UnityRegister_##func##_##line)                  \
+    {                                                                          \
+        UnityRegisterTest(&UnityRegistered_##func##_##line);                   \
+    }
+
+/* UNITY_TEST_SETUP() { body } and UNITY_TEST_TEAR_DOWN() { body } run before and after each
+ * test registered by the same file */
+#define UNITY_TEST_SETUP()         UNITY_TEST_FIXTURE(UnitySetUp, UnitySetUp, NULL)
+#define UNITY_TEST_TEAR_DOWN()     UNITY_TEST_FIXTURE(UnityTearDown, NULL, UnityTearDown)
+#define UNITY_TEST_FIXTURE(func, set_up, tear_down)                            \
+    static void func(void);                                                    \
+    static UnityRegisteredFixture UnityRegistered_##func =                     \
+        { __FILE__, set_up, tear_down, NULL };                                 \
+    UNITY_REGISTER_CONSTRUCTOR(UnityRegister_##func)                           \
+    {                                                                          \
+        UnityRegisterFixture(&UnityRegistered_##func);                         \
+    }                                                                          \
+    static void func(void)
+
+void UnityRegisterTest(UnityRegisteredTest* test);
+void UnityRegisterFixture(UnityRegisteredFixture* fixture);
+
+/* The first registered test, the others follow through Next */
+const UnityRegisteredTest* UnityRegisteredTests(void);
+
+/* Runs the registered tests of one file, between UnityBegin(file) and UnityEnd() */
+int UnityRunRegisteredFile(const char* file);
+
+/* Runs all the registered tests, file by file, and returns the number of failures. With
+ * UNITY_USE_COMMAND_LINE_ARGS, argv takes the options of UnityParseOptions */
+int UnityRunRegisteredTests(int argc, char** argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
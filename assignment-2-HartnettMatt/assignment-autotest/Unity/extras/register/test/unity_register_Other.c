@@ -0,0 +1,28 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_register.h"
+
+/* A second file, with a setUp of its own */
+
+static int OtherSetUpCalls;
+static int OtherTestsRun;
+
+UNITY_TEST_SETUP()
+{
+    OtherSetUpCalls++;
+}
+
+UNITY_TEST(test_OtherFileRunsItsOwnSetUp)
+{
+    TEST_ASSERT_EQUAL_INT(++OtherTestsRun, OtherSetUpCalls);
+}
+
+UNITY_TEST(test_OtherFileRunsItsSetUpBeforeEachTest)
+{
+    TEST_ASSERT_EQUAL_INT(++OtherTestsRun, OtherSetUpCalls);
+}
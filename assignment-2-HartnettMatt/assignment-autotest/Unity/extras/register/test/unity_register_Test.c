@@ -0,0 +1,95 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_register.h"
+#include <string.h>
+
+static int SetUpCalls;
+static int TearDownCalls;
+
+UNITY_TEST_SETUP()
+{
+    SetUpCalls++;
+}
+
+UNITY_TEST_TEAR_DOWN()
+{
+    TearDownCalls++;
+}
+
+static const UnityRegisteredTest* FindTest(const char* name)
+{
+    const UnityRegisteredTest* test;
+    for (test = UnityRegisteredTests(); test != NULL; test = test->Next)
+    {
+        if (strcmp(test->Name, name) == 0)
+        {
+            return test;
+        }
+    }
+    return NULL;
+}
+
+UNITY_TEST(test_RegistersTestsInDefinitionOrder)
+{
+    const UnityRegisteredTest* test = FindTest("test_RegistersTestsInDefinitionOrder");
+
+    TEST_ASSERT_NOT_NULL(test);
+    TEST_ASSERT_TRUE(test->Func == test_RegistersTestsInDefinitionOrder);
+    TEST_ASSERT_EQUAL_STRING(__FILE__, test->File);
+    TEST_ASSERT_EQUAL_INT(__LINE__ - 7, test->Line);
+    TEST_ASSERT_NULL(test->Params);
+    TEST_ASSERT_NOT_NULL(test->Next);
+    TEST_ASSERT_EQUAL_STRING("test_SetUpAndTearDownRunAroundEachTest", test->Next->Name);
+}
+
+UNITY_TEST(test_SetUpAndTearDownRunAroundEachTest)
+{
+    TEST_ASSERT_EQUAL_INT(TearDownCalls + 1, SetUpCalls);
+}
+
+static void test_Add(int a, int b, int sum)
+{
+    TEST_ASSERT_EQUAL_INT(sum, a + b);
+}
+
+UNITY_TEST_CASE(test_Add, (1, 2, 3))
+UNITY_TEST_CASE(test_Add, (-4, 4, 0))
+
+UNITY_TEST(test_CasesAreNamedAfterTheirArguments)
+{
+    const UnityRegisteredTest* test = FindTest("test_Add(1, 2, 3)");
+
+    TEST_ASSERT_NOT_NULL(test);
+    TEST_ASSERT_EQUAL_STRING("(1, 2, 3)", test->Params);
+    TEST_ASSERT_EQUAL_INT(__LINE__ - 9, test->Line);
+    TEST_ASSERT_NOT_NULL(test->Next);
+    TEST_ASSERT_EQUAL_STRING("test_Add(-4, 4, 0)", test->Next->Name);
+    TEST_ASSERT_EQUAL_STRING("(-4, 4, 0)", test->Next->Params);
+}
+
+UNITY_TEST(test_TestsOfAFileStayTogether)
+{
+    const UnityRegisteredTest* test;
+    const char* files[4];
+    int count = 0;
+    int i;
+
+    for (test = UnityRegisteredTests(); test != NULL; test = test->Next)
+    {
+        if ((count == 0) || (strcmp(files[count - 1], test->File) != 0))
+        {
+            for (i = 0; i < count; i++)
+            {
+                TEST_ASSERT_TRUE_MESSAGE(strcmp(files[i], test->File) != 0, test->Name);
+            }
+            TEST_ASSERT_LESS_THAN_INT(4, count);
+            files[count++] = test->File;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(2, count);
+}
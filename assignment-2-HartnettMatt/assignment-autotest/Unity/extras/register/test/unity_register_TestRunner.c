@@ -0,0 +1,26 @@
+/* ==========================================
+ *  Unity Project - A Test Framework for C
+ *  Copyright (c) 2007 Mike Karlesky, Mark VanderVoord, Greg Williams
+ *  [Released under MIT License. Please refer to license.txt for details]
+ * ========================================== */
+
+#include "unity.h"
+#include "unity_register.h"
+
+/* The tests are found by their UNITY_TEST registrations, this is the whole runner */
+
+void setUp(void);
+void tearDown(void);
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char** argv)
+{
+    return UnityRunRegisteredTests(argc, argv);
+}
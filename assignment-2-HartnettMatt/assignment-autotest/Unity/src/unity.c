@@ -4,6 +4,11 @@
     [Released under MIT License. Please refer to license.txt for details]
 ============================================================================ */
 
+/* fork(), poll() and waitpid() for UNITY_ISOLATE_TESTS, also in strict C modes */
+#if defined(UNITY_ISOLATE_TESTS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "unity.h"
 #include <stddef.h>
 
@@ -13,6 +18,39 @@
 #define PROGMEM
 #endif
 
+#ifndef UNITY_EXCLUDE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef UNITY_ISOLATE_TESTS
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef UNITY_INCLUDE_REGEX
+#include <regex.h>
+#endif
+#endif
+
+/* Runs of printable characters are found 16 at a time where SSE2 is available */
+#if defined(__SSE2__) && !defined(UNITY_EXCLUDE_SIMD) && !defined(UNITY_EXCLUDE_STRING_H)
+#define UNITY_PRINT_SSE2
+#include <emmintrin.h>
+#endif
+
 /* If omitted from header, declare overrideable prototypes here so they're ready for use */
 #ifdef UNITY_OMIT_OUTPUT_CHAR_HEADER_DECLARATION
 void UNITY_OUTPUT_CHAR(int);
@@ -74,6 +112,111 @@ static const char PROGMEM UnityStrDetail2Name[]            = " " UNITY_DETAIL2_N
  * Pretty Printers & Test Result Output Handlers
  *-----------------------------------------------*/
 
+/*-----------------------------------------------*/
+/* Output sink. With UNITY_OUTPUT_BUFFERED the characters of a line are
+ * collected here and handed to UNITY_OUTPUT_WRITE together when the line
+ * ends (or the buffer fills), instead of one UNITY_OUTPUT_CHAR each. */
+#ifdef UNITY_OUTPUT_BUFFERED
+static char UnityOutputBuffer[UNITY_OUTPUT_BUFFER_SIZE];
+static UNITY_UINT32 UnityOutputLength;
+
+static void UnityOutputBufferedWrite(void)
+{
+    if (UnityOutputLength > 0)
+    {
+        UNITY_OUTPUT_WRITE(UnityOutputBuffer, UnityOutputLength);
+        UnityOutputLength = 0;
+    }
+}
+
+void UnityOutputBufferedChar(int c)
+{
+    UnityOutputBuffer[UnityOutputLength++] = (char)c;
+    if ((c == '\n') || (UnityOutputLength == sizeof(UnityOutputBuffer)))
+    {
+        UnityOutputBufferedWrite();
+    }
+}
+
+void UnityOutputBufferedFlush(void)
+{
+    UnityOutputBufferedWrite();
+#ifdef UNITY_USE_FLUSH_STDOUT
+    (void)fflush(stdout);
+#endif
+}
+
+/* Local helper function to output characters that need no escaping. */
+static void UnityOutputRun(const char* run, UNITY_UINT32 length)
+{
+    while (length > 0)
+    {
+        UNITY_UINT32 room = (UNITY_UINT32)sizeof(UnityOutputBuffer) - UnityOutputLength;
+        UNITY_UINT32 chunk = (length < room) ? length : room;
+
+#ifndef UNITY_EXCLUDE_STRING_H
+        memcpy(&UnityOutputBuffer[UnityOutputLength], run, chunk);
+        UnityOutputLength += chunk;
+        run += chunk;
+        length -= chunk;
+#else
+        length -= chunk;
+        while (chunk-- > 0)
+        {
+            UnityOutputBuffer[UnityOutputLength++] = *run++;
+        }
+#endif
+        if (UnityOutputLength == sizeof(UnityOutputBuffer))
+        {
+            UnityOutputBufferedWrite();
+        }
+    }
+}
+#else
+/* Local helper function to output characters that need no escaping. */
+static void UnityOutputRun(const char* run, UNITY_UINT32 length)
+{
+    while (length > 0)
+    {
+        UNITY_OUTPUT_CHAR(*run);
+        run++;
+        length--;
+    }
+}
+#endif
+
+/*-----------------------------------------------*/
+/* Local helper function to count the printable characters (32 to 126) at the
+ * start of string, looking at no more than length of them. */
+static UNITY_UINT32 UnityPrintableRun(const char* string, const UNITY_UINT32 length)
+{
+    UNITY_UINT32 count = 0;
+
+#ifdef UNITY_PRINT_SSE2
+    const __m128i below = _mm_set1_epi8(31);
+    const __m128i above = _mm_set1_epi8(127);
+
+    while (length - count >= 16)
+    {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(const void*)(string + count));
+        /* Signed compares, so 128 to 255 fail the first one */
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(chars, below), _mm_cmplt_epi8(chars, above));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(printable);
+
+        if (mask != 0xFFFFu)
+        {
+            return count + (UNITY_UINT32)__builtin_ctz(~mask);
+        }
+        count += 16;
+    }
+#endif
+    while ((count < length) && (string[count] <= 126) && (string[count] >= 32))
+    {
+        count++;
+    }
+    return count;
+}
+
 /*-----------------------------------------------*/
 /* Local helper function to print characters. */
 static void UnityPrintChar(const char* pch)
@@ -126,62 +269,74 @@ static UNITY_UINT UnityPrintAnsiEscapeString(const char* string)
 #endif
 
 /*-----------------------------------------------*/
-void UnityPrint(const char* string)
+/* Local helper function to print string[0..length), which holds no NUL,
+ * passing runs of printable characters to the output in one go. */
+static void UnityPrintEscaped(const char* string, const UNITY_UINT32 length, const int ansi)
 {
     const char* pch = string;
+    const char* end = string + length;
 
-    if (pch != NULL)
+    while (pch < end)
     {
-        while (*pch)
+        UNITY_UINT32 run = UnityPrintableRun(pch, (UNITY_UINT32)(end - pch));
+
+        if (run > 0)
         {
+            UnityOutputRun(pch, run);
+            pch += run;
+            continue;
+        }
 #ifdef UNITY_OUTPUT_COLOR
-            /* print ANSI escape code */
-            if ((*pch == 27) && (*(pch + 1) == '['))
-            {
-                pch += UnityPrintAnsiEscapeString(pch);
-                continue;
-            }
+        /* print ANSI escape code */
+        if (ansi && (*pch == 27) && (*(pch + 1) == '['))
+        {
+            pch += UnityPrintAnsiEscapeString(pch);
+            continue;
+        }
+#else
+        (void)ansi;
 #endif
-            UnityPrintChar(pch);
-            pch++;
+        UnityPrintChar(pch);
+        pch++;
+    }
+}
+
+/*-----------------------------------------------*/
+void UnityPrint(const char* string)
+{
+    if (string != NULL)
+    {
+#ifdef UNITY_PRINT_SSE2
+        UnityPrintEscaped(string, (UNITY_UINT32)strlen(string), 1);
+#else
+        UNITY_UINT32 length = 0;
+
+        while (string[length])
+        {
+            length++;
         }
+        UnityPrintEscaped(string, length, 1);
+#endif
     }
 }
 /*-----------------------------------------------*/
 void UnityPrintLen(const char* string, const UNITY_UINT32 length)
 {
-    const char* pch = string;
-
-    if (pch != NULL)
+    if (string != NULL)
     {
-        while (*pch && ((UNITY_UINT32)(pch - string) < length))
+#ifdef UNITY_PRINT_SSE2
+        const char* nul = (const char*)memchr(string, 0, length);
+
+        UnityPrintEscaped(string, (nul != NULL) ? (UNITY_UINT32)(nul - string) : length, 0);
+#else
+        UNITY_UINT32 count = 0;
+
+        while ((count < length) && string[count])
         {
-            /* printable characters plus CR & LF are printed */
-            if ((*pch <= 126) && (*pch >= 32))
-            {
-                UNITY_OUTPUT_CHAR(*pch);
-            }
-            /* write escaped carriage returns */
-            else if (*pch == 13)
-            {
-                UNITY_OUTPUT_CHAR('\\');
-                UNITY_OUTPUT_CHAR('r');
-            }
-            /* write escaped line feeds */
-            else if (*pch == 10)
-            {
-                UNITY_OUTPUT_CHAR('\\');
-                UNITY_OUTPUT_CHAR('n');
-            }
-            /* unprintable characters are shown as codes */
-            else
-            {
-                UNITY_OUTPUT_CHAR('\\');
-                UNITY_OUTPUT_CHAR('x');
-                UnityPrintNumberHex((UNITY_UINT)*pch, 2);
-            }
-            pch++;
+            count++;
         }
+        UnityPrintEscaped(string, count, 0);
+#endif
     }
 }
 
@@ -677,6 +832,58 @@ static int UnityIsOneArrayNull(UNITY_INTERNAL_PTR expected,
     return 0; /* return false if neither is NULL */
 }
 
+/*-----------------------------------------------*/
+/* Local helper function returning how many elements of size bytes at the
+ * start of actual are byte for byte equal to expected (or to the single
+ * expected element with UNITY_ARRAY_TO_VAL). They are compared a block at a
+ * time with memcmp, so equal arrays pass at memcmp speed, and the count may
+ * stop short of the first difference: the assertions check each element from
+ * there on as before, so their failure messages are unchanged. */
+#ifndef UNITY_EXCLUDE_STRING_H
+#ifndef UNITY_COMPARE_BLOCK
+#define UNITY_COMPARE_BLOCK 4096
+#endif
+static UNITY_UINT32 UnityEqualElements(UNITY_INTERNAL_PTR expected,
+                                       UNITY_INTERNAL_PTR actual,
+                                       const size_t size,
+                                       const UNITY_UINT32 num_elements,
+                                       const UNITY_FLAGS_T flags)
+{
+    const unsigned char* ref = (const unsigned char*)expected;
+    const unsigned char* act = (const unsigned char*)actual;
+    const size_t total = size * num_elements;
+    size_t lag = 0;
+    size_t done = 0;
+
+    if (flags == UNITY_ARRAY_TO_VAL)
+    {
+        /* Once the first element matches, each byte after it has to equal
+         * the one an element before it */
+        if (memcmp(ref, act, size) != 0)
+        {
+            return 0;
+        }
+        ref = act;
+        lag = size;
+        done = size;
+    }
+
+    while (done < total)
+    {
+        size_t block = ((total - done) < UNITY_COMPARE_BLOCK) ? (total - done) : UNITY_COMPARE_BLOCK;
+
+        if (memcmp(ref + (done - lag), act + done, block) != 0)
+        {
+            break;
+        }
+        done += block;
+    }
+    return (UNITY_UINT32)(done / size);
+}
+#else
+#define UnityEqualElements(expected, actual, size, num_elements, flags) 0
+#endif
+
 /*-----------------------------------------------
  * Assertion Functions
  *-----------------------------------------------*/
@@ -782,6 +989,7 @@ void UnityAssertEqualIntArray(UNITY_INTERNAL_PTR expected,
     UNITY_UINT32 elements  = num_elements;
     unsigned int length    = style & 0xF;
     unsigned int increment = 0;
+    UNITY_UINT32 skipped;
 
     RETURN_IF_FAIL_OR_IGNORE;
 
@@ -800,6 +1008,28 @@ void UnityAssertEqualIntArray(UNITY_INTERNAL_PTR expected,
         UNITY_FAIL_AND_BAIL;
     }
 
+    /* Skip the leading elements that are byte for byte equal */
+    switch (length)
+    {
+        case 1:
+        case 2:
+#ifdef UNITY_SUPPORT_64
+        case 8:
+#endif
+            break;
+
+        default:
+            length = 4;
+            break;
+    }
+    skipped = UnityEqualElements(expected, actual, length, elements, flags);
+    elements -= skipped;
+    if (flags == UNITY_ARRAY_TO_ARRAY)
+    {
+        expected = (UNITY_INTERNAL_PTR)((const char*)expected + (size_t)skipped * length);
+    }
+    actual = (UNITY_INTERNAL_PTR)((const char*)actual + (size_t)skipped * length);
+
     while ((elements > 0) && (elements--))
     {
         UNITY_INT expect_val;
@@ -911,6 +1141,9 @@ void UnityAssertEqualFloatArray(UNITY_PTR_ATTRIBUTE const UNITY_FLOAT* expected,
     UNITY_UINT32 elements = num_elements;
     UNITY_PTR_ATTRIBUTE const UNITY_FLOAT* ptr_expected = expected;
     UNITY_PTR_ATTRIBUTE const UNITY_FLOAT* ptr_actual = actual;
+#ifndef UNITY_NAN_NOT_EQUAL_NAN
+    UNITY_UINT32 skipped;
+#endif
 
     RETURN_IF_FAIL_OR_IGNORE;
 
@@ -929,6 +1162,19 @@ void UnityAssertEqualFloatArray(UNITY_PTR_ATTRIBUTE const UNITY_FLOAT* expected,
         UNITY_FAIL_AND_BAIL;
     }
 
+#ifndef UNITY_NAN_NOT_EQUAL_NAN
+    /* Skip the leading elements that are byte for byte equal, which are
+     * within any delta as long as NaN equals NaN */
+    skipped = UnityEqualElements((UNITY_INTERNAL_PTR)expected, (UNITY_INTERNAL_PTR)actual,
+                                 sizeof(UNITY_FLOAT), elements, flags);
+    elements -= skipped;
+    if (flags == UNITY_ARRAY_TO_ARRAY)
+    {
+        ptr_expected += skipped;
+    }
+    ptr_actual += skipped;
+#endif
+
     while (elements--)
     {
         if (!UnityFloatsWithin(*ptr_expected * UNITY_FLOAT_PRECISION, *ptr_expected, *ptr_actual))
@@ -1052,6 +1298,9 @@ void UnityAssertEqualDoubleArray(UNITY_PTR_ATTRIBUTE const UNITY_DOUBLE* expecte
     UNITY_UINT32 elements = num_elements;
     UNITY_PTR_ATTRIBUTE const UNITY_DOUBLE* ptr_expected = expected;
     UNITY_PTR_ATTRIBUTE const UNITY_DOUBLE* ptr_actual = actual;
+#ifndef UNITY_NAN_NOT_EQUAL_NAN
+    UNITY_UINT32 skipped;
+#endif
 
     RETURN_IF_FAIL_OR_IGNORE;
 
@@ -1070,6 +1319,19 @@ void UnityAssertEqualDoubleArray(UNITY_PTR_ATTRIBUTE const UNITY_DOUBLE* expecte
         UNITY_FAIL_AND_BAIL;
     }
 
+#ifndef UNITY_NAN_NOT_EQUAL_NAN
+    /* Skip the leading elements that are byte for byte equal, which are
+     * within any delta as long as NaN equals NaN */
+    skipped = UnityEqualElements((UNITY_INTERNAL_PTR)expected, (UNITY_INTERNAL_PTR)actual,
+                                 sizeof(UNITY_DOUBLE), elements, flags);
+    elements -= skipped;
+    if (flags == UNITY_ARRAY_TO_ARRAY)
+    {
+        ptr_expected += skipped;
+    }
+    ptr_actual += skipped;
+#endif
+
     while (elements--)
     {
         if (!UnityDoublesWithin(*ptr_expected * UNITY_DOUBLE_PRECISION, *ptr_expected, *ptr_actual))
@@ -1511,6 +1773,7 @@ void UnityAssertEqualMemory(UNITY_INTERNAL_PTR expected,
     UNITY_PTR_ATTRIBUTE const unsigned char* ptr_act = (UNITY_PTR_ATTRIBUTE const unsigned char*)actual;
     UNITY_UINT32 elements = num_elements;
     UNITY_UINT32 bytes;
+    UNITY_UINT32 skipped;
 
     RETURN_IF_FAIL_OR_IGNORE;
 
@@ -1529,6 +1792,15 @@ void UnityAssertEqualMemory(UNITY_INTERNAL_PTR expected,
         UNITY_FAIL_AND_BAIL;
     }
 
+    /* Skip the leading elements that are byte for byte equal */
+    skipped = UnityEqualElements(expected, actual, length, elements, flags);
+    elements -= skipped;
+    if (flags == UNITY_ARRAY_TO_ARRAY)
+    {
+        ptr_exp += (size_t)skipped * length;
+    }
+    ptr_act += (size_t)skipped * length;
+
     while (elements--)
     {
         bytes = length;
@@ -1820,97 +2092,896 @@ void UnityMessage(const char* msg, const UNITY_LINE_TYPE line)
     UNITY_PRINT_EOL();
 }
 
-/*-----------------------------------------------*/
-/* If we have not defined our own test runner, then include our default test runner to make life easier */
-#ifndef UNITY_SKIP_DEFAULT_RUNNER
-void UnityDefaultTestRun(UnityTestFunction Func, const char* FuncName, const int FuncLineNum)
+/*-----------------------------------------------
+ * Test Isolation
+ *-----------------------------------------------*/
+#ifdef UNITY_ISOLATE_TESTS
+
+/* From the isolated test to the runner, small enough for write() to send in one piece */
+struct UNITY_ISOLATE_MSG_T
 {
-    Unity.CurrentTestName = FuncName;
-    Unity.CurrentTestLineNumber = (UNITY_LINE_TYPE)FuncLineNum;
-    Unity.NumberOfTests++;
-    UNITY_CLR_DETAILS();
-    UNITY_EXEC_TIME_START();
-    if (TEST_PROTECT())
-    {
-        setUp();
-        Func();
-    }
-    if (TEST_PROTECT())
+    char Kind;                  /* 'T' for a new timeout, 'R' for the result */
+    UNITY_UINT32 Value;
+};
+
+#define UNITY_ISOLATE_PASSED  0
+#define UNITY_ISOLATE_FAILED  1
+#define UNITY_ISOLATE_IGNORED 2
+
+static UNITY_UINT32 UnityTestTimeoutMs = UNITY_TEST_TIMEOUT_MS;
+static int UnityIsolateFd = -1;   /* Pipe to the runner, in an isolated test only */
+static UNITY_COUNTER_TYPE UnityIsolateFailures;
+static UNITY_COUNTER_TYPE UnityIsolateIgnores;
+
+static void UnityIsolateSend(const char kind, const UNITY_UINT32 value)
+{
+    struct UNITY_ISOLATE_MSG_T msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.Kind = kind;
+    msg.Value = value;
+    while ((write(UnityIsolateFd, &msg, sizeof(msg)) < 0) && (errno == EINTR))
     {
-        tearDown();
     }
-    UNITY_EXEC_TIME_STOP();
-    UnityConcludeTest();
 }
-#endif
 
-/*-----------------------------------------------*/
-void UnitySetTestFile(const char* filename)
+void UnitySetTestTimeout(const UNITY_UINT32 ms)
 {
-	Unity.TestFile = filename;
+    if (UnityIsolateFd >= 0)
+    {
+        UnityIsolateSend('T', ms);
+    }
+    else
+    {
+        UnityTestTimeoutMs = ms;
+    }
 }
 
-/*-----------------------------------------------*/
-void UnityBegin(const char* filename)
+static UNITY_UINT32 UnityIsolateElapsedMs(const struct timespec* start)
 {
-    Unity.TestFile = filename;
-    Unity.CurrentTestName = NULL;
-    Unity.CurrentTestLineNumber = 0;
-    Unity.NumberOfTests = 0;
-    Unity.TestFailures = 0;
-    Unity.TestIgnores = 0;
-    Unity.CurrentTestFailed = 0;
-    Unity.CurrentTestIgnored = 0;
+    struct timespec now;
 
-    UNITY_CLR_DETAILS();
-    UNITY_OUTPUT_START();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UNITY_UINT32)((now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000);
 }
 
-/*-----------------------------------------------*/
-int UnityEnd(void)
+/* Copies what the isolated test wrote to stdout. Returns 1 after copying some, -1 if there was
+ * nothing to copy yet and 0 at the end. *at_eol tells if the last byte copied was a newline */
+static int UnityIsolateRelay(const int fd, int* at_eol)
 {
-    UNITY_PRINT_EOL();
-    UnityPrint(UnityStrBreaker);
-    UNITY_PRINT_EOL();
-    UnityPrintNumber((UNITY_INT)(Unity.NumberOfTests));
-    UnityPrint(UnityStrResultsTests);
-    UnityPrintNumber((UNITY_INT)(Unity.TestFailures));
-    UnityPrint(UnityStrResultsFailures);
-    UnityPrintNumber((UNITY_INT)(Unity.TestIgnores));
-    UnityPrint(UnityStrResultsIgnored);
-    UNITY_PRINT_EOL();
-    if (Unity.TestFailures == 0U)
+    char buf[512];
+    ssize_t len;
+    ssize_t done;
+    ssize_t n;
+
+    len = read(fd, buf, sizeof(buf));
+    if (len < 0)
     {
-        UnityPrint(UnityStrOk);
+        return ((errno == EINTR) || (errno == EAGAIN)) ? -1 : 0;
     }
-    else
+    for (done = 0; done < len; done += (n > 0) ? n : 0)
     {
-        UnityPrint(UnityStrFail);
-#ifdef UNITY_DIFFERENTIATE_FINAL_FAIL
-        UNITY_OUTPUT_CHAR('E'); UNITY_OUTPUT_CHAR('D');
-#endif
+        n = write(STDOUT_FILENO, buf + done, (size_t)(len - done));
+        if ((n < 0) && (errno != EINTR))
+        {
+            break;
+        }
     }
-    UNITY_PRINT_EOL();
-    UNITY_FLUSH_CALL();
-    UNITY_OUTPUT_COMPLETE();
-    return (int)(Unity.TestFailures);
+    if (len > 0)
+    {
+        *at_eol = (buf[len - 1] == '\n');
+    }
+    return len > 0;
 }
 
-/*-----------------------------------------------
- * Command Line Argument Support
- *-----------------------------------------------*/
-#ifdef UNITY_USE_COMMAND_LINE_ARGS
-
-char* UnityOptionIncludeNamed = NULL;
-char* UnityOptionExcludeNamed = NULL;
-int UnityVerbosity            = 1;
+/* Fail the test from the runner's side, for a test that couldn't report itself. Its own output
+ * may have stopped in the middle of a line */
+static void UnityIsolateFailBegin(const int at_eol)
+{
+    if (!at_eol)
+    {
+        UNITY_PRINT_EOL();
+    }
+    UnityTestResultsFailBegin(Unity.CurrentTestLineNumber);
+    UNITY_OUTPUT_CHAR(' ');
+}
 
-/*-----------------------------------------------*/
-int UnityParseOptions(int argc, char** argv)
+static void UnityIsolateFailEnd(void)
 {
-    int i;
-    UnityOptionIncludeNamed = NULL;
-    UnityOptionExcludeNamed = NULL;
+    Unity.CurrentTestFailed = 1;
+    UnityConcludeTest();
+}
+
+/* Returns 0 in a new process, which runs the test and then calls UnityIsolateEnd(). The runner waits
+ * for its result there, failing the test if it crashes or runs out of time, and gets 1. The test's
+ * stdout goes through the runner, so it knows whether a failure it reports starts a new line. */
+int UnityIsolateBegin(void)
+{
+    struct UNITY_ISOLATE_MSG_T msg;
+    struct timespec start;
+    UNITY_UINT32 timeout = UnityTestTimeoutMs;
+    UNITY_UINT32 result = UNITY_ISOLATE_FAILED;
+    int fds[2];
+    int out[2];
+    int status = 0;
+    int reported = 0;
+    int timed_out = 0;
+    int at_eol = 1;
+    pid_t pid;
+
+    /* Whatever is still buffered would be written by both processes */
+    UNITY_OUTPUT_FLUSH();
+    (void)fflush(stdout);
+    if (pipe(fds) != 0)
+    {
+        UnityIsolateFailBegin(at_eol);
+        UnityPrint("Could not isolate the test, pipe() failed with errno ");
+        UnityPrintNumber(errno);
+        UnityIsolateFailEnd();
+        return 1;
+    }
+    if (pipe(out) != 0)
+    {
+        int error = errno;
+        close(fds[0]);
+        close(fds[1]);
+        UnityIsolateFailBegin(at_eol);
+        UnityPrint("Could not isolate the test, pipe() failed with errno ");
+        UnityPrintNumber(error);
+        UnityIsolateFailEnd();
+        return 1;
+    }
+    pid = fork();
+    if (pid < 0)
+    {
+        int error = errno;
+        close(fds[0]);
+        close(fds[1]);
+        close(out[0]);
+        close(out[1]);
+        UnityIsolateFailBegin(at_eol);
+        UnityPrint("Could not isolate the test, fork() failed with errno ");
+        UnityPrintNumber(error);
+        UnityIsolateFailEnd();
+        return 1;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        close(out[0]);
+        (void)dup2(out[1], STDOUT_FILENO);
+        close(out[1]);
+        UnityIsolateFd = fds[1];
+        UnityIsolateFailures = Unity.TestFailures;
+        UnityIsolateIgnores = Unity.TestIgnores;
+        return 0;
+    }
+
+    close(fds[1]);
+    close(out[1]);
+    /* Something the test started may keep the output open after it ends */
+    (void)fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;)
+    {
+        struct pollfd pfd[2];
+        int wait = -1;
+        int ready;
+
+        if (timeout != 0)
+        {
+            UNITY_UINT32 elapsed = UnityIsolateElapsedMs(&start);
+            if (elapsed >= timeout)
+            {
+                timed_out = 1;
+                break;
+            }
+            wait = (int)(timeout - elapsed);
+        }
+        pfd[0].fd = fds[0];
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = out[0];
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        ready = poll(pfd, (out[0] >= 0) ? 2 : 1, wait);
+        if (ready == 0 || (ready < 0 && errno == EINTR))
+        {
+            continue;
+        }
+        if ((ready > 0) && (out[0] >= 0) && (pfd[1].revents != 0))
+        {
+            if (UnityIsolateRelay(out[0], &at_eol) == 0)
+            {
+                close(out[0]);
+                out[0] = -1;
+            }
+            if (pfd[0].revents == 0)
+            {
+                continue;
+            }
+        }
+        /* The test ended without a result (or poll() failed): waitpid() tells how */
+        if (ready < 0 || read(fds[0], &msg, sizeof(msg)) != (ssize_t)sizeof(msg))
+        {
+            break;
+        }
+        if (msg.Kind == 'T')
+        {
+            timeout = msg.Value;
+        }
+        else
+        {
+            result = msg.Value;
+            reported = 1;
+            break;
+        }
+    }
+    if (timed_out)
+    {
+        kill(pid, SIGKILL);
+    }
+    close(fds[0]);
+    while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR))
+    {
+    }
+    /* The rest of the test's output, up to what is in the pipe now */
+    if (out[0] >= 0)
+    {
+        while (UnityIsolateRelay(out[0], &at_eol) > 0)
+        {
+        }
+        close(out[0]);
+    }
+
+    if (timed_out)
+    {
+        UnityIsolateFailBegin(at_eol);
+        UnityPrint("Timed out after ");
+        UnityPrintNumberUnsigned(timeout);
+        UnityPrint(" ms");
+        UnityIsolateFailEnd();
+    }
+    else if (reported)
+    {
+        /* The test printed its own result */
+        if (result == UNITY_ISOLATE_FAILED)
+        {
+            Unity.TestFailures++;
+        }
+        else if (result == UNITY_ISOLATE_IGNORED)
+        {
+            Unity.TestIgnores++;
+        }
+    }
+    else if (WIFSIGNALED(status))
+    {
+        UnityIsolateFailBegin(at_eol);
+        UnityPrint("Killed by signal ");
+        UnityPrintNumber(WTERMSIG(status));
+        UnityPrint(" (");
+        UnityPrint(strsignal(WTERMSIG(status)));
+        UNITY_OUTPUT_CHAR(')');
+        UnityIsolateFailEnd();
+    }
+    else
+    {
+        UnityIsolateFailBegin(at_eol);
+        UnityPrint("Exited with status ");
+        UnityPrintNumber(WEXITSTATUS(status));
+        UnityPrint(" before the test finished");
+        UnityIsolateFailEnd();
+    }
+    return 1;
+}
+
+/* Reports the result of the isolated test to the runner and ends its process */
+void UnityIsolateEnd(void)
+{
+    UNITY_UINT32 result = UNITY_ISOLATE_PASSED;
+
+    if (UnityIsolateFd < 0)
+    {
+        return;
+    }
+    if (Unity.TestFailures != UnityIsolateFailures)
+    {
+        result = UNITY_ISOLATE_FAILED;
+    }
+    else if (Unity.TestIgnores != UnityIsolateIgnores)
+    {
+        result = UNITY_ISOLATE_IGNORED;
+    }
+    UNITY_OUTPUT_FLUSH();
+    (void)fflush(stdout);
+    UnityIsolateSend('R', result);
+    _exit(0);
+}
+#endif
+
+/*-----------------------------------------------*/
+/* If we have not defined our own test runner, then include our default test runner to make life easier */
+#ifndef UNITY_SKIP_DEFAULT_RUNNER
+void UnityDefaultTestRun(UnityTestFunction Func, const char* FuncName, const int FuncLineNum)
+{
+    Unity.CurrentTestName = FuncName;
+    Unity.CurrentTestLineNumber = (UNITY_LINE_TYPE)FuncLineNum;
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_ISOLATE_BEGIN();
+    UNITY_EXEC_TIME_START();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        Func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+    }
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+    UNITY_ISOLATE_END();
+}
+#endif
+
+/*-----------------------------------------------*/
+void UnitySetTestFile(const char* filename)
+{
+	Unity.TestFile = filename;
+}
+
+/*-----------------------------------------------*/
+void UnityBegin(const char* filename)
+{
+    Unity.TestFile = filename;
+    Unity.CurrentTestName = NULL;
+    Unity.CurrentTestLineNumber = 0;
+    Unity.NumberOfTests = 0;
+    Unity.TestFailures = 0;
+    Unity.TestIgnores = 0;
+    Unity.CurrentTestFailed = 0;
+    Unity.CurrentTestIgnored = 0;
+
+    UNITY_CLR_DETAILS();
+    UNITY_OUTPUT_START();
+}
+
+/*-----------------------------------------------*/
+int UnityEnd(void)
+{
+    UNITY_PRINT_EOL();
+    UnityPrint(UnityStrBreaker);
+    UNITY_PRINT_EOL();
+    UnityPrintNumber((UNITY_INT)(Unity.NumberOfTests));
+    UnityPrint(UnityStrResultsTests);
+    UnityPrintNumber((UNITY_INT)(Unity.TestFailures));
+    UnityPrint(UnityStrResultsFailures);
+    UnityPrintNumber((UNITY_INT)(Unity.TestIgnores));
+    UnityPrint(UnityStrResultsIgnored);
+    UNITY_PRINT_EOL();
+    if (Unity.TestFailures == 0U)
+    {
+        UnityPrint(UnityStrOk);
+    }
+    else
+    {
+        UnityPrint(UnityStrFail);
+#ifdef UNITY_DIFFERENTIATE_FINAL_FAIL
+        UNITY_OUTPUT_CHAR('E'); UNITY_OUTPUT_CHAR('D');
+#endif
+    }
+    UNITY_PRINT_EOL();
+    UNITY_FLUSH_CALL();
+    UNITY_OUTPUT_COMPLETE();
+    return (int)(Unity.TestFailures);
+}
+
+/*-----------------------------------------------
+ * Command Line Argument Support
+ *-----------------------------------------------*/
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+
+int UnityVerbosity            = 1;
+
+static struct
+{
+    UNITY_UINT32 ShardIndex;   /* 1 based, 0 when not sharding */
+    UNITY_UINT32 ShardCount;
+    int Shuffle;
+    UNITY_UINT32 Seed;
+    UNITY_UINT32 Random;       /* State of the shuffle, 0 until the first shuffle */
+    int ByDuration;
+    const char* DurationsFile;
+} UnitySchedule;
+
+/*-----------------------------------------------*/
+static int UnityParseNumber(const char** str, UNITY_UINT32* number)
+{
+    const char* ptr = *str;
+    UNITY_UINT32 n = 0;
+
+    if ((*ptr < '0') || (*ptr > '9'))
+    {
+        return 0;
+    }
+    while ((*ptr >= '0') && (*ptr <= '9'))
+    {
+        n = (n * 10) + (UNITY_UINT32)(*ptr++ - '0');
+    }
+    *str = ptr;
+    *number = n;
+    return 1;
+}
+
+/*-----------------------------------------------*/
+/* Parses one of the long options of UnityScheduleTests, or resets them all when option is
+ * NULL. Returns 0 when done, 1 on a bad value and -1 if the option isn't one of them. */
+int UnityParseScheduleOption(const char* option)
+{
+    const char* ptr;
+
+    if (option == NULL)
+    {
+        memset(&UnitySchedule, 0, sizeof(UnitySchedule));
+        UnitySchedule.DurationsFile = UNITY_DURATIONS_FILE;
+        return 0;
+    }
+
+    if (strncmp(option, "--shard=", 8) == 0)
+    {
+        ptr = &option[8];
+        if (!UnityParseNumber(&ptr, &UnitySchedule.ShardIndex) || (*ptr++ != '/') ||
+            !UnityParseNumber(&ptr, &UnitySchedule.ShardCount) || (*ptr != 0) ||
+            (UnitySchedule.ShardIndex < 1) || (UnitySchedule.ShardIndex > UnitySchedule.ShardCount))
+        {
+            UnitySchedule.ShardCount = 0;
+            UnityPrint("ERROR: Expected --shard=i/N with 1 <= i <= N");
+            UNITY_PRINT_EOL();
+            return 1;
+        }
+        return 0;
+    }
+    if (strcmp(option, "--shuffle") == 0)
+    {
+        UnitySchedule.Shuffle = 1;
+        UnitySchedule.Seed = (UNITY_UINT32)time(NULL);
+        return 0;
+    }
+    if (strncmp(option, "--shuffle=", 10) == 0)
+    {
+        ptr = &option[10];
+        if (!UnityParseNumber(&ptr, &UnitySchedule.Seed) || (*ptr != 0))
+        {
+            UnityPrint("ERROR: Expected a number in --shuffle=seed");
+            UNITY_PRINT_EOL();
+            return 1;
+        }
+        UnitySchedule.Shuffle = 1;
+        return 0;
+    }
+    if (strncmp(option, "--order=", 8) == 0)
+    {
+        if (strcmp(&option[8], "duration") == 0)
+        {
+            UnitySchedule.ByDuration = 1;
+        }
+        else if (strcmp(&option[8], "declared") == 0)
+        {
+            UnitySchedule.ByDuration = 0;
+        }
+        else
+        {
+            UnityPrint("ERROR: Expected --order=duration or --order=declared");
+            UNITY_PRINT_EOL();
+            return 1;
+        }
+        return 0;
+    }
+    if ((strncmp(option, "--durations=", 12) == 0) && (option[12] != 0))
+    {
+        UnitySchedule.DurationsFile = &option[12];
+        return 0;
+    }
+    return -1;
+}
+
+/*-----------------------------------------------
+ * Test Name Filters
+ *-----------------------------------------------*/
+
+/* The patterns of -n and -x are compiled once, when the options are parsed, so that a test
+ * is checked against each of them in a single pass over its name. A glob is split at its
+ * '*'s into segments, each found with the bit-parallel Shift-And search: a segment of m
+ * characters has, for every byte, a mask of the positions it may stand at, and the state
+ * is ceil(m / 32) words. '?' may stand anywhere. */
+typedef struct
+{
+    UNITY_UINT32 Words;
+    UNITY_UINT32 Last;          /* Bit of the segment's last position in its last word */
+    UNITY_UINT32* Masks;        /* Words masks for each of the 256 bytes */
+} UnityGlobSegment;
+
+typedef struct
+{
+    UnityGlobSegment* Segments;
+    UNITY_UINT32 Count;
+    UNITY_UINT32* State;        /* Words of the longest segment */
+#ifdef UNITY_INCLUDE_REGEX
+    int IsRegex;
+    regex_t Regex;
+#endif
+} UnityNamePattern;
+
+/* "file:test" needs both to match, a pattern without a file may match either */
+typedef struct
+{
+    UnityNamePattern File;
+    UnityNamePattern Test;
+    int Qualified;
+    const char* LastFile;       /* Tests come a file at a time, so the file's match is kept */
+    int LastFileMatched;
+} UnityNameFilter;
+
+typedef struct
+{
+    UnityNameFilter* Filters;
+    UNITY_UINT32 Count;
+    UNITY_UINT32 Size;
+} UnityNameFilterList;
+
+static UnityNameFilterList UnityIncludeFilters;
+static UnityNameFilterList UnityExcludeFilters;
+
+/*-----------------------------------------------*/
+static void UnityFreePattern(UnityNamePattern* pattern)
+{
+    UNITY_UINT32 i;
+
+#ifdef UNITY_INCLUDE_REGEX
+    if (pattern->IsRegex)
+    {
+        regfree(&pattern->Regex);
+    }
+#endif
+    for (i = 0; i < pattern->Count; i++)
+    {
+        free(pattern->Segments[i].Masks);
+    }
+    free(pattern->Segments);
+    free(pattern->State);
+    memset(pattern, 0, sizeof(UnityNamePattern));
+}
+
+/*-----------------------------------------------*/
+static int UnityCompileGlob(UnityNamePattern* pattern, const char* start, const char* end)
+{
+    const char* ptr;
+    const char* segment;
+    UnityGlobSegment* seg;
+    UNITY_UINT32 length;
+    UNITY_UINT32 words = 1;
+    UNITY_UINT32 i;
+    unsigned int c;
+
+    for (ptr = start; ptr < end; ptr++)
+    {
+        if ((*ptr != '*') && ((ptr + 1 == end) || (ptr[1] == '*')))
+        {
+            pattern->Count++;
+        }
+    }
+    if (pattern->Count > 0)
+    {
+        pattern->Segments = (UnityGlobSegment*)calloc(pattern->Count, sizeof(UnityGlobSegment));
+        if (pattern->Segments == NULL)
+        {
+            pattern->Count = 0;
+            return 1;
+        }
+    }
+
+    seg = pattern->Segments;
+    for (ptr = start; ptr < end; )
+    {
+        if (*ptr == '*')
+        {
+            ptr++;
+            continue;
+        }
+        for (segment = ptr; (ptr < end) && (*ptr != '*'); ptr++)
+        {
+        }
+        length = (UNITY_UINT32)(ptr - segment);
+        seg->Words = (length + 31) / 32;
+        seg->Last = (UNITY_UINT32)1 << ((length - 1) % 32);
+        seg->Masks = (UNITY_UINT32*)calloc(256 * seg->Words, sizeof(UNITY_UINT32));
+        if (seg->Masks == NULL)
+        {
+            return 1;
+        }
+        for (i = 0; i < length; i++)
+        {
+            if (segment[i] == '?')
+            {
+                for (c = 0; c < 256; c++)
+                {
+                    seg->Masks[(c * seg->Words) + (i / 32)] |= (UNITY_UINT32)1 << (i % 32);
+                }
+            }
+            else
+            {
+                c = (unsigned char)segment[i];
+                seg->Masks[(c * seg->Words) + (i / 32)] |= (UNITY_UINT32)1 << (i % 32);
+            }
+        }
+        if (seg->Words > words)
+        {
+            words = seg->Words;
+        }
+        seg++;
+    }
+
+    pattern->State = (UNITY_UINT32*)malloc(words * sizeof(UNITY_UINT32));
+    return (pattern->State == NULL);
+}
+
+/*-----------------------------------------------*/
+#ifdef UNITY_INCLUDE_REGEX
+static int UnityCompileRegex(UnityNamePattern* pattern, const char* start, const char* end)
+{
+    char* expression = (char*)malloc((size_t)(end - start) + 1);
+    char message[128];
+    char* out = expression;
+    int status;
+
+    if (expression == NULL)
+    {
+        return 1;
+    }
+    /* Between the slashes, with "\/" for a slash */
+    for (start++, end--; start < end; start++)
+    {
+        if ((start[0] == '\\') && (start[1] == '/'))
+        {
+            start++;
+        }
+        *out++ = *start;
+    }
+    *out = 0;
+
+    status = regcomp(&pattern->Regex, expression, REG_EXTENDED | REG_NOSUB);
+    if (status != 0)
+    {
+        regerror(status, &pattern->Regex, message, sizeof(message));
+        UnityPrint("ERROR: Bad Regular Expression ");
+        UnityPrint(expression);
+        UnityPrint(", ");
+        UnityPrint(message);
+        UNITY_PRINT_EOL();
+    }
+    else
+    {
+        pattern->IsRegex = 1;
+    }
+    free(expression);
+    return (status != 0);
+}
+#endif
+
+/*-----------------------------------------------*/
+/* A pattern is a glob, or a POSIX extended regular expression between slashes */
+static int UnityCompilePattern(UnityNamePattern* pattern, const char* start, const char* end)
+{
+    if ((end - start >= 2) && (*start == '/') && (end[-1] == '/'))
+    {
+#ifdef UNITY_INCLUDE_REGEX
+        return UnityCompileRegex(pattern, start, end);
+#else
+        UnityPrint("ERROR: Regular Expressions Need UNITY_INCLUDE_REGEX");
+        UNITY_PRINT_EOL();
+        return 1;
+#endif
+    }
+    if (UnityCompileGlob(pattern, start, end))
+    {
+        UnityPrint("ERROR: Out Of Memory For Test Name Filters");
+        UNITY_PRINT_EOL();
+        return 1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------*/
+static int UnityPatternMatches(const UnityNamePattern* pattern, const char* str)
+{
+    const UnityGlobSegment* seg;
+    const UNITY_UINT32* mask;
+    UNITY_UINT32* state = pattern->State;
+    UNITY_UINT32 carry;
+    UNITY_UINT32 next;
+    UNITY_UINT32 i;
+    UNITY_UINT32 w;
+    int found;
+
+#ifdef UNITY_INCLUDE_REGEX
+    if (pattern->IsRegex)
+    {
+        return regexec(&pattern->Regex, str, 0, NULL, 0) == 0;
+    }
+#endif
+
+    /* Each segment is matched at its first place after the one before, which is right for
+     * globs that aren't anchored, so the name is read once whatever the pattern */
+    for (i = 0; i < pattern->Count; i++)
+    {
+        seg = &pattern->Segments[i];
+        found = 0;
+        if (seg->Words == 1)
+        {
+            /* Segments of up to 32 characters, nearly all of them, in a register */
+            next = 0;
+            while (*str && !found)
+            {
+                next = (((next << 1) & 0xFFFFFFFFu) | 1) & seg->Masks[(unsigned char)*str++];
+                found = (next & seg->Last) != 0;
+            }
+            if (!found)
+            {
+                return 0;
+            }
+            continue;
+        }
+
+        memset(state, 0, seg->Words * sizeof(UNITY_UINT32));
+        while (*str && !found)
+        {
+            mask = &seg->Masks[(unsigned char)*str++ * seg->Words];
+            carry = 1;
+            for (w = 0; w < seg->Words; w++)
+            {
+                next = (state[w] >> 31) & 1;
+                state[w] = (((state[w] << 1) & 0xFFFFFFFFu) | carry) & mask[w];
+                carry = next;
+            }
+            found = (state[seg->Words - 1] & seg->Last) != 0;
+        }
+        if (!found)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*-----------------------------------------------*/
+static void UnityFreeNameFilters(UnityNameFilterList* list)
+{
+    UNITY_UINT32 i;
+
+    for (i = 0; i < list->Count; i++)
+    {
+        UnityFreePattern(&list->Filters[i].File);
+        UnityFreePattern(&list->Filters[i].Test);
+    }
+    free(list->Filters);
+    memset(list, 0, sizeof(UnityNameFilterList));
+}
+
+/*-----------------------------------------------*/
+/* Adds the comma separated patterns of an -n or -x option to list. Quotes around them are
+ * dropped, and a regular expression runs to its closing slash, commas and all. */
+static int UnityAddNameFilters(UnityNameFilterList* list, const char* option)
+{
+    const char* ptr = option;
+    const char* start;
+    const char* colon;
+    UnityNameFilter* filter;
+    UnityNameFilter* filters;
+    int failed;
+
+    while (*ptr)
+    {
+        if ((*ptr == ',') || (*ptr == '"') || (*ptr == '\''))
+        {
+            ptr++;
+            continue;
+        }
+
+        start = ptr;
+        colon = NULL;
+        while (*ptr && (*ptr != ',') && (*ptr != '"') && (*ptr != '\''))
+        {
+            if ((*ptr == '/') && ((ptr == start) || ((colon != NULL) && (ptr == colon + 1))))
+            {
+                for (ptr++; *ptr && (*ptr != '/'); ptr++)
+                {
+                    if ((*ptr == '\\') && (ptr[1] != 0))
+                    {
+                        ptr++;
+                    }
+                }
+                if (*ptr == 0)
+                {
+                    UnityPrint("ERROR: No Closing Slash In ");
+                    UnityPrint(start);
+                    UNITY_PRINT_EOL();
+                    return 1;
+                }
+            }
+            else if ((*ptr == ':') && (colon == NULL))
+            {
+                colon = ptr;
+            }
+            ptr++;
+        }
+
+        if (list->Count == list->Size)
+        {
+            list->Size = list->Size ? (list->Size * 2) : 4;
+            filters = (UnityNameFilter*)realloc(list->Filters, list->Size * sizeof(UnityNameFilter));
+            if (filters == NULL)
+            {
+                UnityPrint("ERROR: Out Of Memory For Test Name Filters");
+                UNITY_PRINT_EOL();
+                return 1;
+            }
+            list->Filters = filters;
+        }
+        filter = &list->Filters[list->Count];
+        memset(filter, 0, sizeof(UnityNameFilter));
+        if (colon != NULL)
+        {
+            filter->Qualified = 1;
+            failed = UnityCompilePattern(&filter->File, start, colon) ||
+                     UnityCompilePattern(&filter->Test, colon + 1, ptr);
+        }
+        else
+        {
+            failed = UnityCompilePattern(&filter->Test, start, ptr);
+        }
+        if (failed)
+        {
+            UnityFreePattern(&filter->File);
+            UnityFreePattern(&filter->Test);
+            return 1;
+        }
+        list->Count++;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------*/
+static int UnityNameFiltersMatch(UnityNameFilterList* list)
+{
+    UnityNameFilter* filter;
+    UNITY_UINT32 i;
+
+    for (i = 0; i < list->Count; i++)
+    {
+        filter = &list->Filters[i];
+        if (filter->LastFile != Unity.TestFile)
+        {
+            filter->LastFile = Unity.TestFile;
+            filter->LastFileMatched = (Unity.TestFile != NULL) &&
+                UnityPatternMatches(filter->Qualified ? &filter->File : &filter->Test, Unity.TestFile);
+        }
+        if (filter->Qualified ? (filter->LastFileMatched && UnityPatternMatches(&filter->Test, Unity.CurrentTestName))
+                              : (filter->LastFileMatched || UnityPatternMatches(&filter->Test, Unity.CurrentTestName)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------*/
+int UnityParseOptions(int argc, char** argv)
+{
+    int i;
+    UnityFreeNameFilters(&UnityIncludeFilters);
+    UnityFreeNameFilters(&UnityExcludeFilters);
+    UnityParseScheduleOption(NULL);
 
     for (i = 1; i < argc; i++)
     {
@@ -1918,17 +2989,37 @@ int UnityParseOptions(int argc, char** argv)
         {
             switch (argv[i][1])
             {
+                case '-': /* --shard, --shuffle, --order and --durations */
+                    switch (UnityParseScheduleOption(argv[i]))
+                    {
+                        case 0:
+                            break;
+                        case 1:
+                            return 1;
+                        default:
+                            UnityPrint("ERROR: Unknown Option ");
+                            UnityPrint(argv[i]);
+                            UNITY_PRINT_EOL();
+                            return 1;
+                    }
+                    break;
                 case 'l': /* list tests */
                     return -1;
-                case 'n': /* include tests with name including this string */
+                case 'n': /* include tests with name matching these patterns */
                 case 'f': /* an alias for -n */
                     if (argv[i][2] == '=')
                     {
-                        UnityOptionIncludeNamed = &argv[i][3];
+                        if (UnityAddNameFilters(&UnityIncludeFilters, &argv[i][3]))
+                        {
+                            return 1;
+                        }
                     }
                     else if (++i < argc)
                     {
-                        UnityOptionIncludeNamed = argv[i];
+                        if (UnityAddNameFilters(&UnityIncludeFilters, argv[i]))
+                        {
+                            return 1;
+                        }
                     }
                     else
                     {
@@ -1943,14 +3034,20 @@ int UnityParseOptions(int argc, char** argv)
                 case 'v': /* verbose */
                     UnityVerbosity = 2;
                     break;
-                case 'x': /* exclude tests with name including this string */
+                case 'x': /* exclude tests with name matching these patterns */
                     if (argv[i][2] == '=')
                     {
-                        UnityOptionExcludeNamed = &argv[i][3];
+                        if (UnityAddNameFilters(&UnityExcludeFilters, &argv[i][3]))
+                        {
+                            return 1;
+                        }
                     }
                     else if (++i < argc)
                     {
-                        UnityOptionExcludeNamed = argv[i];
+                        if (UnityAddNameFilters(&UnityExcludeFilters, argv[i]))
+                        {
+                            return 1;
+                        }
                     }
                     else
                     {
@@ -1972,137 +3069,277 @@ int UnityParseOptions(int argc, char** argv)
 }
 
 /*-----------------------------------------------*/
-int IsStringInBiggerString(const char* longstring, const char* shortstring)
+int UnityTestMatches(void)
+{
+    /* Included by any -n pattern, when there are some, and excluded by any -x pattern */
+    if ((UnityIncludeFilters.Count > 0) && !UnityNameFiltersMatch(&UnityIncludeFilters))
+    {
+        return 0;
+    }
+    return !UnityNameFiltersMatch(&UnityExcludeFilters);
+}
+
+/*-----------------------------------------------
+ * Sharding and Ordering of Tests
+ *-----------------------------------------------*/
+
+typedef struct
+{
+    UNITY_UINT32 Hash;
+    UNITY_UINT32 Index;
+} UnityScheduleSlot;
+
+typedef struct
 {
-    const char* lptr = longstring;
-    const char* sptr = shortstring;
-    const char* lnext = lptr;
+    double Ns;
+    int Known;
+    UNITY_UINT32 Index;
+} UnityScheduleTiming;
 
-    if (*sptr == '*')
+/*-----------------------------------------------*/
+/* FNV-1a, so that a test lands in the same shard on every machine and in every build */
+static UNITY_UINT32 UnityHashString(UNITY_UINT32 hash, const char* str)
+{
+    while (*str)
     {
-        return 1;
+        hash ^= (UNITY_UINT32)(unsigned char)*str++;
+        hash = (hash * 16777619u) & 0xFFFFFFFFu;
     }
+    return hash;
+}
+
+/*-----------------------------------------------*/
+static UNITY_UINT32 UnityHashTest(const UnityTestEntry* test)
+{
+    UNITY_UINT32 hash = 2166136261u;
 
-    while (*lptr)
+    if (test->Group != NULL)
     {
-        lnext = lptr + 1;
+        hash = UnityHashString(hash, test->Group);
+        hash = UnityHashString(hash, ".");
+    }
+    return UnityHashString(hash, test->Name);
+}
 
-        /* If they current bytes match, go on to the next bytes */
-        while (*lptr && *sptr && (*lptr == *sptr))
-        {
-            lptr++;
-            sptr++;
+/*-----------------------------------------------*/
+/* xorshift32, plenty for reordering tests and the same everywhere for a given seed */
+static UNITY_UINT32 UnityScheduleRandom(void)
+{
+    UNITY_UINT32 x = UnitySchedule.Random;
 
-            /* We're done if we match the entire string or up to a wildcard */
-            if (*sptr == '*')
-                return 1;
-            if (*sptr == ',')
-                return 1;
-            if (*sptr == '"')
-                return 1;
-            if (*sptr == '\'')
-                return 1;
-            if (*sptr == ':')
-                return 2;
-            if (*sptr == 0)
-                return 1;
-        }
+    x ^= (x << 13) & 0xFFFFFFFFu;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xFFFFFFFFu;
+    UnitySchedule.Random = x;
+    return x;
+}
+
+/*-----------------------------------------------*/
+/* A timing key names a test either as "name" or as "group.name" */
+static int UnityKeyMatchesTest(const char* key, const UnityTestEntry* test)
+{
+    size_t len;
 
-        /* Otherwise we start in the long pointer 1 character further and try again */
-        lptr = lnext;
-        sptr = shortstring;
+    if (strcmp(key, test->Name) == 0)
+    {
+        return 1;
+    }
+    if (test->Group == NULL)
+    {
+        return 0;
     }
+    len = strlen(test->Group);
+    return (strncmp(key, test->Group, len) == 0) && (key[len] == '.') &&
+           (strcmp(&key[len + 1], test->Name) == 0);
+}
 
-    return 0;
+/*-----------------------------------------------*/
+static int UnityCompareSlots(const void* a, const void* b)
+{
+    UNITY_UINT32 x = ((const UnityScheduleSlot*)a)->Hash;
+    UNITY_UINT32 y = ((const UnityScheduleSlot*)b)->Hash;
+
+    return (x > y) - (x < y);
 }
 
 /*-----------------------------------------------*/
-int UnityStringArgumentMatches(const char* str)
+/* Tests without a timing first, as nothing says they are short, then the longest first */
+static int UnityCompareTimings(const void* a, const void* b)
 {
-    int retval;
-    const char* ptr1;
-    const char* ptr2;
-    const char* ptrf;
+    const UnityScheduleTiming* x = (const UnityScheduleTiming*)a;
+    const UnityScheduleTiming* y = (const UnityScheduleTiming*)b;
 
-    /* Go through the options and get the substrings for matching one at a time */
-    ptr1 = str;
-    while (ptr1[0] != 0)
+    if (x->Known != y->Known)
     {
-        if ((ptr1[0] == '"') || (ptr1[0] == '\''))
-        {
-            ptr1++;
-        }
+        return x->Known - y->Known;
+    }
+    if (x->Ns != y->Ns)
+    {
+        return (x->Ns < y->Ns) ? 1 : -1;
+    }
+    return (x->Index > y->Index) - (x->Index < y->Index);
+}
 
-        /* look for the start of the next partial */
-        ptr2 = ptr1;
-        ptrf = 0;
-        do
+/*-----------------------------------------------*/
+/* Reads the mean duration of every test from the timing file, which has a line per test:
+ * its key, the number of samples, then the samples. A test is found through the hashes
+ * of both forms of its name in slots, sorted by hash. */
+static void UnityReadDurations(FILE* file, const UnityTestEntry* tests, UNITY_UINT32 count,
+                               const UnityScheduleSlot* slots, UnityScheduleTiming* timings)
+{
+    char key[512];
+    unsigned long samples;
+    unsigned long i;
+    double ns;
+    double sum;
+    UNITY_UINT32 hash;
+    UNITY_UINT32 lo;
+    UNITY_UINT32 hi;
+    UNITY_UINT32 mid;
+
+    while (fscanf(file, "%511s %lu", key, &samples) == 2)
+    {
+        sum = 0;
+        for (i = 0; i < samples; i++)
         {
-            ptr2++;
-            if ((ptr2[0] == ':') && (ptr2[1] != 0) && (ptr2[0] != '\'') && (ptr2[0] != '"') && (ptr2[0] != ','))
+            if (fscanf(file, "%lf", &ns) != 1)
             {
-                ptrf = &ptr2[1];
+                return;
             }
-        } while ((ptr2[0] != 0) && (ptr2[0] != '\'') && (ptr2[0] != '"') && (ptr2[0] != ','));
-
-        while ((ptr2[0] != 0) && ((ptr2[0] == ':') || (ptr2[0] == '\'') || (ptr2[0] == '"') || (ptr2[0] == ',')))
+            sum += ns;
+        }
+        if (samples == 0)
         {
-            ptr2++;
+            continue;
         }
 
-        /* done if complete filename match */
-        retval = IsStringInBiggerString(Unity.TestFile, ptr1);
-        if (retval == 1)
+        hash = UnityHashString(2166136261u, key);
+        lo = 0;
+        hi = 2 * count;
+        while (lo < hi)
         {
-            return retval;
+            mid = lo + ((hi - lo) / 2);
+            if (slots[mid].Hash < hash)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
         }
-
-        /* done if testname match after filename partial match */
-        if ((retval == 2) && (ptrf != 0))
+        for (; (lo < 2 * count) && (slots[lo].Hash == hash); lo++)
         {
-            if (IsStringInBiggerString(Unity.CurrentTestName, ptrf))
+            if (UnityKeyMatchesTest(key, &tests[slots[lo].Index]))
             {
-                return 1;
+                timings[slots[lo].Index].Ns = sum / (double)samples;
+                timings[slots[lo].Index].Known = 1;
             }
         }
+    }
+}
 
-        /* done if complete testname match */
-        if (IsStringInBiggerString(Unity.CurrentTestName, ptr1) == 1)
+/*-----------------------------------------------*/
+static void UnityOrderByDuration(UnityTestEntry* tests, UNITY_UINT32 count)
+{
+    const char* path = UnitySchedule.DurationsFile ? UnitySchedule.DurationsFile : UNITY_DURATIONS_FILE;
+    UnityScheduleSlot* slots = (UnityScheduleSlot*)malloc(2 * count * sizeof(UnityScheduleSlot));
+    UnityScheduleTiming* timings = (UnityScheduleTiming*)malloc(count * sizeof(UnityScheduleTiming));
+    UnityTestEntry* copy = (UnityTestEntry*)malloc(count * sizeof(UnityTestEntry));
+    FILE* file = fopen(path, "r");
+    UNITY_UINT32 i;
+
+    if ((slots == NULL) || (timings == NULL) || (copy == NULL) || (file == NULL))
+    {
+        UnityPrint((file == NULL) ? "No durations in " : "Out of memory for durations of ");
+        UnityPrint(path);
+        UnityPrint(", keeping the order of the tests");
+        UNITY_PRINT_EOL();
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
         {
-            return 1;
+            UnityTestEntry nameOnly = tests[i];
+            nameOnly.Group = NULL;
+            slots[i].Hash = UnityHashTest(&tests[i]);
+            slots[i].Index = i;
+            slots[count + i].Hash = UnityHashTest(&nameOnly);
+            slots[count + i].Index = i;
+            timings[i].Ns = 0;
+            timings[i].Known = 0;
+            timings[i].Index = i;
         }
+        qsort(slots, 2 * count, sizeof(UnityScheduleSlot), UnityCompareSlots);
+        UnityReadDurations(file, tests, count, slots, timings);
+        qsort(timings, count, sizeof(UnityScheduleTiming), UnityCompareTimings);
 
-        ptr1 = ptr2;
+        memcpy(copy, tests, count * sizeof(UnityTestEntry));
+        for (i = 0; i < count; i++)
+        {
+            tests[i] = copy[timings[i].Index];
+        }
     }
 
-    /* we couldn't find a match for any substrings */
-    return 0;
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+    free(copy);
+    free(timings);
+    free(slots);
 }
 
 /*-----------------------------------------------*/
-int UnityTestMatches(void)
+/* Applies --shard, --shuffle and --order to a runner's table of tests. The tests of other
+ * shards are dropped, the rest are shuffled and then sorted by duration (so the shuffle only
+ * breaks ties), and the number of tests left to run in tests is returned. */
+UNITY_UINT32 UnityScheduleTests(UnityTestEntry* tests, UNITY_UINT32 count)
 {
-    /* Check if this test name matches the included test pattern */
-    int retval;
-    if (UnityOptionIncludeNamed)
-    {
-        retval = UnityStringArgumentMatches(UnityOptionIncludeNamed);
-    }
-    else
+    UNITY_UINT32 i;
+    UNITY_UINT32 j;
+    UnityTestEntry swap;
+
+    if (UnitySchedule.ShardCount > 0)
     {
-        retval = 1;
+        for (i = 0, j = 0; i < count; i++)
+        {
+            if ((UnityHashTest(&tests[i]) % UnitySchedule.ShardCount) == (UnitySchedule.ShardIndex - 1))
+            {
+                tests[j++] = tests[i];
+            }
+        }
+        count = j;
     }
 
-    /* Check if this test name matches the excluded test pattern */
-    if (UnityOptionExcludeNamed)
+    if (UnitySchedule.Shuffle)
     {
-        if (UnityStringArgumentMatches(UnityOptionExcludeNamed))
+        /* The seed is printed once, and repeated runs carry on from where the last one left */
+        if (UnitySchedule.Random == 0)
         {
-            retval = 0;
+            UnityPrint("Shuffling tests with --shuffle=");
+            UnityPrintNumberUnsigned(UnitySchedule.Seed);
+            UNITY_PRINT_EOL();
+            UnitySchedule.Random = (UnitySchedule.Seed ^ 0x9E3779B9u) & 0xFFFFFFFFu;
+            if (UnitySchedule.Random == 0)
+            {
+                UnitySchedule.Random = 1;
+            }
+        }
+        for (i = count; i > 1; i--)
+        {
+            j = UnityScheduleRandom() % i;
+            swap = tests[i - 1];
+            tests[i - 1] = tests[j];
+            tests[j] = swap;
         }
     }
 
-    return retval;
+    if (UnitySchedule.ByDuration && (count > 1))
+    {
+        UnityOrderByDuration(tests, count);
+    }
+    return count;
 }
 
 #endif /* UNITY_USE_COMMAND_LINE_ARGS */
@@ -113,6 +113,14 @@ void verifyTest(void);
 #define TEST_PASS()                                                                                TEST_ABORT()
 #define TEST_PASS_MESSAGE(message)                                                                 do { UnityMessage((message), __LINE__); TEST_ABORT(); } while(0)
 
+/* Limits how long the test may run, in milliseconds (0 for no limit), when built with UNITY_ISOLATE_TESTS.
+ * Used in a test or setUp it applies to that test only, used before running tests to all of them. */
+#ifdef UNITY_ISOLATE_TESTS
+#define TEST_TIMEOUT_MS(ms)                                                                        UnitySetTestTimeout((UNITY_UINT32)(ms))
+#else
+#define TEST_TIMEOUT_MS(ms)
+#endif
+
 /* This macro does nothing, but it is useful for build tools (like Ceedling) to make use of this to figure out
  * which files should be linked to in order to perform a test. Use it like TEST_FILE("sandwiches.c") */
 #define TEST_FILE(a)
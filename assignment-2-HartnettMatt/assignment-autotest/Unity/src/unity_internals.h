@@ -249,6 +249,31 @@ typedef UNITY_FLOAT_TYPE UNITY_FLOAT;
 
 #endif
 
+/*-------------------------------------------------------
+ * Output Method: line buffered (UNITY_OUTPUT_BUFFERED)
+ *-------------------------------------------------------*/
+#ifdef UNITY_OUTPUT_BUFFERED
+  #if defined(UNITY_OUTPUT_CHAR) || defined(UNITY_OUTPUT_FLUSH)
+    #error "UNITY_OUTPUT_BUFFERED provides UNITY_OUTPUT_CHAR and UNITY_OUTPUT_FLUSH, redirect it with UNITY_OUTPUT_WRITE instead"
+  #endif
+  #ifndef UNITY_OUTPUT_BUFFER_SIZE
+  #define UNITY_OUTPUT_BUFFER_SIZE 1024
+  #endif
+  #ifndef UNITY_OUTPUT_WRITE
+    /* Default to one fwrite per line, which keeps its place among the test's own printf output */
+    #include <stdio.h>
+    #define UNITY_OUTPUT_WRITE(buf, len) (void)fwrite((buf), 1, (len), stdout)
+  #else
+    #ifdef UNITY_OUTPUT_WRITE_HEADER_DECLARATION
+      extern void UNITY_OUTPUT_WRITE_HEADER_DECLARATION;
+    #endif
+  #endif
+  void UnityOutputBufferedChar(int c);
+  void UnityOutputBufferedFlush(void);
+  #define UNITY_OUTPUT_CHAR(a)  UnityOutputBufferedChar(a)
+  #define UNITY_OUTPUT_FLUSH()  UnityOutputBufferedFlush()
+#endif
+
 /*-------------------------------------------------------
  * Output Method: stdout (DEFAULT)
  *-------------------------------------------------------*/
@@ -360,6 +385,23 @@ typedef UNITY_FLOAT_TYPE UNITY_FLOAT;
 #define UNITY_PRINT_EXEC_TIME() do{}while(0)
 #endif
 
+/*-------------------------------------------------------
+ * Test Isolation
+ *-------------------------------------------------------*/
+
+/* With UNITY_ISOLATE_TESTS each test runs in a forked process (POSIX only), so a test that
+ * crashes or runs longer than its timeout fails by itself instead of ending the whole run */
+#ifdef UNITY_ISOLATE_TESTS
+  #ifndef UNITY_TEST_TIMEOUT_MS
+    #define UNITY_TEST_TIMEOUT_MS 0
+  #endif
+  #define UNITY_ISOLATE_BEGIN() if (UnityIsolateBegin()) return
+  #define UNITY_ISOLATE_END() UnityIsolateEnd()
+#else
+  #define UNITY_ISOLATE_BEGIN() do{}while(0)
+  #define UNITY_ISOLATE_END() do{}while(0)
+#endif
+
 /*-------------------------------------------------------
  * Footprint
  *-------------------------------------------------------*/
@@ -481,6 +523,12 @@ int  UnityEnd(void);
 void UnitySetTestFile(const char* filename);
 void UnityConcludeTest(void);
 
+#ifdef UNITY_ISOLATE_TESTS
+int  UnityIsolateBegin(void);
+void UnityIsolateEnd(void);
+void UnitySetTestTimeout(const UNITY_UINT32 ms);
+#endif
+
 #ifndef RUN_TEST
 void UnityDefaultTestRun(UnityTestFunction Func, const char* FuncName, const int FuncLineNum);
 #else
@@ -748,8 +796,27 @@ extern const char UnityStrErrShorthand[];
  *-----------------------------------------------*/
 
 #ifdef UNITY_USE_COMMAND_LINE_ARGS
+
+/* Timing file read by --order=duration when --durations=FILE isn't given */
+#ifndef UNITY_DURATIONS_FILE
+#define UNITY_DURATIONS_FILE "unity_durations.txt"
+#endif
+
+/* A test as handed to UnityScheduleTests. Group is the test group, or the base name of the
+ * test file for generated runners, and Data is left for the caller. */
+typedef struct UNITY_TEST_ENTRY_T
+{
+    UnityTestFunction Func;
+    const char* Group;
+    const char* Name;
+    int Line;
+    void* Data;
+} UnityTestEntry;
+
 int UnityParseOptions(int argc, char** argv);
+int UnityParseScheduleOption(const char* option);
 int UnityTestMatches(void);
+UNITY_UINT32 UnityScheduleTests(UnityTestEntry* tests, UNITY_UINT32 count);
 #endif
 
 /*-------------------------------------------------------
@@ -0,0 +1,60 @@
+/* This Test File Is Used To Verify That The Generate Test Runner Script Finds Tests Around TEST_BENCHMARK Blocks */
+
+#include <stdio.h>
+#include "unity.h"
+
+/* Benchmarking itself is tested in extras/bench, the runner only has to find the tests around it */
+static const char* BenchName;
+static int BenchRuns;
+#define TEST_BENCHMARK(name) for (BenchName = (name), BenchRuns = 3; BenchRuns > 0; BenchRuns--)
+
+/* Include Passthroughs for Linking Tests */
+void putcharSpy(int c) { (void)putchar(c);}
+void flushSpy(void) {}
+
+/* Global Variables Used During These Tests */
+int CounterBench = 0;
+
+static const char* bench_name(int which)
+{
+    return which ? "void test_NotATest(void)" : "test_AlsoNotATest";
+}
+
+void setUp(void)
+{
+    CounterBench = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_ThisBenchmarkedTestPasses(void)
+{
+    TEST_BENCHMARK("test_NotATestEither") {
+        CounterBench++;
+    }
+    TEST_ASSERT_EQUAL(3, CounterBench);
+}
+
+void test_ThisTestHasTwoBenchmarks(void)
+{
+    TEST_BENCHMARK(bench_name(0)) {
+        CounterBench++;
+    }
+    TEST_BENCHMARK(bench_name(1)) { CounterBench++; }
+    TEST_ASSERT_EQUAL(6, CounterBench);
+}
+
+void test_ThisBenchmarkedTestFails(void)
+{
+    TEST_BENCHMARK("fails") {
+        CounterBench++;
+    }
+    TEST_FAIL_MESSAGE("This Test Should Fail");
+}
+
+void test_ThisTestAfterTheBenchmarksIsFound(void)
+{
+    TEST_ASSERT_EQUAL(0, CounterBench);
+}
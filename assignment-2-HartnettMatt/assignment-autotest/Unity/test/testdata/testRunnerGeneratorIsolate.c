@@ -0,0 +1,90 @@
+/* This Test File Is Used To Verify That Tests Isolated With UNITY_ISOLATE_TESTS Fail By Themselves */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "unity.h"
+
+/* Include Passthroughs for Linking Tests */
+void putcharSpy(int c) { (void)putchar(c);}
+void flushSpy(void) {}
+
+/* Global Variables Used During These Tests */
+int CounterSetup = 0;
+volatile int Forever = 1;
+
+void setUp(void)
+{
+    CounterSetup++;
+}
+
+void tearDown(void)
+{
+}
+
+void test_ThisTestSegfaults(void)
+{
+    raise(SIGSEGV);
+}
+
+void test_ThisTestRunsAfterTheSegfault(void)
+{
+    TEST_ASSERT_EQUAL_MESSAGE(1, CounterSetup, "Isolated Tests Should Not Share State");
+}
+
+void test_ThisTestAborts(void)
+{
+    abort();
+}
+
+void test_ThisTestRunsAfterTheAbort(void)
+{
+    TEST_PASS();
+}
+
+void test_ThisTestRunsOutOfTheGlobalTime(void)
+{
+    while (Forever)
+    {
+    }
+}
+
+void test_ThisTestRunsAfterTheGlobalTimeout(void)
+{
+    TEST_PASS();
+}
+
+void test_ThisTestRunsOutOfItsOwnTime(void)
+{
+    TEST_TIMEOUT_MS(50);
+    while (Forever)
+    {
+    }
+}
+
+void test_ThisTestRunsAfterItsOwnTimeout(void)
+{
+    TEST_PASS();
+}
+
+void test_ThisTestCallsExit(void)
+{
+    exit(3);
+}
+
+void test_ThisTestRunsAfterTheExit(void)
+{
+    TEST_PASS();
+}
+
+void test_ThisTestCrashesInTheMiddleOfALine(void)
+{
+    printf("partial");
+    (void)fflush(stdout);
+    raise(SIGSEGV);
+}
+
+void test_ThisTestFailsAsUsual(void)
+{
+    TEST_FAIL_MESSAGE("This Test Should Fail");
+}
@@ -0,0 +1,43 @@
+/* This Test File Is Used To Verify That The Generate Test Runner Script Finds Tests Declared With UNITY_TEST */
+
+#include <stdio.h>
+#include "unity.h"
+
+/* Registration itself is tested in extras/register, the runner only has to find these tests */
+#define UNITY_TEST(name) void name(void); void name(void)
+
+/* Include Passthroughs for Linking Tests */
+void putcharSpy(int c) { (void)putchar(c);}
+void flushSpy(void) {}
+
+/* Global Variables Used During These Tests */
+int CounterSetup = 0;
+
+void setUp(void)
+{
+    CounterSetup = 1;
+}
+
+void tearDown(void)
+{
+}
+
+UNITY_TEST(test_ThisRegisteredTestAlwaysPasses)
+{
+    TEST_PASS();
+}
+
+UNITY_TEST( test_ThisRegisteredTestAlwaysFails )
+{
+    TEST_FAIL_MESSAGE("This Test Should Fail");
+}
+
+UNITY_TEST(spec_ThisRegisteredTestPassesWhenNormalSetupRan)
+{
+    TEST_ASSERT_EQUAL_MESSAGE(1, CounterSetup, "Normal Setup Wasn't Run");
+}
+
+void test_ThisPlainTestIsStillFound(void)
+{
+    TEST_PASS();
+}
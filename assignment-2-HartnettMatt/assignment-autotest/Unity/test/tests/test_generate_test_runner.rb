@@ -780,6 +780,61 @@ RUNNER_TESTS = [
     }
   },
 
+  { :name => 'RegisteredTests',
+    :testfile => 'testdata/testRunnerGeneratorRegistered.c',
+    :testdefines => ['TEST'],
+    :options => nil, #defaults
+    :expected => {
+      :to_pass => [ 'test_ThisRegisteredTestAlwaysPasses',
+                    'spec_ThisRegisteredTestPassesWhenNormalSetupRan',
+                    'test_ThisPlainTestIsStillFound' ],
+      :to_fail => [ 'test_ThisRegisteredTestAlwaysFails' ],
+      :to_ignore => [ ],
+    }
+  },
+
+  { :name => 'IsolatedTests',
+    :testfile => 'testdata/testRunnerGeneratorIsolate.c',
+    :testdefines => ['TEST', 'UNITY_ISOLATE_TESTS', 'UNITY_TEST_TIMEOUT_MS=300'],
+    :options => nil, #defaults
+    :expected => {
+      :to_pass => [ 'test_ThisTestRunsAfterTheSegfault',
+                    'test_ThisTestRunsAfterTheAbort',
+                    'test_ThisTestRunsAfterTheGlobalTimeout',
+                    'test_ThisTestRunsAfterItsOwnTimeout',
+                    'test_ThisTestRunsAfterTheExit' ],
+      :to_fail => [ 'test_ThisTestSegfaults',
+                    'test_ThisTestAborts',
+                    'test_ThisTestRunsOutOfTheGlobalTime',
+                    'test_ThisTestRunsOutOfItsOwnTime',
+                    'test_ThisTestCallsExit',
+                    'test_ThisTestCrashesInTheMiddleOfALine',
+                    'test_ThisTestFailsAsUsual' ],
+      :to_ignore => [ ],
+      :output => [ "^\\S*:25:test_ThisTestSegfaults:FAIL: Killed by signal #{Signal.list['SEGV']} \\(",
+                   "^\\S*:35:test_ThisTestAborts:FAIL: Killed by signal #{Signal.list['ABRT']} \\(",
+                   "^\\S*:45:test_ThisTestRunsOutOfTheGlobalTime:FAIL: Timed out after 300 ms$",
+                   "^\\S*:57:test_ThisTestRunsOutOfItsOwnTime:FAIL: Timed out after 50 ms$",
+                   "^\\S*:70:test_ThisTestCallsExit:FAIL: Exited with status 3 before the test finished$",
+                   "^partial$",
+                   "^\\S*:80:test_ThisTestCrashesInTheMiddleOfALine:FAIL: Killed by signal",
+                   "^\\S*:89:test_ThisTestFailsAsUsual:FAIL: This Test Should Fail$" ],
+    }
+  },
+
+  { :name => 'BenchmarkedTests',
+    :testfile => 'testdata/testRunnerGeneratorBenchmark.c',
+    :testdefines => ['TEST'],
+    :options => nil, #defaults
+    :expected => {
+      :to_pass => [ ':32:test_ThisBenchmarkedTestPasses',
+                    ':40:test_ThisTestHasTwoBenchmarks',
+                    ':57:test_ThisTestAfterTheBenchmarksIsFound' ],
+      :to_fail => [ 'test_ThisBenchmarkedTestFails' ],
+      :to_ignore => [ ],
+    }
+  },
+
   { :name => 'ArgsNameFilterWithWildcardOnFile',
     :testfile => 'testdata/testRunnerGeneratorSmall.c',
     :testdefines => ['TEST', 'UNITY_USE_COMMAND_LINE_ARGS'],
@@ -907,6 +962,63 @@ RUNNER_TESTS = [
     }
   },
 
+  { :name => 'ArgsIncludeMultipleFlags',
+    :testfile => 'testdata/testRunnerGenerator.c',
+    :testdefines => ['TEST', 'UNITY_USE_COMMAND_LINE_ARGS'],
+    :options => {
+      :cmdline_args => true,
+    },
+    :cmdline_args => "-n ThisTestAlwaysPasses -n ThisTestAlwaysFails",
+    :expected => {
+      :to_pass => [ 'test_ThisTestAlwaysPasses' ],
+      :to_fail => [ 'test_ThisTestAlwaysFails' ],
+      :to_ignore => [ ],
+    }
+  },
+
+  { :name => 'ArgsNameFilterWithWildcardsInside',
+    :testfile => 'testdata/testRunnerGenerator.c',
+    :testdefines => ['TEST', 'UNITY_USE_COMMAND_LINE_ARGS'],
+    :options => {
+      :cmdline_args => true,
+    },
+    :cmdline_args => "-n testRunnerGenerator:test_*Always????s",
+    :expected => {
+      :to_pass => [ ],
+      :to_fail => [ 'test_ThisTestAlwaysFails' ],
+      :to_ignore => [ ],
+    }
+  },
+
+  # Before the patterns were globs, a '*' ended the pattern and this selected every test_ test
+  { :name => 'ArgsNameFilterMatchesTextAfterWildcard',
+    :testfile => 'testdata/testRunnerGenerator.c',
+    :testdefines => ['TEST', 'UNITY_USE_COMMAND_LINE_ARGS'],
+    :options => {
+      :cmdline_args => true,
+    },
+    :cmdline_args => "-n test_*AlwaysPasses",
+    :expected => {
+      :to_pass => [ 'test_ThisTestAlwaysPasses' ],
+      :to_fail => [ ],
+      :to_ignore => [ ],
+    }
+  },
+
+  { :name => 'ArgsNameFilterWithRegex',
+    :testfile => 'testdata/testRunnerGenerator.c',
+    :testdefines => ['TEST', 'UNITY_USE_COMMAND_LINE_ARGS', 'UNITY_INCLUDE_REGEX'],
+    :options => {
+      :cmdline_args => true,
+    },
+    :cmdline_args => "-n \"/^test_ThisTestAlways(Passes|Fails)$/\"",
+    :expected => {
+      :to_pass => [ 'test_ThisTestAlwaysPasses' ],
+      :to_fail => [ 'test_ThisTestAlwaysFails' ],
+      :to_ignore => [ ],
+    }
+  },
+
   { :name => 'ArgsIncludeSingleTestInSpecificFile',
     :testfile => 'testdata/testRunnerGenerator.c',
     :testdefines => ['TEST', 'UNITY_USE_COMMAND_LINE_ARGS'],
@@ -1195,6 +1307,11 @@ def runner_test(test, runner, expected, test_defines, cmdline_args, features)
   allgood &&= verify_number( expected[:to_fail],   /(:FAIL)/,   output)
   allgood &&= verify_number( expected[:to_ignore], /(:IGNORE)/, output)
 
+  #lines the output has to contain, among others
+  if (expected[:output])
+    allgood = expected[:output].inject(allgood) {|s,v| s && verify_match(/#{v}/, output) }
+  end
+
   #if we care about any other text, check that too
   if (expected[:text])
     allgood = expected[:text].inject(allgood) {|s,v| s && verify_match(/#{v}/, output) }
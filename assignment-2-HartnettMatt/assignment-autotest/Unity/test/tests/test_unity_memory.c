@@ -79,3 +79,47 @@ void testNotEqualMemoryLengthZero(void)
     TEST_ASSERT_EQUAL_MEMORY(NULL, NULL, 0);
     VERIFY_FAILS_END
 }
+
+void testEqualMemoryLarge(void)
+{
+    static unsigned char expected[10000];
+    static unsigned char actual[10000];
+    int i;
+
+    for (i = 0; i < 10000; i++)
+    {
+        expected[i] = (unsigned char)(i * 7);
+        actual[i] = (unsigned char)(i * 7);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, 10000);
+    TEST_ASSERT_EQUAL_MEMORY_ARRAY(expected, actual, 100, 100);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, 10000);
+}
+
+void testNotEqualMemoryLargeAfterFirstBlock(void)
+{
+    static unsigned char expected[10000];
+    static unsigned char actual[10000];
+
+    memset(expected, 0x5A, sizeof(expected));
+    memset(actual, 0x5A, sizeof(actual));
+    actual[9998] = 0;
+
+    EXPECT_ABORT_BEGIN
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, 10000);
+    VERIFY_FAILS_END
+}
+
+void testNotEqualMemoryEachEqualLargeAfterFirstBlock(void)
+{
+    static unsigned char actual[10000];
+    unsigned char expected[4] = { 0x5A, 0x5A, 0x5A, 0x5A };
+
+    memset(actual, 0x5A, sizeof(actual));
+    TEST_ASSERT_EACH_EQUAL_MEMORY(expected, actual, 4, 2500);
+    actual[5001] = 0;
+
+    EXPECT_ABORT_BEGIN
+    TEST_ASSERT_EACH_EQUAL_MEMORY(expected, actual, 4, 2500);
+    VERIFY_FAILS_END
+}
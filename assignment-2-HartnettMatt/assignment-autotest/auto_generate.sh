@@ -1,24 +1,27 @@
 #!/bin/bash
 # A script to auto generate test runners for unity tests and a single test/unity_runner.c
-# file which combines all runners into a single executable
+# file which combines all runners into a single executable, running the
+# suites in parallel processes (see runner/parallel_runner.h)
 # Pass as arguments a list of test files for which we need to create runners
+#   auto_generate.sh <test files>            Runners for the test files and test/unity_runner.c
+#   auto_generate.sh --runner <test files>   Only the runners of the test files
+#   auto_generate.sh --main <test files>     Only test/unity_runner.c, which needs nothing but the file names
+# The cmake build uses --runner once per test file and --main for the list, so editing
+# one test file only regenerates and recompiles its own runner
 assignment_test_basedir_relative=`dirname $0`
 assignment_test_basedir=$(realpath ${assignment_test_basedir_relative})
 set -e
 set +x
-# Loop over each test file specified in the argument list
-echo "Test files for auto dependency generation $@"
-rm -f ${assignment_test_basedir}/test/unity_runner.c
-mainfunc_content=
-for test_file in $@; do
-    file_dir=$(dirname $test_file)
-    echo "Autogenerating runner for ${test_file}"
+
+generate_runner() {
+    test_file=$1
     filename=$(basename $test_file .c)
+    echo "Autogenerating runner for ${test_file}"
     # Create a ${test_file}_Runner used to run any tests defined in ${test_file}
-    # See https://github.com/ThrowTheSwitch/Unity/blob/master/docs/UnityHelperScriptsGuide.md   
+    # See https://github.com/ThrowTheSwitch/Unity/blob/master/docs/UnityHelperScriptsGuide.md
     # and supported arguments at https://github.com/ThrowTheSwitch/Unity/blob/master/auto/generate_test_runner.rb#L483
     # Define all function names so they don't conflict with each other
-    # We'll make our own main() function to combine all of these together in unity_runner.c 
+    # We'll make our own main() function to combine all of these together in unity_runner.c
     ruby ${assignment_test_basedir}/Unity/auto/generate_test_runner.rb  ${assignment_test_basedir}/${test_file} \
         --setup_name="${filename}_setUp" \
         --teardown_name="${filename}_tearDown" \
@@ -26,15 +29,41 @@ for test_file in $@; do
         --test_reset_name="${filename}_resetTest" \
         --test_verify_name="${filename}_verifyTest" \
 
-    mainfunc_content="${mainfunc_content} rc=${filename}_main(); if (rc != 0) { return rc; } "
-    setup_content="${filename}_setUp(); "
-    teardown_content="${filename}_tearDown(); "
-    extern_content="${extern_content} extern int ${filename}_main(void); extern void ${filename}_tearDown(); extern void ${filename}_setUp();"
-done
-echo "Autogenerating test/unity_runner.c"
-cat << EOF > ${assignment_test_basedir}/test/unity_runner.c
+}
+
+generate_main() {
+    suites_content=
+    for test_file in $@; do
+        filename=$(basename $test_file .c)
+        suites_content="${suites_content} { \"${filename}\", ${filename}_main },"
+        setup_content="${filename}_setUp(); "
+        teardown_content="${filename}_tearDown(); "
+        extern_content="${extern_content} extern int ${filename}_main(void); extern void ${filename}_tearDown(); extern void ${filename}_setUp();"
+    done
+    echo "Autogenerating test/unity_runner.c"
+    # Each suite runs in a process from a pool, see runner/parallel_runner.h
+    cat << EOF > ${assignment_test_basedir}/test/unity_runner.c
+#include "runner/parallel_runner.h"
 ${extern_content}
 void setUp(void) { ${setup_content} }
 void tearDown(void) { ${teardown_content} }
-int main(int argc, char **argv) { int rc=0; ${mainfunc_content} }
+static const struct unity_suite suites[] = { ${suites_content} };
+int main(int argc, char **argv) { return unity_run_suites(suites, sizeof(suites) / sizeof(suites[0]), argc, argv); }
 EOF
+}
+
+mode=all
+case "$1" in
+    --runner) mode=runner; shift ;;
+    --main) mode=main; shift ;;
+esac
+echo "Test files for auto dependency generation $@"
+if [ "${mode}" != "main" ]; then
+    # Loop over each test file specified in the argument list
+    for test_file in $@; do
+        generate_runner ${test_file}
+    done
+fi
+if [ "${mode}" != "runner" ]; then
+    generate_main $@
+fi
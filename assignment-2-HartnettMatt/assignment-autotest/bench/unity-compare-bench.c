@@ -0,0 +1,198 @@
+/******************************************************************************
+ * unity-compare-bench.c
+ *
+ * Usage: unity-compare-bench [max megabytes]
+ *
+ * Throughput benchmark for Unity's memory and array assertions, built twice
+ * by the Makefile in this directory: once as usual, comparing a block at a
+ * time with memcmp, and once with UNITY_EXCLUDE_STRING_H, comparing element
+ * by element.
+ *
+ * 1) Runs each assertion below on equal buffers of 1 KB up to <max
+ *    megabytes> (default 100), repeated to compare at least 256 MB, and
+ *    prints the throughput in GB/s as JSON on stderr, one result per line.
+ *    The TEST_ASSERT_EACH_EQUAL_* cases use the UNITY_ARRAY_TO_VAL mode.
+ * 2) Changes one byte at the start, in the middle and near the end of a
+ *    64 KB buffer in turn and runs each assertion again, so it fails.
+ *    Unity's output goes to stdout, where the Makefile checks the failure
+ *    messages of both builds are the same.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+
+#ifdef UNITY_EXCLUDE_STRING_H
+#define COMPARE_MODE "bytewise"
+#else
+#define COMPARE_MODE "memcmp"
+#endif
+
+#define DEFAULT_MAX_MB  100
+#define MIN_BYTES       (256UL << 20)
+#define FAIL_BYTES      (64UL << 10)
+#define EACH_SIZE       16
+#define EACH_VALUE      0x3f800000UL        /* 1.0f */
+
+static unsigned char *expected_buf;
+static unsigned char *actual_buf;
+static unsigned char *each_buf;
+static unsigned char each_pattern[EACH_SIZE];
+
+/* What the current test compares, and how often */
+static size_t cur_bytes;
+static long cur_repeats;
+
+struct compare_case {
+    const char *name;
+    void (*check)(size_t bytes);
+    int each;                   /* Compares each_buf against one value */
+};
+
+static void check_memory(size_t bytes)
+{
+    TEST_ASSERT_EQUAL_MEMORY(expected_buf, actual_buf, bytes);
+}
+
+static void check_each_memory(size_t bytes)
+{
+    TEST_ASSERT_EACH_EQUAL_MEMORY(each_pattern, each_buf, EACH_SIZE, bytes / EACH_SIZE);
+}
+
+static void check_uint8_array(size_t bytes)
+{
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_buf, actual_buf, bytes);
+}
+
+static void check_int32_array(size_t bytes)
+{
+    TEST_ASSERT_EQUAL_INT32_ARRAY((const int32_t *)expected_buf, (const int32_t *)actual_buf,
+                                  bytes / 4);
+}
+
+static void check_each_uint32(size_t bytes)
+{
+    TEST_ASSERT_EACH_EQUAL_UINT32(EACH_VALUE, (const uint32_t *)each_buf, bytes / 4);
+}
+
+static void check_float_array(size_t bytes)
+{
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY((const float *)expected_buf, (const float *)actual_buf,
+                                  bytes / 4);
+}
+
+static const struct compare_case cases[] = {
+    { "memory",      check_memory,      0 },
+    { "each_memory", check_each_memory, 1 },
+    { "uint8_array", check_uint8_array, 0 },
+    { "int32_array", check_int32_array, 0 },
+    { "each_uint32", check_each_uint32, 1 },
+    { "float_array", check_float_array, 0 },
+};
+
+static const struct compare_case *cur_case;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void test_compare(void)
+{
+    long i;
+
+    for (i = 0; i < cur_repeats; i++)
+        cur_case->check(cur_bytes);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const struct compare_case *c, size_t bytes)
+{
+    char name[64];
+    double start, seconds;
+
+    cur_case = c;
+    cur_bytes = bytes;
+    cur_repeats = bytes < MIN_BYTES ? (long)(MIN_BYTES / bytes) : 1;
+    snprintf(name, sizeof(name), "%s_%zuKB", c->name, bytes >> 10);
+
+    start = now();
+    UnityDefaultTestRun(test_compare, name, __LINE__);
+    seconds = now() - start;
+    fprintf(stderr, "{\"compare\": \"%s\", \"assert\": \"%s\", \"bytes\": %zu, \"repeats\": %ld, "
+            "\"GB/s\": %.2f}\n", COMPARE_MODE, c->name, bytes, cur_repeats,
+            (double)bytes * cur_repeats / seconds / 1e9);
+}
+
+/* Run c on FAIL_BYTES with the byte at offset changed, so it fails */
+static void fail_at(const struct compare_case *c, size_t offset)
+{
+    unsigned char *buf = c->each ? each_buf : actual_buf;
+    char name[64];
+
+    cur_case = c;
+    cur_bytes = FAIL_BYTES;
+    cur_repeats = 1;
+    snprintf(name, sizeof(name), "%s_fails_at_%zu", c->name, offset);
+    buf[offset] ^= 0x40;
+    UnityDefaultTestRun(test_compare, name, __LINE__);
+    buf[offset] ^= 0x40;
+}
+
+int main(int argc, char **argv)
+{
+    size_t max = (size_t)(argc > 1 ? atol(argv[1]) : DEFAULT_MAX_MB) << 20;
+    size_t bytes, i;
+    unsigned long seed = 1;
+    uint32_t value = EACH_VALUE;
+
+    if (max < FAIL_BYTES) {
+        fprintf(stderr, "Usage: %s [max megabytes]\n", argv[0]);
+        return 1;
+    }
+    expected_buf = malloc(max);
+    actual_buf = malloc(max);
+    each_buf = malloc(max);
+    if (!expected_buf || !actual_buf || !each_buf) {
+        perror("malloc");
+        return 1;
+    }
+    for (i = 0; i < max; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        expected_buf[i] = (unsigned char)(seed >> 16);
+    }
+    memcpy(actual_buf, expected_buf, max);
+    for (i = 0; i < EACH_SIZE; i += sizeof(value))
+        memcpy(each_pattern + i, &value, sizeof(value));
+    for (i = 0; i < max; i += EACH_SIZE)
+        memcpy(each_buf + i, each_pattern, EACH_SIZE);
+
+    UnityBegin("unity-compare-bench.c");
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (bytes = 1 << 10; bytes < max; bytes *= 16)
+            bench(&cases[i], bytes);
+        bench(&cases[i], max);
+        fail_at(&cases[i], FAIL_BYTES - 5);
+        fail_at(&cases[i], FAIL_BYTES / 2 + EACH_SIZE + 1);
+        fail_at(&cases[i], 0);
+    }
+    UnityEnd();
+
+    free(expected_buf);
+    free(actual_buf);
+    free(each_buf);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * unity-output-bench.c
+ *
+ * Usage: unity-output-bench [runs]
+ *
+ * Output throughput benchmark for Unity, built twice by the Makefile in this
+ * directory: once with the default per character putchar() output and once
+ * with UNITY_OUTPUT_BUFFERED.
+ *
+ * 1) Runs an output heavy suite <runs> times (default 2000): passing tests,
+ *    failures with long messages full of characters that have to be escaped,
+ *    string and array mismatches, TEST_MESSAGE() and ignored tests.
+ * 2) Unity's output goes to stdout as usual, redirect it to a file to keep
+ *    it for comparison or to /dev/null.
+ * 3) Prints the output mode, the time taken and the time per suite run as
+ *    JSON on stderr.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "unity.h"
+
+#ifdef UNITY_OUTPUT_BUFFERED
+#define OUTPUT_MODE "buffered"
+#else
+#define OUTPUT_MODE "putchar"
+#endif
+
+#define DEFAULT_RUNS 2000
+
+static const char long_text[] =
+    "A long message of the kind tests build with snprintf, naming the file, "
+    "the offset and the values involved so the failure can be understood "
+    "without a debugger, repeated to fill a line: the quick brown fox jumps "
+    "over the lazy dog, the quick brown fox jumps over the lazy dog.";
+
+static const char escaped_text[] =
+    "line one\nline two\r\n\ttabbed\tcolumns\t\x01\x7f and a long printable "
+    "tail after the control characters that still has to be scanned\n";
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void test_pass(void)
+{
+    TEST_ASSERT_EQUAL_INT(42, 42);
+}
+
+static void test_fail_message(void)
+{
+    TEST_FAIL_MESSAGE(long_text);
+}
+
+static void test_fail_string(void)
+{
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(long_text, escaped_text, long_text);
+}
+
+static void test_fail_string_len(void)
+{
+    TEST_ASSERT_EQUAL_STRING_LEN_MESSAGE(escaped_text, long_text, sizeof(escaped_text) - 1,
+                                         escaped_text);
+}
+
+static void test_fail_array(void)
+{
+    static const int expected[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    static const int actual[]   = { 1, 2, 3, 4, 5, 6, 7, 9 };
+
+    TEST_ASSERT_EQUAL_INT_ARRAY_MESSAGE(expected, actual, 8, long_text);
+}
+
+static void test_message(void)
+{
+    TEST_MESSAGE(long_text);
+    TEST_MESSAGE(escaped_text);
+}
+
+static void test_ignore(void)
+{
+    TEST_IGNORE_MESSAGE(long_text);
+}
+
+static void run_suite(void)
+{
+    int i;
+
+    UnityBegin("unity-output-bench.c");
+    for (i = 0; i < 8; i++)
+        UnityDefaultTestRun(test_pass, "test_pass", __LINE__);
+    UnityDefaultTestRun(test_fail_message, "test_fail_message", __LINE__);
+    UnityDefaultTestRun(test_fail_string, "test_fail_string", __LINE__);
+    UnityDefaultTestRun(test_fail_string_len, "test_fail_string_len", __LINE__);
+    UnityDefaultTestRun(test_fail_array, "test_fail_array", __LINE__);
+    UnityDefaultTestRun(test_message, "test_message", __LINE__);
+    UnityDefaultTestRun(test_ignore, "test_ignore", __LINE__);
+    UnityEnd();
+}
+
+int main(int argc, char **argv)
+{
+    struct timespec start, end;
+    long runs = argc > 1 ? atol(argv[1]) : DEFAULT_RUNS;
+    double seconds;
+    long i;
+
+    if (runs < 1) {
+        fprintf(stderr, "Usage: %s [runs]\n", argv[0]);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < runs; i++)
+        run_suite();
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "{\"output\": \"%s\", \"runs\": %ld, \"seconds\": %.3f, \"us_per_run\": %.2f}\n",
+            OUTPUT_MODE, runs, seconds, seconds * 1e6 / runs);
+    return 0;
+}
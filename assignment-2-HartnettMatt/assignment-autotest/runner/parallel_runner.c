@@ -0,0 +1,443 @@
+/******************************************************************************
+ * parallel_runner.c
+ *
+ * Process pool for the Unity suites, see parallel_runner.h.
+ *
+ * The parent keeps one record per suite: its pid, the read end of its pipe
+ * and everything read from it so far. poll() waits on all running pipes;
+ * at EOF the child is reaped, its totals taken from the summary Unity
+ * printed (or counted from its result lines if it died first), and the next
+ * suite is started. Finished output is printed as soon as every suite
+ * before it has been printed.
+ *
+ * For the perf baseline each run also gets a temporary file, where the
+ * child writes a "test nanoseconds" line for every test that passed.
+ * The parent adds those and the medians from the suite's BENCH lines to
+ * the timings of this run.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "unity.h"
+#include "unity_register.h"
+#include "parallel_runner.h"
+#include "perf_baseline.h"
+
+#define RUNNER_MAX_JOBS 256
+#define SUMMARY_RULE    "-----------------------\n"
+#define BENCH_PREFIX    "BENCH test="
+
+struct suite_run {
+    pid_t   pid;
+    int     fd;
+    char   *out;
+    size_t  len;
+    size_t  cap;
+    FILE   *times;          /* Test timings from the child, or NULL */
+    int     done;
+    int     tests;
+    int     failures;
+    int     ignored;
+};
+
+/*-----------------------------------------------------------------------------
+ * Child side
+ *---------------------------------------------------------------------------*/
+
+static char crash_stack[64 * 1024];
+static volatile sig_atomic_t crashed_test = -1;
+static int times_fd = -1;
+
+/* Unity's execution time hooks, see unity_config.h */
+unsigned long long unity_runner_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void unity_runner_test_time(const char *test, unsigned long long ns, int failed)
+{
+    if (times_fd >= 0 && test && !failed)
+        dprintf(times_fd, "%s %llu\n", test, ns);
+}
+
+static void crash_handler(int sig)
+{
+    /* A crash outside a test, or in the same test again (its tearDown),
+     * can't be recovered: let it kill the child and the parent reports it */
+    if (!Unity.CurrentTestName || crashed_test == (sig_atomic_t)Unity.NumberOfTests) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+        return;
+    }
+    crashed_test = Unity.NumberOfTests;
+    /* Fails the test and longjmp()s back to its TEST_PROTECT() */
+    UnityFail(strsignal(sig), Unity.CurrentTestLineNumber);
+}
+
+static void catch_crashes(void)
+{
+    static const int sigs[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL };
+    struct sigaction sa;
+    stack_t ss = { .ss_sp = crash_stack, .ss_size = sizeof(crash_stack) };
+
+    /* The alternate stack lets a stack overflow be caught too */
+    sigaltstack(&ss, NULL);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = crash_handler;
+    sa.sa_flags = SA_ONSTACK | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    for (size_t i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++)
+        sigaction(sigs[i], &sa, NULL);
+}
+
+/*
+ * Run k of -r is in round k / count, which starts at that suite: every
+ * suite runs once per round, and takes each place in the round in turn, so
+ * its samples aren't all taken right after the same suite or at the same
+ * point of a drift of the machine over the run
+ */
+static const struct unity_suite *suite_of(const struct unity_suite *suites, int count, int k)
+{
+    return &suites[(k % count + k / count) % count];
+}
+
+static int run_suite(const struct unity_suite *suite)
+{
+    return suite->run ? suite->run() : UnityRunRegisteredFile(suite->file);
+}
+
+static void run_child(const struct unity_suite *suite, int fd, FILE *times)
+{
+    int rc;
+
+    if (dup2(fd, STDOUT_FILENO) < 0)
+        _exit(127);
+    close(fd);
+    if (times)
+        times_fd = fileno(times);
+    /* Line buffered, so results reported before a crash aren't lost */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    catch_crashes();
+    rc = run_suite(suite);
+    fflush(stdout);
+    _exit(rc > 255 ? 255 : rc);
+}
+
+/*-----------------------------------------------------------------------------
+ * Parent side
+ *---------------------------------------------------------------------------*/
+
+static int start_suite(const struct unity_suite *suite, struct suite_run *r)
+{
+    int fds[2];
+
+    if (pipe2(fds, O_CLOEXEC) != 0)
+        return -1;
+    r->pid = fork();
+    if (r->pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (r->pid == 0) {
+        close(fds[0]);
+        run_child(suite, fds[1], r->times);
+    }
+    close(fds[1]);
+    r->fd = fds[0];
+    return 0;
+}
+
+static void append(struct suite_run *r, const char *buf, size_t len)
+{
+    if (r->len + len + 1 > r->cap) {
+        size_t cap = r->cap ? r->cap : 4096;
+        char *out;
+        while (cap < r->len + len + 1)
+            cap *= 2;
+        out = realloc(r->out, cap);
+        if (!out) {
+            perror("realloc");
+            exit(255);
+        }
+        r->out = out;
+        r->cap = cap;
+    }
+    memcpy(r->out + r->len, buf, len);
+    r->len += len;
+    r->out[r->len] = '\0';
+}
+
+/* Count the "file:line:test:STATUS" result lines of a suite that died */
+static void count_results(struct suite_run *r)
+{
+    for (char *line = r->out; line && *line; ) {
+        char *nl = strchr(line, '\n');
+        if (nl)
+            *nl = '\0';
+        if (strstr(line, ":PASS"))
+            r->tests++;
+        else if (strstr(line, ":FAIL"))
+            r->tests++, r->failures++;
+        else if (strstr(line, ":IGNORE"))
+            r->tests++, r->ignored++;
+        if (nl)
+            *nl = '\n';
+        line = nl ? nl + 1 : NULL;
+    }
+}
+
+static void finish_suite(const struct unity_suite *suite, struct suite_run *r)
+{
+    const char *summary = NULL;
+    char line[160];
+    int status;
+
+    close(r->fd);
+    r->fd = -1;
+    while (waitpid(r->pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    r->done = 1;
+
+    /* The last summary in the output is the suite's own */
+    for (const char *p = r->out; p && (p = strstr(p, SUMMARY_RULE)); p++)
+        summary = p + strlen(SUMMARY_RULE);
+    if (WIFEXITED(status) && summary &&
+        sscanf(summary, "%d Tests %d Failures %d Ignored",
+               &r->tests, &r->failures, &r->ignored) == 3)
+        return;
+
+    /* Died before UnityEnd(): keep what it reported and fail it once more */
+    count_results(r);
+    if (r->len && r->out[r->len - 1] != '\n')
+        append(r, "\n", 1);
+    if (WIFSIGNALED(status))
+        snprintf(line, sizeof(line), "%s:0:%s_main:FAIL: Suite killed by signal %d (%s)\n",
+                 suite->name, suite->name, WTERMSIG(status), strsignal(WTERMSIG(status)));
+    else
+        snprintf(line, sizeof(line), "%s:0:%s_main:FAIL: Suite exited with status %d "
+                 "without a summary\n", suite->name, suite->name, WEXITSTATUS(status));
+    append(r, line, strlen(line));
+    r->tests++;
+    r->failures++;
+}
+
+/* Add the timings of a finished run to t, keyed "Test_X.test[/bench]" */
+static void collect_timings(const struct unity_suite *suite, struct suite_run *r,
+                            struct perf_table *t)
+{
+    char test[256], name[256], key[600];
+    unsigned long long ns;
+
+    rewind(r->times);
+    while (fscanf(r->times, "%255s %llu", test, &ns) == 2) {
+        snprintf(key, sizeof(key), "%s.%s", suite->name, test);
+        perf_add(t, key, ns);
+    }
+    fclose(r->times);
+    r->times = NULL;
+
+    /* "BENCH test=<test> name=<name> ... median_ns=<ns> ...", see Unity/extras/bench */
+    for (const char *line = r->out; line && *line; ) {
+        const char *nl = strchr(line, '\n');
+        const char *median = strstr(line, " median_ns=");
+        double median_ns;
+
+        if (strncmp(line, BENCH_PREFIX, strlen(BENCH_PREFIX)) == 0 &&
+            median && (!nl || median < nl) &&
+            sscanf(line, BENCH_PREFIX "%255s name=%255s", test, name) == 2 &&
+            sscanf(median, " median_ns=%lf", &median_ns) == 1) {
+            snprintf(key, sizeof(key), "%s.%s/%s", suite->name, test, name);
+            perf_add(t, key, median_ns);
+        }
+        line = nl ? nl + 1 : NULL;
+    }
+}
+
+/*
+ * Suite output bypasses stdio, so stdout is still unused when later children
+ * are forked and they can make it line buffered
+ */
+static void write_all(const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        buf += n;
+        len -= n;
+    }
+}
+
+static int default_jobs(void)
+{
+    const char *env = getenv("UNITY_JOBS");
+
+    return env && *env ? atoi(env) : 1;
+}
+
+static int usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-j jobs (0 for one per CPU)] [-s] [-r repeats] "
+            "[-w new baseline] [-b baseline]\n", prog);
+    return 1;
+}
+
+/* Compare this run's timings with the baseline and/or save them */
+static int check_baseline(const struct perf_table *timings, const struct perf_table *base,
+                          const char *baseline, const char *save, int *tests)
+{
+    int slower = 0, compared;
+
+    if (baseline) {
+        slower = perf_compare(base, timings, stdout, &compared);
+        printf("%d of %d timings slower than baseline %s\n", slower, compared, baseline);
+        *tests += slower;
+    }
+    if (save && perf_save(timings, save) != 0) {
+        fprintf(stderr, "%s: %s\n", save, strerror(errno));
+        exit(255);
+    }
+    return slower;
+}
+
+int unity_run_suites(const struct unity_suite *suites, int count, int argc, char **argv)
+{
+    struct suite_run *runs;
+    struct pollfd *pfds;
+    struct perf_table timings = { 0 }, base = { 0 };
+    const char *baseline = NULL, *save = NULL;
+    int *pidx;
+    int jobs = default_jobs(), serial = 0, repeats = 1, opt;
+    int next = 0, running = 0, printed = 0, total;
+    int tests = 0, failures = 0, ignored = 0;
+
+    while ((opt = getopt(argc, argv, "j:sr:w:b:")) != -1) {
+        switch (opt) {
+        case 'j': jobs = atoi(optarg); break;
+        case 's': serial = 1; break;
+        case 'r': repeats = atoi(optarg); break;
+        case 'w': save = optarg; break;
+        case 'b': baseline = optarg; break;
+        default: return usage(argv[0]);
+        }
+    }
+    /* Timings come from the children, so a baseline needs the pool */
+    if (optind != argc || jobs < 0 || repeats < 1 || (serial && (save || baseline)))
+        return usage(argv[0]);
+    if (jobs == 0)
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1)
+        jobs = 1;
+    if (jobs > RUNNER_MAX_JOBS)
+        jobs = RUNNER_MAX_JOBS;
+
+    if (serial) {
+        /* Every suite runs, even after a failing one */
+        for (int i = 0; i < count * repeats; i++)
+            failures += run_suite(suite_of(suites, count, i));
+        return failures > 255 ? 255 : failures;
+    }
+
+    if (baseline && perf_load(&base, baseline) != 0) {
+        fprintf(stderr, "%s: %s\n", baseline, strerror(errno));
+        return 255;
+    }
+
+    total = count * repeats;
+    runs = calloc(total, sizeof(*runs));
+    pfds = calloc(jobs, sizeof(*pfds));
+    pidx = calloc(jobs, sizeof(*pidx));
+    if ((total && !runs) || !pfds || !pidx) {
+        perror("calloc");
+        return 255;
+    }
+
+    while (printed < total) {
+        int n = 0;
+
+        while (running < jobs && next < total) {
+            if ((save || baseline) && !(runs[next].times = tmpfile())) {
+                perror("tmpfile");
+                exit(255);
+            }
+            if (start_suite(suite_of(suites, count, next), &runs[next]) != 0) {
+                perror("fork");
+                exit(255);
+            }
+            running++;
+            next++;
+        }
+
+        for (int i = 0; i < next; i++) {
+            if (runs[i].fd >= 0 && !runs[i].done && runs[i].pid) {
+                pfds[n].fd = runs[i].fd;
+                pfds[n].events = POLLIN;
+                pidx[n++] = i;
+            }
+        }
+        if (n && poll(pfds, n, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            exit(255);
+        }
+        for (int k = 0; k < n; k++) {
+            struct suite_run *r = &runs[pidx[k]];
+            char buf[65536];
+            ssize_t len;
+
+            if (!pfds[k].revents)
+                continue;
+            len = read(r->fd, buf, sizeof(buf));
+            if (len > 0) {
+                append(r, buf, len);
+            } else if (len == 0 || errno != EINTR) {
+                finish_suite(suite_of(suites, count, pidx[k]), r);
+                running--;
+            }
+        }
+
+        /* In suite order, whatever finished since */
+        while (printed < next && runs[printed].done) {
+            struct suite_run *r = &runs[printed];
+            if (r->times)
+                collect_timings(suite_of(suites, count, printed), r, &timings);
+            printed++;
+            write_all(r->out, r->len);
+            tests += r->tests;
+            failures += r->failures;
+            ignored += r->ignored;
+            free(r->out);
+        }
+    }
+
+    if (save || baseline)
+        failures += check_baseline(&timings, &base, baseline, save, &tests);
+    perf_free(&timings);
+    perf_free(&base);
+
+    printf("\n" SUMMARY_RULE "%d Tests %d Failures %d Ignored \n%s\n",
+           tests, failures, ignored, failures ? "FAIL" : "OK");
+    free(runs);
+    free(pfds);
+    free(pidx);
+    return failures > 255 ? 255 : failures;
+}
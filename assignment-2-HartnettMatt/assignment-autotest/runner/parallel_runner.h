@@ -0,0 +1,50 @@
+/******************************************************************************
+ * parallel_runner.h
+ *
+ * Runs the Unity test suites of assignment-autotest, called from the main()
+ * that auto_generate.sh writes into test/unity_runner.c, or from the one in
+ * registered_main.c when the tests register themselves with UNITY_TEST().
+ *
+ * Every suite (one Test_X.c file, run by its generated Test_X_main() or by
+ * UnityRunRegisteredFile() from Unity/extras/register) runs
+ * in a child process from a pool of up to <jobs> processes. A child's
+ * stdout goes to the parent through a pipe; the parent prints each suite's
+ * output in suite order, so it reads the same as a serial run however the
+ * suites were scheduled, then prints one Unity summary for all of them.
+ *
+ * Crashes are contained at two levels. In the child, SIGSEGV, SIGBUS, SIGFPE
+ * and SIGILL in a test fail that test through Unity's abort frame and the
+ * suite carries on with the next test. A child that dies anyway (abort(), a
+ * second crash, exit() from a test) has the tests it reported counted, plus
+ * one failure naming the signal or exit status. Other suites are unaffected.
+ *
+ * Options:
+ *   -j <jobs>  Suites run at once, 0 for one per online CPU. Defaults to
+ *              $UNITY_JOBS, or 1.
+ *   -s         Serial, in this process without forking (for debuggers).
+ *   -r <n>     Run every suite n times, for timings with more samples. The
+ *              suites run in n rounds of one run each, every round
+ *              starting one suite later than the previous one.
+ *   -w <file>  Save the timings of every test and benchmark that passed to
+ *              file, as a baseline for -b (see perf_baseline.h).
+ *   -b <file>  Compare the timings with the baseline in file. Each one
+ *              that got significantly slower, by 10% or more, is reported
+ *              as a failed test.
+ *              Use -j 1 and -r 10 or more for both runs.
+ *
+ * The exit status is the total number of failures, at most 255.
+ *
+ *****************************************************************************/
+
+#ifndef PARALLEL_RUNNER_H
+#define PARALLEL_RUNNER_H
+
+struct unity_suite {
+    const char *name;           /* Test_X */
+    int (*run)(void);           /* Test_X_main(), returns its failure count */
+    const char *file;           /* When run is NULL, the file of registered tests */
+};
+
+int unity_run_suites(const struct unity_suite *suites, int count, int argc, char **argv);
+
+#endif /* PARALLEL_RUNNER_H */
@@ -0,0 +1,274 @@
+/******************************************************************************
+ * perf_baseline.c
+ *
+ * Baseline store and Mann-Whitney comparison of suite timings, see
+ * perf_baseline.h.
+ *
+ * Tables are small (a key per test or benchmark) and built once per run,
+ * so keys are found with a linear search.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "perf_baseline.h"
+
+#define PERF_MAX_KEY    512
+
+static void *xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (!p) {
+        perror("realloc");
+        exit(255);
+    }
+    return p;
+}
+
+static struct perf_timing *perf_find(const struct perf_table *t, const char *key)
+{
+    for (int i = 0; i < t->count; i++)
+        if (strcmp(t->timings[i].key, key) == 0)
+            return &t->timings[i];
+    return NULL;
+}
+
+void perf_add(struct perf_table *t, const char *key, double ns)
+{
+    struct perf_timing *p = perf_find(t, key);
+
+    if (!p) {
+        if (t->count == t->cap) {
+            t->cap = t->cap ? t->cap * 2 : 64;
+            t->timings = xrealloc(t->timings, t->cap * sizeof(*t->timings));
+        }
+        p = &t->timings[t->count++];
+        memset(p, 0, sizeof(*p));
+        p->key = strdup(key);
+        if (!p->key) {
+            perror("strdup");
+            exit(255);
+        }
+    }
+    if (p->count == p->cap) {
+        p->cap = p->cap ? p->cap * 2 : 8;
+        p->ns = xrealloc(p->ns, p->cap * sizeof(*p->ns));
+    }
+    p->ns[p->count++] = ns;
+}
+
+void perf_free(struct perf_table *t)
+{
+    for (int i = 0; i < t->count; i++) {
+        free(t->timings[i].key);
+        free(t->timings[i].ns);
+    }
+    free(t->timings);
+    memset(t, 0, sizeof(*t));
+}
+
+int perf_load(struct perf_table *t, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char key[PERF_MAX_KEY];
+    int count;
+
+    if (!f)
+        return -1;
+    while (fscanf(f, "%511s %d", key, &count) == 2) {
+        for (int i = 0; i < count; i++) {
+            double ns;
+            if (fscanf(f, "%lf", &ns) != 1) {
+                fclose(f);
+                errno = EINVAL;
+                return -1;
+            }
+            perf_add(t, key, ns);
+        }
+    }
+    if (!feof(f)) {
+        fclose(f);
+        errno = EINVAL;
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+int perf_save(const struct perf_table *t, const char *path)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f)
+        return -1;
+    for (int i = 0; i < t->count; i++) {
+        const struct perf_timing *p = &t->timings[i];
+        fprintf(f, "%s %d", p->key, p->count);
+        for (int k = 0; k < p->count; k++)
+            fprintf(f, " %.0f", p->ns[k]);
+        fputc('\n', f);
+    }
+    if (fclose(f) != 0)
+        return -1;
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double median(const double *ns, int count)
+{
+    double *s = xrealloc(NULL, count * sizeof(*s));
+    double m;
+
+    memcpy(s, ns, count * sizeof(*s));
+    qsort(s, count, sizeof(*s), cmp_double);
+    m = count % 2 ? s[count / 2] : (s[count / 2 - 1] + s[count / 2]) / 2;
+    free(s);
+    return m;
+}
+
+struct ranked {
+    double  ns;
+    int     cur;            /* From the new samples rather than the baseline */
+};
+
+static int cmp_ranked(const void *a, const void *b)
+{
+    return cmp_double(&((const struct ranked *)a)->ns, &((const struct ranked *)b)->ns);
+}
+
+/*
+ * Normal approximation of U with the tie and continuity corrections, close
+ * enough to the exact distribution from about five samples a side
+ */
+double perf_mann_whitney(const double *base, int nbase, const double *cur, int ncur)
+{
+    int n = nbase + ncur;
+    struct ranked *all;
+    double rank_sum = 0, ties = 0, u, mean, var, z;
+
+    if (nbase < 1 || ncur < 1)
+        return 1.0;
+    all = xrealloc(NULL, n * sizeof(*all));
+    for (int i = 0; i < nbase; i++)
+        all[i] = (struct ranked){ base[i], 0 };
+    for (int i = 0; i < ncur; i++)
+        all[nbase + i] = (struct ranked){ cur[i], 1 };
+    qsort(all, n, sizeof(*all), cmp_ranked);
+
+    /* Equal samples share the average of their ranks (1 based) */
+    for (int i = 0; i < n; ) {
+        int j = i;
+        double t;
+        while (j < n && all[j].ns == all[i].ns)
+            j++;
+        t = j - i;
+        for (int k = i; k < j; k++)
+            if (all[k].cur)
+                rank_sum += (i + 1 + j) / 2.0;
+        ties += t * t * t - t;
+        i = j;
+    }
+    free(all);
+
+    u = rank_sum - ncur * (ncur + 1) / 2.0;
+    mean = nbase * (double)ncur / 2;
+    var = nbase * (double)ncur / 12 * ((n + 1) - (n > 1 ? ties / ((double)n * (n - 1)) : 0));
+    if (var <= 0)
+        return 1.0;
+    z = (u - mean - 0.5) / sqrt(var);
+    return 0.5 * erfc(z / sqrt(2));
+}
+
+static const char *format_ns(double ns, char *buf, size_t len)
+{
+    if (ns >= 1e9)
+        snprintf(buf, len, "%.3g s", ns / 1e9);
+    else if (ns >= 1e6)
+        snprintf(buf, len, "%.3g ms", ns / 1e6);
+    else if (ns >= 1e3)
+        snprintf(buf, len, "%.3g us", ns / 1e3);
+    else
+        snprintf(buf, len, "%.3g ns", ns);
+    return buf;
+}
+
+struct verdict {
+    const struct perf_timing *cur;
+    const struct perf_timing *base;
+    double  p;
+    int     index;          /* Of cur in its table, to restore the order */
+};
+
+static int cmp_p(const void *a, const void *b)
+{
+    return cmp_double(&((const struct verdict *)a)->p, &((const struct verdict *)b)->p);
+}
+
+static int cmp_index(const void *a, const void *b)
+{
+    return ((const struct verdict *)a)->index - ((const struct verdict *)b)->index;
+}
+
+/*
+ * Every timing compared is one more chance of a false alarm, so the
+ * p-values go through Holm's step-down correction: the k-th smallest of m
+ * (from 0) is significant when it and all smaller ones are below
+ * PERF_ALPHA / (m - k). That keeps the chance of any false report below
+ * PERF_ALPHA however many tests and benchmarks there are.
+ */
+int perf_compare(const struct perf_table *base, const struct perf_table *cur,
+                 FILE *out, int *compared)
+{
+    struct verdict *v = xrealloc(NULL, (cur->count + 1) * sizeof(*v));
+    int m = 0, significant = 0, slower = 0;
+
+    for (int i = 0; i < cur->count; i++) {
+        const struct perf_timing *c = &cur->timings[i];
+        const struct perf_timing *b = perf_find(base, c->key);
+
+        if (!b || !b->count || !c->count)
+            continue;
+        v[m].cur = c;
+        v[m].base = b;
+        v[m].p = perf_mann_whitney(b->ns, b->count, c->ns, c->count);
+        v[m].index = i;
+        m++;
+    }
+    *compared = m;
+
+    qsort(v, m, sizeof(*v), cmp_p);
+    while (significant < m && v[significant].p < PERF_ALPHA / (m - significant))
+        significant++;
+    /* Reported in the order the tests ran */
+    qsort(v, significant, sizeof(*v), cmp_index);
+
+    for (int k = 0; k < significant; k++) {
+        const struct perf_timing *c = v[k].cur, *b = v[k].base;
+        const char *test;
+        char was[32], now[32];
+        double mb = median(b->ns, b->count), mc = median(c->ns, c->count);
+
+        if (mb <= 0 || mc < mb * (1 + PERF_MIN_SLOWDOWN))
+            continue;
+
+        /* Same form as Unity's result lines, so the tools count it as a failure */
+        test = strchr(c->key, '.');
+        fprintf(out, "%.*s:0:%s:FAIL: Slower than baseline, median %s against %s "
+                "(+%.0f%%, p=%.4f of %d timings, %d and %d runs)\n",
+                test ? (int)(test - c->key) : 0, c->key, test ? test + 1 : c->key,
+                format_ns(mc, now, sizeof(now)), format_ns(mb, was, sizeof(was)),
+                (mc / mb - 1) * 100, v[k].p, m, c->count, b->count);
+        slower++;
+    }
+    free(v);
+    return slower;
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * perf_baseline.h
+ *
+ * Timings of the Unity suites, saved to a baseline file and compared with
+ * later runs, for the -r, -w and -b options of parallel_runner.c.
+ *
+ * A timing has a key, "Test_X.test_name" for the time a test took or
+ * "Test_X.test_name/bench_name" for the median of a TEST_BENCHMARK in it,
+ * and one sample in nanoseconds for each run of its suite. The baseline
+ * file is text with one line per key: the key, the number of samples, then
+ * the samples.
+ *
+ * A timing is slower than its baseline when a one-sided Mann-Whitney U test
+ * finds the new samples larger, significant at PERF_ALPHA after Holm's
+ * correction for the number of timings compared, and their median grew by
+ * at least PERF_MIN_SLOWDOWN of the baseline median. The U test only
+ * compares ranks, so a few samples disturbed by other processes don't
+ * move it, but it needs around five samples on each side to get below
+ * p = 0.01 at all, and around ten once the correction divides that by the
+ * number of tests and benchmarks.
+ *
+ *****************************************************************************/
+
+#ifndef PERF_BASELINE_H
+#define PERF_BASELINE_H
+
+#include <stdio.h>
+
+/* Chance of reporting any timing slower when none is, across all of them */
+#ifndef PERF_ALPHA
+#define PERF_ALPHA          0.01
+#endif
+
+/* Smallest slowdown of the median reported, as a fraction of the baseline median */
+#ifndef PERF_MIN_SLOWDOWN
+#define PERF_MIN_SLOWDOWN   0.10
+#endif
+
+struct perf_timing {
+    char   *key;
+    double *ns;
+    int     count;
+    int     cap;
+};
+
+struct perf_table {
+    struct perf_timing *timings;
+    int     count;
+    int     cap;
+};
+
+void perf_add(struct perf_table *t, const char *key, double ns);
+void perf_free(struct perf_table *t);
+
+/* Both return 0, or -1 with errno set */
+int perf_load(struct perf_table *t, const char *path);
+int perf_save(const struct perf_table *t, const char *path);
+
+/* One-sided p-value of the samples in cur being larger than those in base */
+double perf_mann_whitney(const double *base, int nbase, const double *cur, int ncur);
+
+/*
+ * Prints a Unity "Test_X:0:test:FAIL: ..." line to out for every timing in
+ * cur slower than in base and returns how many there were. *compared is
+ * set to the number of timings found in both.
+ */
+int perf_compare(const struct perf_table *base, const struct perf_table *cur,
+                 FILE *out, int *compared);
+
+#endif /* PERF_BASELINE_H */
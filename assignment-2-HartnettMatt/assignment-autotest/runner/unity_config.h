@@ -0,0 +1,36 @@
+/******************************************************************************
+ * unity_config.h
+ *
+ * Unity configuration of assignment-autotest, included by Unity through
+ * UNITY_INCLUDE_CONFIG_H (see Unity/docs/UnityConfigurationGuide.md).
+ *
+ * Unity's execution time hooks hand every test's duration in nanoseconds
+ * to the runner, which keeps them for the perf baseline (see
+ * perf_baseline.h) instead of printing them, so the output is unchanged.
+ *
+ * Every test also runs in a process of its own, with a time limit of a
+ * minute unless it sets another with TEST_TIMEOUT_MS().
+ *
+ *****************************************************************************/
+
+#ifndef UNITY_CONFIG_H
+#define UNITY_CONFIG_H
+
+#define UNITY_INCLUDE_EXEC_TIME
+#define UNITY_TIME_TYPE             unsigned long long
+#define UNITY_EXEC_TIME_START()     (Unity.CurrentTestStartTime = unity_runner_clock_ns())
+#define UNITY_EXEC_TIME_STOP()                                                  \
+    unity_runner_test_time(Unity.CurrentTestName,                               \
+                           unity_runner_clock_ns() - Unity.CurrentTestStartTime, \
+                           Unity.CurrentTestFailed || Unity.CurrentTestIgnored)
+#define UNITY_PRINT_EXEC_TIME()     do {} while (0)
+
+/* Each test runs in its own process, so one that crashes or hangs fails by itself */
+#define UNITY_ISOLATE_TESTS
+#define UNITY_TEST_TIMEOUT_MS       60000
+
+/* In runner/parallel_runner.c */
+unsigned long long unity_runner_clock_ns(void);
+void unity_runner_test_time(const char *test, unsigned long long ns, int failed);
+
+#endif /* UNITY_CONFIG_H */
@@ -1,7 +1,8 @@
 #include "unity.h"
+#include "unity_register.h"
 #include <stdbool.h>
 
-void test_hello()
+UNITY_TEST(test_hello)
 {
     TEST_MESSAGE("Hello!  Your unity setup is working!");
     TEST_ASSERT_TRUE_MESSAGE(true,"This assertion passed!");
@@ -1,4 +1,5 @@
 #include "unity.h"
+#include "unity_register.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,7 +26,7 @@
 **/
 #define REDIRECT_FILE "testfile.txt"
 
-void test_systemcalls()
+UNITY_TEST(test_systemcalls)
 {
 
     printf("Running tests at %s : function %s\n",__FILE__,__func__);
@@ -55,7 +56,7 @@ void test_systemcalls()
 
 }
 
-void test_exec_calls()
+UNITY_TEST(test_exec_calls)
 {
     printf("Running tests at %s : function %s\n",__FILE__,__func__);
     TEST_ASSERT_FALSE_MESSAGE(do_exec(2, "echo", "Testing execv implementation with echo"),
@@ -69,7 +70,7 @@ void test_exec_calls()
              " and test -f verifies this is a valid file");
 }
 
-void test_exec_redirect_calls()
+UNITY_TEST(test_exec_redirect_calls)
 {
     printf("Running tests at %s : function %s\n",__FILE__,__func__);
     do_exec_redirect(REDIRECT_FILE, 3, "/bin/sh", "-c", "echo home is $HOME");
@@ -1,6 +1,7 @@
 #define _GNU_SOURCE // use the gnu extension so we have pthread_tryjoin_mp available
 #include <pthread.h>
 #include "unity.h"
+#include "unity_register.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -83,7 +84,7 @@ static void validate_thread_waits_for_mutex(pthread_t *thread, pthread_mutex_t *
  * and joinable is not set until the mutex is released and a wait of wait_to_release_ms*number of seconds elapses.
  *
 */
-void test_threading_single_locked_mutex()
+UNITY_TEST(test_threading_single_locked_mutex)
 {
     pthread_t thread;
     pthread_mutex_t mutex;
@@ -109,7 +110,7 @@ void test_threading_single_locked_mutex()
  * This test verifies the threads handle unlocked mutex cases appropriately
  * and just waits for sleep_before_lock and sleep_after_lock conditions, then exits
  */
-void test_threading_single_unlocked_mutex()
+UNITY_TEST(test_threading_single_unlocked_mutex)
 {
     pthread_t thread;
     pthread_mutex_t mutex;
@@ -157,7 +158,7 @@ bool validate_thread_setup(pthread_t *thread, pthread_mutex_t *mutex, unsigned i
  * mutiple threads with dynamic allocation, or aren't correctly allocating the right mutex to the
  * appropriate threads.
  */
-void test_threading_two_threads_two_mutexes()
+UNITY_TEST(test_threading_two_threads_two_mutexes)
 {
     pthread_t thread1;
     pthread_mutex_t mutex1;
@@ -194,7 +195,7 @@ void test_threading_two_threads_two_mutexes()
  * This test is similar to the two_threads_two_mutex case but 
  * each thread shares the same mutex.
  */
-void test_threading_two_threads_one_mutex()
+UNITY_TEST(test_threading_two_threads_one_mutex)
 {
     pthread_t thread1;
     pthread_mutex_t mutex1;
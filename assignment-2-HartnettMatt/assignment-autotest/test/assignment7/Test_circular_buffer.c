@@ -9,6 +9,7 @@
 * for unity assertion references.
 */
 #include "unity.h"
+#include "unity_register.h"
 #include "../../../aesd-char-driver/aesd-circular-buffer.h"
 #include <string.h>
 
@@ -65,7 +66,7 @@ static void verify_find_entry_not_found(struct aesd_circular_buffer *buffer, siz
 * Tests the circular buffer by writing a set of 10 strings, verifying each request for
 * associated offset returns the correct location in the buffer
 */
-void test_circular_buffer(void)
+UNITY_TEST(test_circular_buffer)
 {
     struct aesd_circular_buffer buffer;
     aesd_circular_buffer_init(&buffer);
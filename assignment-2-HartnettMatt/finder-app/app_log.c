@@ -0,0 +1,312 @@
+/******************************************************************************
+ * app_log.c
+ *
+ * Author: Matt Hartnett
+ *
+ * Buffered syslog client, see app_log.h.
+ *
+ * Each queued record keeps its own buffer, so sending is one sendmmsg()
+ * over an array of iovecs without any copying. The header of a record is
+ * "<pri>" followed by the cached "Mmm dd hh:mm:ss ident[pid]: " prefix; the
+ * previous message text is kept separately to detect repeats.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "app_log.h"
+
+#define APP_LOG_PATH "/dev/log"
+
+static struct {
+    pthread_mutex_t lock;
+    char            ident[64];
+    int             option;
+    int             facility;
+    int             fd;
+    int             registered;             /* atexit() flush */
+
+    /* Queue */
+    char            rec[APP_LOG_BATCH][APP_LOG_RECORD];
+    size_t          rec_len[APP_LOG_BATCH];
+    int             queued;
+    int64_t         oldest_ms;              /* When rec[0] was queued */
+
+    /* "Mmm dd hh:mm:ss ident[pid]: ", rebuilt every second */
+    time_t          prefix_sec;
+    char            prefix[128];
+    int             prefix_len;
+
+    /* Repeats of the previous message */
+    char            last[APP_LOG_RECORD];
+    size_t          last_len;
+    int             last_pri;
+    unsigned long   repeats;
+
+    /* Rate limit */
+    time_t          rate_sec;
+    unsigned long   rate_count;
+    unsigned long   dropped;
+} lg = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .facility = LOG_USER,
+    .fd = -1,
+    .prefix_sec = -1,
+    .last_pri = -1,
+};
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void connect_log(void)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX, .sun_path = APP_LOG_PATH };
+
+    if (lg.fd >= 0)
+        return;
+    lg.fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (lg.fd < 0)
+        return;
+    if (connect(lg.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(lg.fd);
+        lg.fd = -1;
+    }
+}
+
+/* With LOG_CONS, records that can't be sent go to the console instead */
+static void to_console(int first)
+{
+    int fd = open("/dev/console", O_WRONLY | O_NOCTTY | O_CLOEXEC);
+
+    if (fd < 0)
+        return;
+    for (int i = first; i < lg.queued; i++) {
+        /* Without the "<pri>" */
+        const char *start = memchr(lg.rec[i], '>', lg.rec_len[i]);
+        start = start ? start + 1 : lg.rec[i];
+        struct iovec iov[2] = {
+            { (void *)start, lg.rec_len[i] - (start - lg.rec[i]) },
+            { "\r\n", 2 },
+        };
+        if (writev(fd, iov, 2) < 0)
+            break;
+    }
+    close(fd);
+}
+
+/* Send the queue, called with the lock held */
+static void send_queue(void)
+{
+    struct mmsghdr msgs[APP_LOG_BATCH];
+    struct iovec iov[APP_LOG_BATCH];
+    int sent = 0, retried = 0;
+
+    if (!lg.queued)
+        return;
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < lg.queued; i++) {
+        iov[i].iov_base = lg.rec[i];
+        iov[i].iov_len = lg.rec_len[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    connect_log();
+    while (sent < lg.queued && lg.fd >= 0) {
+        int n = sendmmsg(lg.fd, msgs + sent, lg.queued - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        /* The daemon may have restarted, reconnect once */
+        close(lg.fd);
+        lg.fd = -1;
+        if (retried++)
+            break;
+        connect_log();
+    }
+    if (sent < lg.queued && (lg.option & LOG_CONS))
+        to_console(sent);
+    lg.queued = 0;
+}
+
+/* Add a record for msg, called with the lock held */
+static void queue(int pri, const char *msg, size_t len, int64_t ms)
+{
+    char *rec;
+    int head;
+
+    if (lg.queued == APP_LOG_BATCH)
+        send_queue();
+    if (!lg.queued)
+        lg.oldest_ms = ms;
+    rec = lg.rec[lg.queued];
+    head = snprintf(rec, APP_LOG_RECORD, "<%d>%.*s", pri, lg.prefix_len, lg.prefix);
+    if (head >= APP_LOG_RECORD)
+        head = APP_LOG_RECORD - 1;
+    if (len > (size_t)(APP_LOG_RECORD - head))
+        len = APP_LOG_RECORD - head;
+    memcpy(rec + head, msg, len);
+    lg.rec_len[lg.queued++] = head + len;
+}
+
+/* Report and reset the repeat count, with the lock held */
+static void queue_repeats(int64_t ms)
+{
+    char msg[64];
+    int len;
+
+    if (!lg.repeats)
+        return;
+    len = snprintf(msg, sizeof(msg), "last message repeated %lu times", lg.repeats);
+    queue(lg.last_pri, msg, len, ms);
+    lg.repeats = 0;
+}
+
+/* Report and reset the rate limit count, with the lock held */
+static void queue_dropped(int64_t ms)
+{
+    char msg[64];
+    int len;
+
+    if (!lg.dropped)
+        return;
+    len = snprintf(msg, sizeof(msg), "%lu messages suppressed by rate limit", lg.dropped);
+    queue(lg.facility | LOG_WARNING, msg, len, ms);
+    lg.dropped = 0;
+}
+
+static void update_prefix(time_t sec)
+{
+    struct tm tm;
+    int n;
+
+    lg.prefix_sec = sec;
+    localtime_r(&sec, &tm);
+    n = strftime(lg.prefix, sizeof(lg.prefix), "%h %e %T ", &tm);
+    if (lg.option & LOG_PID)
+        n += snprintf(lg.prefix + n, sizeof(lg.prefix) - n, "%s[%d]: ",
+                      lg.ident, (int)getpid());
+    else
+        n += snprintf(lg.prefix + n, sizeof(lg.prefix) - n, "%s: ", lg.ident);
+    lg.prefix_len = n < (int)sizeof(lg.prefix) ? n : (int)sizeof(lg.prefix) - 1;
+}
+
+static void flush_at_exit(void)
+{
+    app_log_flush();
+}
+
+void app_log_open(const char *ident, int option, int facility)
+{
+    pthread_mutex_lock(&lg.lock);
+    snprintf(lg.ident, sizeof(lg.ident), "%s", ident ? ident : program_invocation_short_name);
+    lg.option = option;
+    lg.facility = facility & LOG_FACMASK;
+    lg.prefix_sec = -1;
+    if (option & LOG_NDELAY)
+        connect_log();
+    if (!lg.registered)
+        lg.registered = atexit(flush_at_exit) == 0;
+    pthread_mutex_unlock(&lg.lock);
+}
+
+void app_log_write(int priority, const char *fmt, ...)
+{
+    int saved = errno;
+    char msg[APP_LOG_RECORD];
+    va_list ap;
+    int len;
+    time_t sec = time(NULL);
+    int64_t ms = now_ms();
+
+    errno = saved;    /* For %m */
+    va_start(ap, fmt);
+    len = vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    if (len < 0)
+        len = 0;
+    if (len >= (int)sizeof(msg))
+        len = sizeof(msg) - 1;
+
+    pthread_mutex_lock(&lg.lock);
+    if (!(priority & LOG_FACMASK))
+        priority |= lg.facility;
+    if (!lg.ident[0])
+        snprintf(lg.ident, sizeof(lg.ident), "%s", program_invocation_short_name);
+    if (sec != lg.prefix_sec)
+        update_prefix(sec);
+
+    if (priority == lg.last_pri && (size_t)len == lg.last_len &&
+        memcmp(msg, lg.last, len) == 0) {
+        lg.repeats++;
+    } else {
+        queue_repeats(ms);
+        if (sec != lg.rate_sec) {
+            queue_dropped(ms);
+            lg.rate_sec = sec;
+            lg.rate_count = 0;
+        }
+        if (lg.rate_count < APP_LOG_RATE || LOG_PRI(priority) <= LOG_ERR) {
+            lg.rate_count++;
+            queue(priority, msg, len, ms);
+            memcpy(lg.last, msg, len);
+            lg.last_len = len;
+            lg.last_pri = priority;
+        } else {
+            lg.dropped++;
+            lg.last_pri = -1;
+        }
+    }
+
+    if (LOG_PRI(priority) <= LOG_ERR || ms - lg.oldest_ms >= APP_LOG_FLUSH_MS)
+        send_queue();
+    pthread_mutex_unlock(&lg.lock);
+    errno = saved;
+}
+
+void app_log_flush(void)
+{
+    int saved = errno;
+
+    pthread_mutex_lock(&lg.lock);
+    queue_repeats(now_ms());
+    queue_dropped(now_ms());
+    send_queue();
+    /* The next message starts a new repeat run */
+    lg.last_len = 0;
+    lg.last_pri = -1;
+    pthread_mutex_unlock(&lg.lock);
+    errno = saved;
+}
+
+void app_log_close(void)
+{
+    app_log_flush();
+    pthread_mutex_lock(&lg.lock);
+    if (lg.fd >= 0)
+        close(lg.fd);
+    lg.fd = -1;
+    pthread_mutex_unlock(&lg.lock);
+}
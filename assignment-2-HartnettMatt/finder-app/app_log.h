@@ -0,0 +1,66 @@
+/******************************************************************************
+ * app_log.h
+ *
+ * Author: Matt Hartnett
+ *
+ * Buffered syslog client for the finder-app tools, a replacement for
+ * openlog()/syslog()/closelog() that is cheap enough to call once per file.
+ *
+ *  - Records are formatted like syslog(3) does ("<pri>Mmm dd hh:mm:ss
+ *    ident[pid]: message") into a fixed set of reused buffers, with the
+ *    timestamp prefix only rebuilt when the second changes.
+ *  - Up to APP_LOG_BATCH records are queued and sent to /dev/log with a
+ *    single sendmmsg(), one datagram per record as syslog daemons expect.
+ *    The queue is sent when it is full, when it is older than
+ *    APP_LOG_FLUSH_MS, by app_log_flush() and app_log_close(). LOG_ERR and
+ *    more severe records are sent straight away, with whatever is queued
+ *    before them, so errors are never held back.
+ *  - A message identical to the previous one is counted instead of queued
+ *    and reported as "last message repeated N times", and at most
+ *    APP_LOG_RATE records are queued per second, the rest are counted and
+ *    reported as "N messages suppressed by rate limit". Errors are never
+ *    suppressed.
+ *  - Priorities less severe than APP_LOG_LEVEL (LOG_DEBUG by default, set
+ *    it with -DAPP_LOG_LEVEL=LOG_INFO for example) are removed at compile
+ *    time, arguments included.
+ *
+ * Priorities and facilities are the ones from <syslog.h>, and LOG_PID and
+ * LOG_CONS work as in openlog(). The functions are thread safe.
+ *
+ *****************************************************************************/
+
+#ifndef APP_LOG_H
+#define APP_LOG_H
+
+#include <syslog.h>
+
+#ifndef APP_LOG_LEVEL
+#define APP_LOG_LEVEL    LOG_DEBUG
+#endif
+#define APP_LOG_BATCH    32         /* Records per sendmmsg() */
+#define APP_LOG_RECORD   1024       /* Longest record, longer ones are cut */
+#define APP_LOG_FLUSH_MS 200        /* Longest a queued record waits */
+#ifndef APP_LOG_RATE
+#define APP_LOG_RATE     1000       /* Records per second before suppressing */
+#endif
+
+/* Like openlog(), without LOG_NDELAY the socket is connected on first use */
+void app_log_open(const char *ident, int option, int facility);
+
+/* Like syslog(), including %m. Use app_log() so the level check is static */
+void app_log_write(int priority, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#define app_log(priority, ...)                          \
+    do {                                                \
+        if (LOG_PRI(priority) <= APP_LOG_LEVEL)         \
+            app_log_write(priority, __VA_ARGS__);       \
+    } while (0)
+
+/* Send everything queued, including pending repeat and suppression counts */
+void app_log_flush(void);
+
+/* Flush and close the connection, like closelog() */
+void app_log_close(void);
+
+#endif /* APP_LOG_H */
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Compare the writer durability policies: throughput and the time until files are durable
+# Usage: durability-bench.sh [numfiles] [group] [dir]
+# The files are written to a private directory created inside dir (default
+# /var/tmp), which is the only thing removed afterwards. dir must be on the
+# filesystem being measured, /tmp is often tmpfs where every sync is free.
+# Author: Matt Hartnett
+
+set -e
+set -u
+
+NUMFILES=${1:-2000}
+GROUP=${2:-256}
+BASEDIR=${3:-/var/tmp}
+POLICIES="none fdatasync syncfs range"
+BACKENDS="sync uring"
+WRITESTR=$(head -c 4096 /dev/zero | tr '\0' x)
+
+cd "$(dirname "$0")/.."
+if [ ! -x ./writer ]; then
+    echo "Error: build writer first with make"
+    exit 1
+fi
+mkdir -p "${BASEDIR}"
+BENCHDIR=$(mktemp -d "${BASEDIR}/durability-bench.XXXXXX")
+trap 'rm -rf "${BENCHDIR}"' EXIT
+trap 'exit 1' HUP INT PIPE TERM
+
+printf "%-9s %-6s %8s %10s %8s %8s %12s %12s\n" \
+    policy backend files files/s MB/s commits avg_lat_ms max_lat_ms
+for policy in ${POLICIES}; do
+    for backend in ${BACKENDS}; do
+        rm -rf "${BENCHDIR}/run"
+        mkdir "${BENCHDIR}/run"
+        sync
+        stats=$(./writer -S -b "${backend}" -d "${policy}" -g "${GROUP}" \
+                -t "${BENCHDIR}/run/f%d" -n "${NUMFILES}" "${WRITESTR}" 2>&1 >/dev/null | tail -n 1)
+        # backend= durability= files= failed= bytes= elapsed= files/s= MB/s= commits=
+        # latency_avg_ms= latency_max_ms= commit_max_ms=
+        set -- ${stats}
+        printf "%-9s %-6s %8s %10s %8s %8s %12s %12s\n" "${policy}" "${1#backend=}" \
+            "${3#files=}" "${7#files/s=}" "${8#MB/s=}" "${9#commits=}" \
+            "${10#latency_avg_ms=}" "${11#latency_max_ms=}"
+    done
+done
@@ -0,0 +1,633 @@
+/******************************************************************************
+ * finder-bench.c
+ *
+ * Usage: finder-bench [-s seed] [-n files] [-d depth] [-w width] [-z min:max]
+ *                     [-m density] [-W writer_files] [-r repeats] [-D workdir]
+ *                     [-o results.json] [-b baseline.json] [-T percent] [-k]
+ *
+ * Author: Matt Hartnett
+ *
+ * Benchmark harness for finder-app. Build it with "make bench" and run it
+ * from anywhere, it finds finder.sh, finder and writer in the directory
+ * above itself.
+ *
+ * All files go to a private directory created with mkdtemp() inside
+ * <workdir> (default /tmp), which is removed at the end unless -k is given.
+ * Nothing else in <workdir> is touched.
+ *
+ * 1) Generates a reproducible corpus in <private dir>/corpus from the seed:
+ *    <files> files spread over a tree <depth> levels deep with <width>
+ *    subdirectories per level, sizes log-uniform between min and max bytes,
+ *    and lines of random lowercase words. A fraction <density> of the lines
+ *    get one of MATCH_TOKENS tokens "AELD_IS_FUN_<letter>", which can't occur
+ *    in the random text, so the expected counts are known exactly.
+ * 2) Runs each case <repeats> times: finder.sh on its grep pipeline, the
+ *    native finder (all threads, one thread, incremental with a warm index,
+ *    every token with -e), and writer creating <writer_files> files one
+ *    process per file, from a template with each backend, from a manifest,
+ *    and streaming one large file. Finder output is checked against the
+ *    expected counts.
+ * 3) Reports the median wall time, the median user and system CPU time and
+ *    the peak RSS (from wait4(), so children are included) and the number
+ *    of system calls (one extra run under ptrace(), following threads and
+ *    child processes) of each case as JSON, on stdout or to <results.json>.
+ * 4) With -b, compares the wall and CPU times to a previous results file and
+ *    exits with status 2 when a case got slower by more than <percent>
+ *    (default 20) and by more than NOISE_FLOOR_S.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define MATCH_TOKENS  16            /* AELD_IS_FUN_a .. AELD_IS_FUN_p */
+#define MATCH_PREFIX  "AELD_IS_FUN"
+#define MAX_CASES     16
+#define MAX_REPEATS   101
+#define NOISE_FLOOR_S 0.005         /* Ignore regressions smaller than this */
+#define STREAM_BYTES  (64 * 1024 * 1024)
+
+struct config {
+    unsigned long seed;
+    long          files;
+    int           depth;
+    int           width;
+    long          min_size;
+    long          max_size;
+    double        density;
+    long          writer_files;
+    int           repeats;
+    const char   *workdir;
+    const char   *output;
+    const char   *baseline;
+    double        threshold;
+    int           keep;
+};
+
+struct result {
+    char   name[64];
+    double wall;
+    double user;
+    double sys;
+    long   max_rss_kb;
+    long   syscalls;        /* -1 when ptrace() isn't allowed */
+};
+
+static struct config cfg = {
+    .seed = 1, .files = 2000, .depth = 3, .width = 4,
+    .min_size = 256, .max_size = 64 * 1024, .density = 0.01,
+    .writer_files = 1000, .repeats = 3, .workdir = "/tmp",
+    .threshold = 20,
+};
+
+static char appdir[PATH_MAX];           /* finder-app */
+static char workdir[PATH_MAX - 64];     /* Private directory inside cfg.workdir */
+static struct result results[MAX_CASES];
+static int num_results;
+static long expect_files, expect_lines;
+
+/*-----------------------------------------------------------------------------
+ * Corpus
+ *---------------------------------------------------------------------------*/
+
+static uint64_t rng_state;
+
+static uint64_t rng(void)
+{
+    /* splitmix64, same sequence everywhere for a seed */
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double rng_unit(void)
+{
+    return (rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void die(const char *what)
+{
+    perror(what);
+    exit(1);
+}
+
+/* Fill buf with about size bytes of text, counting the tokens put in */
+static size_t make_text(char *buf, long size, long *lines)
+{
+    size_t len = 0;
+
+    while ((long)len < size) {
+        long line_len = 40 + rng() % 60;
+        size_t start = len;
+
+        if (rng_unit() < cfg.density) {
+            int token = rng() % MATCH_TOKENS;
+            len += sprintf(buf + len, "%s_%c ", MATCH_PREFIX, 'a' + token);
+            (*lines)++;
+        }
+        while ((long)(len - start) < line_len) {
+            int word = 2 + rng() % 8;
+            for (int i = 0; i < word; i++)
+                buf[len++] = 'a' + rng() % 26;
+            buf[len++] = ' ';
+        }
+        buf[len - 1] = '\n';
+    }
+    return len;
+}
+
+static void write_all(const char *path, const char *buf, size_t len)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    size_t done = 0;
+
+    if (fd < 0)
+        die(path);
+    while (done < len) {
+        ssize_t n = write(fd, buf + done, len - done);
+        if (n < 0)
+            die(path);
+        done += n;
+    }
+    close(fd);
+}
+
+static int run_shell(const char *cmd)
+{
+    int status = system(cmd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)st;
+    (void)type;
+    (void)ftw;
+    if (remove(path) != 0)
+        perror(path);
+    return 0;
+}
+
+/* rm -rf path, without following symbolic links */
+static void remove_tree(const char *path)
+{
+    if (nftw(path, remove_entry, 16, FTW_DEPTH | FTW_PHYS) != 0 && errno != ENOENT)
+        perror(path);
+}
+
+static void generate_corpus(const char *root)
+{
+    char (*dirs)[PATH_MAX];
+    long ndirs = 1, level_start = 0, level_end = 1;
+    char *buf = malloc(cfg.max_size + 256);
+
+    /* Directory tree, breadth first, capped to one directory per file */
+    long max_dirs = cfg.files > 0 ? cfg.files : 1;
+    dirs = malloc(max_dirs * sizeof(*dirs));
+    if (!buf || !dirs)
+        die("malloc");
+    snprintf(dirs[0], PATH_MAX, "%s", root);
+    if (mkdir(root, 0755) != 0)
+        die(root);
+    for (int d = 0; d < cfg.depth; d++) {
+        for (long p = level_start; p < level_end; p++) {
+            for (int w = 0; w < cfg.width && ndirs < max_dirs; w++) {
+                snprintf(dirs[ndirs], PATH_MAX, "%s/d%d", dirs[p], w);
+                if (mkdir(dirs[ndirs], 0755) != 0)
+                    die(dirs[ndirs]);
+                ndirs++;
+            }
+        }
+        level_start = level_end;
+        level_end = ndirs;
+    }
+
+    rng_state = cfg.seed;
+    expect_lines = 0;
+    for (long i = 0; i < cfg.files; i++) {
+        double lo = log((double)cfg.min_size), hi = log((double)cfg.max_size);
+        long size = (long)exp(lo + (hi - lo) * rng_unit());
+        char path[PATH_MAX + 32];
+        size_t len = make_text(buf, size, &expect_lines);
+
+        snprintf(path, sizeof(path), "%s/f%ld.txt", dirs[i % ndirs], i);
+        write_all(path, buf, len);
+    }
+    expect_files = cfg.files;
+    free(buf);
+    free(dirs);
+}
+
+/*-----------------------------------------------------------------------------
+ * Running and measuring
+ *---------------------------------------------------------------------------*/
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double tv_sec(struct timeval tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Run cmd with sh, stdout to out (if not NULL), measuring it */
+static int run_measured(const char *cmd, const char *out, double *wall, struct rusage *ru)
+{
+    double start = now();
+    int status;
+    pid_t pid = fork();
+
+    if (pid < 0)
+        die("fork");
+    if (pid == 0) {
+        if (out) {
+            int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0)
+                _exit(127);
+        }
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    if (wait4(pid, &status, 0, ru) < 0)
+        die("wait4");
+    *wall = now() - start;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Count the system calls made by cmd and everything it starts, or -1 */
+static long count_syscalls(const char *cmd)
+{
+    long calls = 0;
+    int status;
+    pid_t pid = fork();
+
+    if (pid < 0)
+        die("fork");
+    if (pid == 0) {
+        int fd = open("/dev/null", O_WRONLY);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+        }
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0)
+            _exit(126);
+        raise(SIGSTOP);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+        waitpid(pid, &status, 0);
+        return -1;    /* ptrace() not allowed here */
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, NULL,
+           PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_TRACEFORK |
+           PTRACE_O_TRACEVFORK | PTRACE_O_EXITKILL);
+    ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+
+    for (;;) {
+        pid_t p = waitpid(-1, &status, __WALL);
+        int sig = 0;
+
+        if (p < 0)
+            break;    /* ECHILD: everything has exited */
+        if (!WIFSTOPPED(status))
+            continue;
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+#ifdef PTRACE_GET_SYSCALL_INFO
+            unsigned char info[128];
+            if (ptrace(PTRACE_GET_SYSCALL_INFO, p, sizeof(info), info) > 0 &&
+                info[0] == PTRACE_SYSCALL_INFO_ENTRY)
+                calls++;
+#else
+            calls++;    /* Entry and exit stops, halved below */
+#endif
+        } else if (status >> 16 == 0 && WSTOPSIG(status) != SIGSTOP &&
+                   WSTOPSIG(status) != SIGTRAP) {
+            sig = WSTOPSIG(status);    /* A real signal, deliver it */
+        }
+        ptrace(PTRACE_SYSCALL, p, NULL, (void *)(long)sig);
+    }
+#ifndef PTRACE_GET_SYSCALL_INFO
+    calls /= 2;
+#endif
+    return calls;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Remove dir and create it again, empty */
+static void fresh_dir(const char *dir)
+{
+    remove_tree(dir);
+    if (mkdir(dir, 0755) != 0)
+        die(dir);
+}
+
+/*
+ * Run one case. empty (if not NULL) is a directory emptied before every
+ * repeat, unmeasured. expect (if not NULL) is the line the output has to
+ * end with.
+ */
+static void bench_case(const char *name, const char *empty, const char *cmd,
+                       const char *expect)
+{
+    double wall[MAX_REPEATS], user[MAX_REPEATS], sys[MAX_REPEATS];
+    struct result *r = &results[num_results++];
+    char out[PATH_MAX];
+
+    snprintf(out, sizeof(out), "%s/output.txt", workdir);
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->max_rss_kb = 0;
+    for (int i = 0; i < cfg.repeats; i++) {
+        struct rusage ru;
+        int ret;
+
+        if (empty)
+            fresh_dir(empty);
+        ret = run_measured(cmd, out, &wall[i], &ru);
+        if (ret != 0) {
+            fprintf(stderr, "finder-bench: %s: exit status %d\n  %s\n", name, ret, cmd);
+            exit(1);
+        }
+        user[i] = tv_sec(ru.ru_utime);
+        sys[i] = tv_sec(ru.ru_stime);
+        if (ru.ru_maxrss > r->max_rss_kb)
+            r->max_rss_kb = ru.ru_maxrss;
+
+        if (expect) {
+            char line[512] = "", last[512] = "";
+            FILE *f = fopen(out, "r");
+            while (f && fgets(line, sizeof(line), f))
+                strcpy(last, line);
+            if (f)
+                fclose(f);
+            last[strcspn(last, "\n")] = '\0';
+            if (strcmp(last, expect) != 0) {
+                fprintf(stderr, "finder-bench: %s: wrong output\n  got:      %s\n"
+                                "  expected: %s\n", name, last, expect);
+                exit(1);
+            }
+        }
+    }
+    qsort(wall, cfg.repeats, sizeof(double), cmp_double);
+    qsort(user, cfg.repeats, sizeof(double), cmp_double);
+    qsort(sys, cfg.repeats, sizeof(double), cmp_double);
+    r->wall = wall[cfg.repeats / 2];
+    r->user = user[cfg.repeats / 2];
+    r->sys = sys[cfg.repeats / 2];
+
+    if (empty)
+        fresh_dir(empty);
+    r->syscalls = count_syscalls(cmd);
+    fprintf(stderr, "%-24s wall %8.4fs  cpu %8.4fs  rss %7ld KB  syscalls %ld\n",
+            name, r->wall, r->user + r->sys, r->max_rss_kb, r->syscalls);
+}
+
+/*-----------------------------------------------------------------------------
+ * Cases
+ *---------------------------------------------------------------------------*/
+
+static void run_cases(void)
+{
+    char corpus[PATH_MAX], expect[256], cmd[4 * PATH_MAX], prep[4 * PATH_MAX];
+    char shdir[PATH_MAX], wdir[PATH_MAX], tokens[MATCH_TOKENS * 24] = "";
+
+    snprintf(corpus, sizeof(corpus), "%s/corpus", workdir);
+    snprintf(shdir, sizeof(shdir), "%s/sh", workdir);
+    snprintf(wdir, sizeof(wdir), "%s/writer", workdir);
+    snprintf(expect, sizeof(expect),
+             "The number of files are %ld and the number of matching lines are %ld",
+             expect_files, expect_lines);
+
+    /* finder.sh without the native finder next to it uses find and grep */
+    snprintf(cmd, sizeof(cmd), "mkdir -p '%s' && cp '%s/finder.sh' '%s/'",
+             shdir, appdir, shdir);
+    if (run_shell(cmd) != 0) {
+        fprintf(stderr, "finder-bench: cannot copy finder.sh\n");
+        exit(1);
+    }
+    snprintf(cmd, sizeof(cmd), "sh '%s/finder.sh' '%s' %s", shdir, corpus, MATCH_PREFIX);
+    bench_case("finder.sh-pipeline", NULL, cmd, expect);
+
+    snprintf(cmd, sizeof(cmd), "'%s/finder' '%s' %s", appdir, corpus, MATCH_PREFIX);
+    bench_case("finder-native", NULL, cmd, expect);
+    snprintf(cmd, sizeof(cmd), "'%s/finder' -j 1 '%s' %s", appdir, corpus, MATCH_PREFIX);
+    bench_case("finder-native-j1", NULL, cmd, expect);
+
+    /* Warm index: built (and aged past the racy window) before measuring */
+    snprintf(prep, sizeof(prep), "'%s/finder' -x '%s/index' '%s' %s >/dev/null",
+             appdir, workdir, corpus, MATCH_PREFIX);
+    run_shell(prep);
+    sleep(2);
+    run_shell(prep);
+    snprintf(cmd, sizeof(cmd), "'%s/finder' -x '%s/index' '%s' %s",
+             appdir, workdir, corpus, MATCH_PREFIX);
+    bench_case("finder-incremental", NULL, cmd, expect);
+
+    /* Every matching line has exactly one token, so the summary is the same */
+    for (int t = 0; t < MATCH_TOKENS; t++)
+        sprintf(tokens + strlen(tokens), " -e %s_%c", MATCH_PREFIX, 'a' + t);
+    snprintf(cmd, sizeof(cmd), "'%s/finder'%s '%s'", appdir, tokens, corpus);
+    bench_case("finder-multi-pattern", NULL, cmd, expect);
+
+    /* writer: every run starts from an empty directory */
+    snprintf(cmd, sizeof(cmd), "i=1; while [ $i -le %ld ]; do '%s/writer' '%s/f'$i AELD_IS_FUN"
+             " || exit 1; i=$((i+1)); done", cfg.writer_files, appdir, wdir);
+    bench_case("writer-per-process", wdir, cmd, NULL);
+
+    static const char *const backends[] = {"sync", "pool", "uring"};
+    for (int b = 0; b < 3; b++) {
+        char name[64];
+        snprintf(name, sizeof(name), "writer-template-%s", backends[b]);
+        snprintf(cmd, sizeof(cmd), "'%s/writer' -b %s -t '%s/f%%d' -n %ld AELD_IS_FUN",
+                 appdir, backends[b], wdir, cfg.writer_files);
+        bench_case(name, wdir, cmd, NULL);
+    }
+
+    snprintf(cmd, sizeof(cmd), "i=1; while [ $i -le %ld ]; do printf '%s/m%%d\\tAELD_IS_FUN\\n' $i;"
+             " i=$((i+1)); done > '%s/manifest'", cfg.writer_files, wdir, workdir);
+    run_shell(cmd);
+    snprintf(cmd, sizeof(cmd), "'%s/writer' -m < '%s/manifest'", appdir, workdir);
+    bench_case("writer-manifest", wdir, cmd, NULL);
+
+    snprintf(cmd, sizeof(cmd), "head -c %d /dev/zero > '%s/stream.bin'", STREAM_BYTES, workdir);
+    run_shell(cmd);
+    snprintf(cmd, sizeof(cmd), "'%s/writer' -i '%s/stream.bin' '%s/stream.out'",
+             appdir, workdir, wdir);
+    bench_case("writer-stream-file", wdir, cmd, NULL);
+    snprintf(cmd, sizeof(cmd), "cat '%s/stream.bin' | '%s/writer' -i - '%s/stream.out'",
+             workdir, appdir, wdir);
+    bench_case("writer-stream-pipe", wdir, cmd, NULL);
+}
+
+/*-----------------------------------------------------------------------------
+ * Results
+ *---------------------------------------------------------------------------*/
+
+static void write_json(FILE *out)
+{
+    fprintf(out, "{\n  \"config\": {\"seed\": %lu, \"files\": %ld, \"depth\": %d, "
+                 "\"width\": %d, \"min_size\": %ld, \"max_size\": %ld, \"density\": %g, "
+                 "\"writer_files\": %ld, \"repeats\": %d},\n",
+            cfg.seed, cfg.files, cfg.depth, cfg.width, cfg.min_size, cfg.max_size,
+            cfg.density, cfg.writer_files, cfg.repeats);
+    fprintf(out, "  \"expected\": {\"files\": %ld, \"matching_lines\": %ld},\n",
+            expect_files, expect_lines);
+    fprintf(out, "  \"results\": [\n");
+    /* One result per line, compare_baseline() relies on it */
+    for (int i = 0; i < num_results; i++) {
+        struct result *r = &results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"wall_s\": %.6f, \"user_s\": %.6f, "
+                     "\"sys_s\": %.6f, \"max_rss_kb\": %ld, \"syscalls\": %ld}%s\n",
+                r->name, r->wall, r->user, r->sys, r->max_rss_kb, r->syscalls,
+                i + 1 < num_results ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+/* Returns the number of cases that regressed */
+static int compare_baseline(const char *file)
+{
+    FILE *in = fopen(file, "r");
+    char line[512];
+    int regressions = 0;
+
+    if (!in)
+        die(file);
+    while (fgets(line, sizeof(line), in)) {
+        struct result base;
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"wall_s\": %lf, \"user_s\": %lf, "
+                         "\"sys_s\": %lf", base.name, &base.wall, &base.user, &base.sys) != 4)
+            continue;
+        for (int i = 0; i < num_results; i++) {
+            struct result *r = &results[i];
+            double limit = 1 + cfg.threshold / 100;
+            double cpu = r->user + r->sys, base_cpu = base.user + base.sys;
+
+            if (strcmp(r->name, base.name) != 0)
+                continue;
+            if (r->wall > base.wall * limit && r->wall - base.wall > NOISE_FLOOR_S) {
+                fprintf(stderr, "REGRESSION %s: wall %.4fs -> %.4fs (+%.0f%%)\n", r->name,
+                        base.wall, r->wall, (r->wall / base.wall - 1) * 100);
+                regressions++;
+            } else if (cpu > base_cpu * limit && cpu - base_cpu > NOISE_FLOOR_S) {
+                fprintf(stderr, "REGRESSION %s: cpu %.4fs -> %.4fs (+%.0f%%)\n", r->name,
+                        base_cpu, cpu, (cpu / base_cpu - 1) * 100);
+                regressions++;
+            }
+        }
+    }
+    fclose(in);
+    return regressions;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-s seed] [-n files] [-d depth] [-w width] [-z min:max]\n"
+                    "       [-m density] [-W writer_files] [-r repeats] [-D workdir]\n"
+                    "       [-o results.json] [-b baseline.json] [-T percent] [-k]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    char self[PATH_MAX], corpus[PATH_MAX];
+    int opt, regressions = 0;
+
+    while ((opt = getopt(argc, argv, "s:n:d:w:z:m:W:r:D:o:b:T:k")) != -1) {
+        switch (opt) {
+        case 's': cfg.seed = strtoul(optarg, NULL, 0); break;
+        case 'n': cfg.files = atol(optarg); break;
+        case 'd': cfg.depth = atoi(optarg); break;
+        case 'w': cfg.width = atoi(optarg); break;
+        case 'z':
+            if (sscanf(optarg, "%ld:%ld", &cfg.min_size, &cfg.max_size) != 2)
+                usage(argv[0]);
+            break;
+        case 'm': cfg.density = atof(optarg); break;
+        case 'W': cfg.writer_files = atol(optarg); break;
+        case 'r': cfg.repeats = atoi(optarg); break;
+        case 'D': cfg.workdir = optarg; break;
+        case 'o': cfg.output = optarg; break;
+        case 'b': cfg.baseline = optarg; break;
+        case 'T': cfg.threshold = atof(optarg); break;
+        case 'k': cfg.keep = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind != argc || cfg.files < 1 || cfg.depth < 0 || cfg.width < 1 ||
+        cfg.min_size < 1 || cfg.max_size < cfg.min_size || cfg.density < 0 ||
+        cfg.density > 1 || cfg.writer_files < 1 || cfg.repeats < 1 ||
+        cfg.repeats > MAX_REPEATS)
+        usage(argv[0]);
+
+    /* The programs under test live next to the bench directory */
+    if (!realpath("/proc/self/exe", self))
+        die("realpath");
+    snprintf(appdir, sizeof(appdir), "%s", self);
+    for (int i = 0; i < 2; i++)
+        *strrchr(appdir, '/') = '\0';
+
+    if (mkdir(cfg.workdir, 0755) != 0 && errno != EEXIST)
+        die(cfg.workdir);
+    if (snprintf(workdir, sizeof(workdir), "%s/finder-bench.XXXXXX", cfg.workdir) >=
+        (int)sizeof(workdir)) {
+        errno = ENAMETOOLONG;
+        die(cfg.workdir);
+    }
+    if (!mkdtemp(workdir))
+        die(workdir);
+    snprintf(corpus, sizeof(corpus), "%s/corpus", workdir);
+    fprintf(stderr, "Generating %ld files in %s (seed %lu)\n", cfg.files, corpus, cfg.seed);
+    generate_corpus(corpus);
+    run_cases();
+
+    if (cfg.output) {
+        FILE *out = fopen(cfg.output, "w");
+        if (!out)
+            die(cfg.output);
+        write_json(out);
+        fclose(out);
+    } else {
+        write_json(stdout);
+    }
+    if (cfg.baseline)
+        regressions = compare_baseline(cfg.baseline);
+
+    if (cfg.keep)
+        fprintf(stderr, "Kept %s\n", workdir);
+    else
+        remove_tree(workdir);
+    if (regressions) {
+        fprintf(stderr, "%d case(s) regressed by more than %.0f%%\n", regressions, cfg.threshold);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+/******************************************************************************
+ * linecount-bench.c
+ *
+ * Usage: linecount-bench [-s seed] [-z megabytes] [-m density] [-r repeats]
+ *                        [-p pattern] [file]
+ *
+ * Author: Matt Hartnett
+ *
+ * Throughput benchmark for the line counting kernel in finder_linecount.h.
+ * Build it with "make bench".
+ *
+ * 1) Searches <file>, mmap()ed like finder does with large files, or else
+ *    <megabytes> of random lowercase text from the seed in which a fraction
+ *    <density> of the lines contain the pattern.
+ * 2) Counts the lines containing <pattern> (default AELD_IS_FUN) <repeats>
+ *    times with every implementation this CPU supports, plus the empty
+ *    pattern (a plain line count), and checks they all agree with scalar.
+ * 3) Prints the best time and the throughput in GB/s of each as JSON, one
+ *    result per line. Exits with status 1 when a count is wrong.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../finder_linecount.h"
+
+#define MAX_REPEATS 101
+
+static uint64_t rng_state;
+
+static uint64_t rng(void)
+{
+    /* splitmix64, same sequence everywhere for a seed */
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void die(const char *what)
+{
+    perror(what);
+    exit(1);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* size bytes of text with the pattern on about density of the lines */
+static char *make_text(size_t size, double density, const char *pat)
+{
+    char *buf = malloc(size);
+    size_t len = 0, plen = strlen(pat);
+
+    if (!buf)
+        die("malloc");
+    while (len < size) {
+        size_t line_len = 40 + rng() % 60;
+        size_t start = len;
+
+        if ((rng() >> 11) * (1.0 / 9007199254740992.0) < density && len + plen < size) {
+            memcpy(buf + len, pat, plen);
+            len += plen;
+        }
+        while (len - start < line_len && len < size) {
+            int word = 2 + rng() % 8;
+            for (int i = 0; i < word && len < size; i++)
+                buf[len++] = 'a' + rng() % 26;
+            if (len < size)
+                buf[len++] = ' ';
+        }
+        buf[len - 1] = '\n';
+    }
+    return buf;
+}
+
+/* Best of repeats runs, returns 0 when the count was wrong */
+static int bench_impl(enum lc_impl impl, const char *buf, size_t len, const char *pat,
+                      int repeats, long expect, int *first)
+{
+    double best = 0;
+    long lines = 0;
+
+    for (int i = 0; i < repeats; i++) {
+        double start = now();
+        lines = lc_count_lines_with(impl, buf, len, pat, strlen(pat));
+        double t = now() - start;
+        if (!i || t < best)
+            best = t;
+    }
+    printf("%s    {\"impl\": \"%s\", \"pattern\": \"%s\", \"lines\": %ld, "
+           "\"best_s\": %.6f, \"gb_per_s\": %.3f}",
+           *first ? "" : ",\n", lc_impl_name(impl), pat, lines, best,
+           best > 0 ? len / best / 1e9 : 0.0);
+    *first = 0;
+    if (lines != expect) {
+        fprintf(stderr, "%s counted %ld lines of \"%s\", scalar %ld\n",
+                lc_impl_name(impl), lines, pat, expect);
+        return 0;
+    }
+    return 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-s seed] [-z megabytes] [-m density] [-r repeats]\n"
+                    "       [-p pattern] [file]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long seed = 1;
+    long megabytes = 256;
+    double density = 0.01;
+    int repeats = 5, opt, ok = 1, first = 1;
+    const char *pat = "AELD_IS_FUN";
+    const char *pats[2];
+    char *buf;
+    size_t len;
+
+    while ((opt = getopt(argc, argv, "s:z:m:r:p:")) != -1) {
+        switch (opt) {
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        case 'z': megabytes = atol(optarg); break;
+        case 'm': density = atof(optarg); break;
+        case 'r': repeats = atoi(optarg); break;
+        case 'p': pat = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (argc - optind > 1 || megabytes < 1 || density < 0 || density > 1 ||
+        repeats < 1 || repeats > MAX_REPEATS)
+        usage(argv[0]);
+
+    if (optind < argc) {
+        struct stat st;
+        int fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+        if (fd < 0 || fstat(fd, &st) != 0)
+            die(argv[optind]);
+        if (st.st_size == 0) {
+            fprintf(stderr, "%s is empty\n", argv[optind]);
+            exit(1);
+        }
+        len = st.st_size;
+        buf = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (buf == MAP_FAILED)
+            die("mmap");
+        close(fd);
+    } else {
+        rng_state = seed;
+        len = (size_t)megabytes * 1024 * 1024;
+        buf = make_text(len, density, pat);
+    }
+
+    printf("{\n  \"bytes\": %zu,\n  \"best\": \"%s\",\n  \"results\": [\n",
+           len, lc_impl_name(lc_best()));
+    pats[0] = pat;
+    pats[1] = "";
+    for (int p = 0; p < 2; p++) {
+        long expect = lc_count_lines_with(LC_SCALAR, buf, len, pats[p], strlen(pats[p]));
+        for (int impl = 0; impl < LC_IMPLS; impl++) {
+            if (lc_supported(impl))
+                ok &= bench_impl(impl, buf, len, pats[p], repeats, expect, &first);
+        }
+    }
+    printf("\n  ]\n}\n");
+    return ok ? 0 : 1;
+}
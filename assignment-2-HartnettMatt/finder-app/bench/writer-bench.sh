@@ -0,0 +1,41 @@
+#!/bin/sh
+# Compare the writer backends: files/s and MB/s for a few payload sizes
+# Usage: writer-bench.sh [numfiles] [depth] [dir]
+# The files are written to a private directory created inside dir (default
+# /tmp), which is the only thing removed afterwards
+# Author: Matt Hartnett
+
+set -e
+set -u
+
+NUMFILES=${1:-10000}
+DEPTH=${2:-64}
+BASEDIR=${3:-/tmp}
+BACKENDS="sync pool uring"
+SIZES="16 4096 65536"
+
+cd "$(dirname "$0")/.."
+if [ ! -x ./writer ]; then
+    echo "Error: build writer first with make"
+    exit 1
+fi
+mkdir -p "${BASEDIR}"
+BENCHDIR=$(mktemp -d "${BASEDIR}/writer-bench.XXXXXX")
+trap 'rm -rf "${BENCHDIR}"' EXIT
+trap 'exit 1' HUP INT PIPE TERM
+
+printf "%-6s %8s %8s %12s %10s\n" backend size files files/s MB/s
+for size in ${SIZES}; do
+    payload=$(head -c "${size}" /dev/zero | tr '\0' x)
+    for backend in ${BACKENDS}; do
+        # Start each run from an empty directory so every backend creates files
+        rm -rf "${BENCHDIR}/run"
+        mkdir "${BENCHDIR}/run"
+        stats=$(./writer -S -b "${backend}" -q "${DEPTH}" \
+                -t "${BENCHDIR}/run/f%d" -n "${NUMFILES}" "${payload}" 2>&1 >/dev/null | tail -n 1)
+        # backend=... durability=... files=... failed=... bytes=... elapsed=... files/s=... MB/s=...
+        set -- ${stats}
+        printf "%-6s %8s %8s %12s %10s\n" "${1#backend=}" "${size}" "${3#files=}" \
+            "${7#files/s=}" "${8#MB/s=}"
+    done
+done
@@ -52,10 +52,9 @@ echo "Removing the old writer utility and compiling as a native application"
 make clean
 make
 
-for i in $( seq 1 $NUMFILES)
-do
-	./writer.sh "$WRITEDIR/${username}$i.txt" "$WRITESTR"
-done
+# Write all files from one writer process (batch mode) instead of running
+# writer.sh, which rebuilds and starts writer, once per file
+./writer -t "$WRITEDIR/${username}%d.txt" -n "$NUMFILES" "$WRITESTR"
 
 OUTPUTSTRING=$(./finder.sh "$WRITEDIR" "$WRITESTR")
 
@@ -0,0 +1,765 @@
+/******************************************************************************
+ * finder.c
+ *
+ * Usage: finder [-j threads] [-x indexfile] <filesdir> <searchstr>
+ *        finder [-j threads] -e <string> [-e <string>...] [-f <file>] <filesdir>
+ *
+ * Author: Matt Hartnett
+ *
+ * Native replacement for the find | wc -l and grep -r | wc -l pipeline in
+ * finder.sh. Prints the same summary line:
+ *   The number of files are X and the number of matching lines are Y
+ *
+ * 1) Walks <filesdir> once with getdents64() and openat(), counting regular
+ *    files (symbolic links are not followed, like find -type f and grep -r).
+ * 2) Counts the lines of every regular file that contain <searchstr>. Files
+ *    are read into a per-thread buffer, or mmap()ed when large. A pattern
+ *    without regular expression special characters is counted with the SIMD
+ *    kernel in finder_linecount.h, so only lines containing a match are ever
+ *    split out; other patterns fall back to a POSIX basic regular expression
+ *    per line, which is what grep uses.
+ * 3) Files containing a NUL byte are binary and contribute no lines, as
+ *    grep only reports "binary file matches" on stderr for them.
+ *
+ * The work is shared by a pool of threads with one task deque each. A task
+ * is either a directory to scan or a batch of file names in a directory.
+ * Workers push and pop at the bottom of their own deque (depth first, good
+ * cache locality) and steal from the top of other deques when they run out.
+ *
+ * With -x the run is incremental: every file is still stat()ed, but files
+ * whose inode, size and times match the index from the previous run are
+ * answered from it without being opened (see finder_index.h). The index is
+ * rewritten at the end of each run. The output is the same as a full scan.
+ *
+ * With -e and -f any number of fixed strings (-f reads one per line) are
+ * searched for in the same single pass, using the Aho-Corasick matcher in
+ * finder_ac.h. A line counts once in the summary if it contains any of
+ * them, and the matching line count of every string is printed first.
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <regex.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <limits.h>
+#include "finder_index.h"
+#include "finder_ac.h"
+#include "finder_linecount.h"
+
+#define MAX_THREADS      64
+#define FILE_BATCH       64              /* Files per task */
+#define FILE_BATCH_BYTES 4096            /* Name bytes per task */
+#define DENTS_BUF_SIZE   (32 * 1024)     /* getdents64() buffer */
+#define READ_BUF_SIZE    (64 * 1024)     /* Initial per-thread read buffer */
+#define MMAP_THRESHOLD   (256 * 1024)    /* mmap() files at least this big */
+#define IDLE_WAIT_NS     1000000         /* Idle worker recheck period */
+
+struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+/* An open directory shared by the tasks that refer to it */
+struct dir {
+    int        fd;
+    atomic_int refs;
+    char       path[];
+};
+
+struct task {
+    struct dir  *dir;       /* Directory the names are relative to, or NULL */
+    int          scan;      /* Scan the directory names[0] instead */
+    unsigned int count;     /* Number of names */
+    size_t       len;       /* Bytes used in names */
+    size_t       cap;       /* Bytes allocated for names */
+    char         names[];   /* NUL separated names */
+};
+
+struct deque {
+    pthread_mutex_t lock;
+    struct task   **buf;
+    size_t          cap;    /* Power of two */
+    size_t          head;   /* Steal end */
+    size_t          tail;   /* Owner end */
+};
+
+struct worker {
+    pthread_t    thread;
+    struct deque dq;
+    long         files;
+    long         lines;
+    char        *buf;
+    size_t       buf_size;
+    uint32_t     rng;
+    /* Index records for this run (-x only) */
+    struct index_record **recs;
+    size_t       nrecs;
+    size_t       recs_cap;
+    char         key[PATH_MAX];     /* Scratch for the path of a file */
+    struct ac_counts counts;        /* Per pattern counts (-e/-f only) */
+} __attribute__((aligned(64)));
+
+struct pattern {
+    const char *str;
+    size_t      len;
+    int         use_regex;
+    regex_t     re;
+    uint64_t    hash;       /* Identifies it in the index */
+};
+
+static struct worker workers[MAX_THREADS];
+static int num_workers;
+static struct pattern pat;
+static const char *index_file;
+static struct ac *matcher;              /* Multi-pattern mode */
+static const char **patterns;
+static int num_patterns;
+
+static atomic_long pending;             /* Tasks queued or running */
+static atomic_int sleepers;
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+
+/*-----------------------------------------------------------------------------
+ * Work-stealing deques
+ *---------------------------------------------------------------------------*/
+
+static int deque_push(struct deque *dq, struct task *t)
+{
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail - dq->head == dq->cap) {
+        size_t cap = dq->cap ? dq->cap * 2 : 256;
+        struct task **buf = malloc(cap * sizeof(*buf));
+        if (!buf) {
+            pthread_mutex_unlock(&dq->lock);
+            return -1;
+        }
+        for (size_t i = dq->head; i != dq->tail; i++)
+            buf[i & (cap - 1)] = dq->buf[i & (dq->cap - 1)];
+        free(dq->buf);
+        dq->buf = buf;
+        dq->cap = cap;
+    }
+    dq->buf[dq->tail & (dq->cap - 1)] = t;
+    __atomic_store_n(&dq->tail, dq->tail + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&dq->lock);
+    return 0;
+}
+
+static struct task *deque_pop(struct deque *dq)
+{
+    struct task *t = NULL;
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail != dq->head) {
+        __atomic_store_n(&dq->tail, dq->tail - 1, __ATOMIC_RELAXED);
+        t = dq->buf[dq->tail & (dq->cap - 1)];
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return t;
+}
+
+static struct task *deque_steal(struct deque *dq)
+{
+    struct task *t = NULL;
+
+    /* Cheap unlocked check so idle thieves don't hammer busy locks, the
+     * indexes are only written with atomic stores for this */
+    if (__atomic_load_n(&dq->tail, __ATOMIC_RELAXED) ==
+        __atomic_load_n(&dq->head, __ATOMIC_RELAXED))
+        return NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail != dq->head) {
+        t = dq->buf[dq->head & (dq->cap - 1)];
+        __atomic_store_n(&dq->head, dq->head + 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return t;
+}
+
+static void submit(struct worker *w, struct task *t)
+{
+    atomic_fetch_add(&pending, 1);
+    if (deque_push(&w->dq, t) != 0) {
+        fprintf(stderr, "finder: out of memory\n");
+        exit(1);
+    }
+    if (atomic_load(&sleepers)) {
+        pthread_mutex_lock(&idle_lock);
+        pthread_cond_signal(&idle_cond);
+        pthread_mutex_unlock(&idle_lock);
+    }
+}
+
+static struct task *find_work(struct worker *w)
+{
+    struct task *t = deque_pop(&w->dq);
+
+    if (t || num_workers == 1)
+        return t;
+    /* Start at a random victim so thieves spread out */
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 17;
+    w->rng ^= w->rng << 5;
+    int start = w->rng % num_workers;
+    for (int i = 0; i < num_workers; i++) {
+        struct worker *victim = &workers[(start + i) % num_workers];
+        if (victim != w && (t = deque_steal(&victim->dq)))
+            return t;
+    }
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+ * Tasks
+ *---------------------------------------------------------------------------*/
+
+static void dir_put(struct dir *d)
+{
+    if (atomic_fetch_sub(&d->refs, 1) == 1) {
+        close(d->fd);
+        free(d);
+    }
+}
+
+static struct task *task_new(struct dir *d, int scan, size_t cap)
+{
+    struct task *t = malloc(sizeof(*t) + cap);
+
+    if (!t) {
+        fprintf(stderr, "finder: out of memory\n");
+        exit(1);
+    }
+    if (d)
+        atomic_fetch_add(&d->refs, 1);
+    t->dir = d;
+    t->scan = scan;
+    t->count = 0;
+    t->len = 0;
+    t->cap = cap;
+    return t;
+}
+
+static int task_add(struct task *t, const char *name)
+{
+    size_t len = strlen(name) + 1;
+
+    if (t->count == FILE_BATCH || t->len + len > t->cap)
+        return -1;
+    memcpy(t->names + t->len, name, len);
+    t->len += len;
+    t->count++;
+    return 0;
+}
+
+/* Count the lines of buf that match the pattern */
+static long count_lines(struct worker *w, const char *buf, size_t len)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    long lines = 0;
+
+    if (memchr(buf, '\0', len))
+        return 0;    /* Binary */
+
+    if (matcher)
+        return ac_count_lines(matcher, buf, len, &w->counts);
+
+    if (!pat.use_regex)
+        return lc_count_lines(buf, len, pat.str, pat.len);
+
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *eol = nl ? nl : end;
+        regmatch_t m = { .rm_so = 0, .rm_eo = eol - p };
+        if (regexec(&pat.re, p, 1, &m, REG_STARTEND) == 0)
+            lines++;
+        p = eol + 1;
+    }
+    return lines;
+}
+
+static void out_of_memory(void)
+{
+    fprintf(stderr, "finder: out of memory\n");
+    exit(1);
+}
+
+/* Keep a record for the index written at the end of the run */
+static void index_keep(struct worker *w, struct index_record *r)
+{
+    if (!r)
+        out_of_memory();
+    if (w->nrecs == w->recs_cap) {
+        size_t cap = w->recs_cap ? w->recs_cap * 2 : 1024;
+        struct index_record **recs = realloc(w->recs, cap * sizeof(*recs));
+        if (!recs)
+            out_of_memory();
+        w->recs = recs;
+        w->recs_cap = cap;
+    }
+    w->recs[w->nrecs++] = r;
+}
+
+/*
+ * Try to answer a file from the index without opening it. Returns 1 when
+ * done, 0 when the file has to be read, in which case st has been filled in.
+ */
+static int search_indexed(struct worker *w, struct dir *d, const char *name,
+                          struct stat *st, size_t *key_len)
+{
+    const struct index_record *old;
+    int n = snprintf(w->key, sizeof(w->key), "%s/%s", d->path, name);
+    long lines;
+
+    *key_len = n;
+    if (n >= (int)sizeof(w->key) || fstatat(d->fd, name, st, AT_SYMLINK_NOFOLLOW) != 0) {
+        *key_len = 0;    /* Not indexed, just search it */
+        return 0;
+    }
+    old = index_lookup(w->key, n, st);
+    if (!old)
+        return 0;
+
+    lines = index_cached_lines(old, pat.hash);
+    if (lines >= 0) {
+        /* Unchanged and already searched for: reuse the record as is */
+        w->lines += lines;
+        index_keep(w, (struct index_record *)old);
+        return 1;
+    }
+    if ((old->flags & INDEX_BINARY) ||
+        (!pat.use_regex && !index_may_contain(old, pat.str, pat.len))) {
+        index_keep(w, index_record_new(w->key, n, st, old, NULL, 0, pat.hash, 0));
+        return 1;
+    }
+    return 0;
+}
+
+/* Count the matching lines of a file's contents, and index them with -x */
+static void search_buf(struct worker *w, const char *buf, size_t len,
+                       const struct stat *st, size_t key_len)
+{
+    long lines = count_lines(w, buf, len);
+
+    w->lines += lines;
+    if (key_len)
+        index_keep(w, index_record_new(w->key, key_len, st, NULL, buf, len, pat.hash, lines));
+}
+
+static void search_file(struct worker *w, struct dir *d, const char *name)
+{
+    struct stat st, fst;
+    size_t key_len = 0;
+    int fd;
+
+    if (index_file && search_indexed(w, d, name, &st, &key_len))
+        return;
+
+    fd = openat(d->fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "finder: %s/%s: %s\n", d->path, name, strerror(errno));
+        return;
+    }
+    /* The index keeps st from before the open, so a write racing with this
+     * search changes the times and is noticed next run */
+    if (fstat(fd, &fst) == 0 && fst.st_size >= MMAP_THRESHOLD) {
+        void *map = mmap(NULL, fst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, fst.st_size, MADV_SEQUENTIAL);
+            search_buf(w, map, fst.st_size, &st, key_len);
+            munmap(map, fst.st_size);
+            close(fd);
+            return;
+        }
+    }
+
+    /* Small file, or one that can't be mapped: read it whole */
+    size_t len = 0;
+    for (;;) {
+        if (len == w->buf_size) {
+            char *buf = realloc(w->buf, w->buf_size * 2);
+            if (!buf)
+                out_of_memory();
+            w->buf = buf;
+            w->buf_size *= 2;
+        }
+        ssize_t n = read(fd, w->buf + len, w->buf_size - len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "finder: %s/%s: %s\n", d->path, name, strerror(errno));
+            close(fd);
+            return;
+        }
+        if (n == 0)
+            break;
+        len += n;
+    }
+    close(fd);
+    search_buf(w, w->buf, len, &st, key_len);
+}
+
+static struct dir *dir_open(struct dir *parent, const char *name)
+{
+    size_t plen = parent ? strlen(parent->path) + 1 : 0;
+    struct dir *d = malloc(sizeof(*d) + plen + strlen(name) + 1);
+
+    if (!d) {
+        fprintf(stderr, "finder: out of memory\n");
+        exit(1);
+    }
+    if (parent)
+        sprintf(d->path, "%s/%s", parent->path, name);
+    else
+        strcpy(d->path, name);
+    d->fd = openat(parent ? parent->fd : AT_FDCWD, name,
+                   O_RDONLY | O_DIRECTORY | O_CLOEXEC | (parent ? O_NOFOLLOW : 0));
+    if (d->fd < 0) {
+        fprintf(stderr, "finder: %s: %s\n", d->path, strerror(errno));
+        free(d);
+        return NULL;
+    }
+    atomic_init(&d->refs, 1);
+    return d;
+}
+
+static void scan_dir(struct worker *w, struct dir *parent, const char *name)
+{
+    char dents[DENTS_BUF_SIZE] __attribute__((aligned(8)));
+    struct dir *d = dir_open(parent, name);
+    struct task *files;
+    long nread;
+
+    if (!d)
+        return;
+    files = task_new(d, 0, FILE_BATCH_BYTES);
+    while ((nread = syscall(SYS_getdents64, d->fd, dents, sizeof(dents))) > 0) {
+        for (long off = 0; off < nread; ) {
+            struct linux_dirent64 *de = (struct linux_dirent64 *)(dents + off);
+            unsigned char type = de->d_type;
+            off += de->d_reclen;
+
+            if (de->d_name[0] == '.' && (de->d_name[1] == '\0' ||
+                (de->d_name[1] == '.' && de->d_name[2] == '\0')))
+                continue;
+            if (type == DT_UNKNOWN) {
+                /* Some filesystems don't fill in d_type */
+                struct stat st;
+                if (fstatat(d->fd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+
+            if (type == DT_DIR) {
+                struct task *sub = task_new(d, 1, strlen(de->d_name) + 1);
+                task_add(sub, de->d_name);
+                submit(w, sub);
+            } else if (type == DT_REG) {
+                w->files++;
+                if (task_add(files, de->d_name) != 0) {
+                    submit(w, files);
+                    files = task_new(d, 0, FILE_BATCH_BYTES);
+                    task_add(files, de->d_name);
+                }
+            }
+        }
+    }
+    if (nread < 0)
+        fprintf(stderr, "finder: %s: %s\n", d->path, strerror(errno));
+
+    if (files->count) {
+        submit(w, files);
+    } else {
+        dir_put(d);
+        free(files);
+    }
+    dir_put(d);
+}
+
+static void run_task(struct worker *w, struct task *t)
+{
+    if (t->scan) {
+        scan_dir(w, t->dir, t->names);
+    } else {
+        const char *name = t->names;
+        for (unsigned int i = 0; i < t->count; i++) {
+            search_file(w, t->dir, name);
+            name += strlen(name) + 1;
+        }
+    }
+    if (t->dir)
+        dir_put(t->dir);
+    free(t);
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+
+    for (;;) {
+        struct task *t = find_work(w);
+        if (t) {
+            run_task(w, t);
+            if (atomic_fetch_sub(&pending, 1) == 1) {
+                /* Last task done, wake everyone up to exit */
+                pthread_mutex_lock(&idle_lock);
+                pthread_cond_broadcast(&idle_cond);
+                pthread_mutex_unlock(&idle_lock);
+            }
+            continue;
+        }
+        if (atomic_load(&pending) == 0)
+            break;
+
+        /* Nothing to steal yet, wait for a push (or recheck shortly) */
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += IDLE_WAIT_NS;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&idle_lock);
+        atomic_fetch_add(&sleepers, 1);
+        if (atomic_load(&pending) != 0)
+            pthread_cond_timedwait(&idle_cond, &idle_lock, &ts);
+        atomic_fetch_sub(&sleepers, 1);
+        pthread_mutex_unlock(&idle_lock);
+    }
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+ * Main
+ *---------------------------------------------------------------------------*/
+
+static void add_pattern(const char *str)
+{
+    const char **p;
+
+    if (strchr(str, '\n')) {
+        fprintf(stderr, "Error: Search strings can't contain newlines\n");
+        exit(1);
+    }
+    p = realloc(patterns, (num_patterns + 1) * sizeof(*p));
+    if (!p)
+        out_of_memory();
+    patterns = p;
+    patterns[num_patterns++] = str;
+}
+
+/* One search string per line, like grep -f */
+static void read_patterns(const char *file)
+{
+    FILE *in = strcmp(file, "-") == 0 ? stdin : fopen(file, "re");
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open pattern file %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    while ((len = getline(&line, &size, in)) >= 0) {
+        if (len && line[len - 1] == '\n')
+            line[--len] = '\0';
+        add_pattern(line);
+        line = NULL;    /* Kept by add_pattern() */
+        size = 0;
+    }
+    free(line);
+    if (in != stdin)
+        fclose(in);
+}
+
+static int default_threads(void)
+{
+    cpu_set_t set;
+    int n = 1;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        n = CPU_COUNT(&set);
+    return n < 1 ? 1 : n > MAX_THREADS ? MAX_THREADS : n;
+}
+
+int main(int argc, char *argv[])
+{
+    struct rlimit rl;
+    struct stat st;
+    long files = 0, lines = 0;
+    struct timespec run_start;
+    int opt, multi = 0;
+
+    num_workers = default_threads();
+    while ((opt = getopt(argc, argv, "j:x:e:f:")) != -1) {
+        if (opt == 'j') {
+            num_workers = atoi(optarg);
+        } else if (opt == 'x') {
+            index_file = optarg;
+        } else if (opt == 'e') {
+            add_pattern(optarg);
+            multi = 1;
+        } else if (opt == 'f') {
+            read_patterns(optarg);
+            multi = 1;
+        } else {
+            num_workers = 0;
+            break;
+        }
+    }
+
+    /* Check for the correct number of arguments */
+    if (argc - optind != 2 - multi || num_workers < 1 || num_workers > MAX_THREADS ||
+        (multi && index_file)) {
+        if (multi && index_file)
+            fprintf(stderr, "Error: -x can't be used with -e or -f\n");
+        else if (multi)
+            fprintf(stderr, "Error: One argument required with -e or -f: <filesdir>\n");
+        else
+            fprintf(stderr, "Error: Two arguments required: <filesdir> <searchstr>\n");
+        fprintf(stderr, "Usage: %s [-j threads (1-%d)] [-x indexfile] <filesdir> <searchstr>\n"
+                        "       %s [-j threads] -e <string> [-e <string>...] [-f <file>] <filesdir>\n",
+                argv[0], MAX_THREADS, argv[0]);
+        exit(1);
+    }
+
+    const char *filesdir = argv[optind];
+    const char *searchstr = multi ? "" : argv[optind + 1];
+
+    /* Check if filesdir is a valid directory */
+    if (stat(filesdir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Error: %s is not a valid directory\n", filesdir);
+        exit(1);
+    }
+
+    /* Plain strings use the counting kernel, anything else is a basic regex like grep */
+    pat.str = searchstr;
+    pat.len = strlen(searchstr);
+    pat.use_regex = strpbrk(searchstr, ".[]*^$\\") != NULL;
+    pat.hash = index_pattern_hash(searchstr);
+    if (multi) {
+        pat.use_regex = 0;
+        matcher = ac_build(patterns, num_patterns);
+        if (!matcher)
+            out_of_memory();
+    } else if (pat.use_regex) {
+        int ret = regcomp(&pat.re, searchstr, REG_NOSUB);
+        if (ret != 0) {
+            char err[128];
+            regerror(ret, &pat.re, err, sizeof(err));
+            fprintf(stderr, "Error: Invalid search string %s: %s\n", searchstr, err);
+            exit(1);
+        }
+    }
+
+    /* Wide trees keep many directories open at once */
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        struct worker *w = &workers[i];
+        pthread_mutex_init(&w->dq.lock, NULL);
+        w->buf_size = READ_BUF_SIZE;
+        w->buf = malloc(w->buf_size);
+        w->rng = 2463534242u + i;
+        if (!w->buf || (matcher && ac_counts_init(matcher, &w->counts) != 0)) {
+            fprintf(stderr, "finder: out of memory\n");
+            exit(1);
+        }
+    }
+
+    /* Files changed from now on must not be trusted by the next run */
+    clock_gettime(CLOCK_REALTIME, &run_start);
+    if (index_file)
+        index_load(index_file, filesdir);
+
+    /* The root is a scan task with no parent directory */
+    struct task *root = task_new(NULL, 1, strlen(filesdir) + 1);
+    if (task_add(root, filesdir) != 0) {
+        fprintf(stderr, "Error: %s is not a valid directory\n", filesdir);
+        exit(1);
+    }
+    submit(&workers[0], root);
+
+    int started = 1;
+    for (; started < num_workers; started++) {
+        int ret = pthread_create(&workers[started].thread, NULL, worker_main,
+                                 &workers[started]);
+        if (ret != 0) {
+            /* Carry on with the threads we have, their deques stay empty */
+            fprintf(stderr, "finder: pthread_create: %s\n", strerror(ret));
+            break;
+        }
+    }
+    worker_main(&workers[0]);
+    for (int i = 0; i < num_workers; i++) {
+        if (i && i < started)
+            pthread_join(workers[i].thread, NULL);
+        files += workers[i].files;
+        lines += workers[i].lines;
+    }
+
+    /* Print the results, one line per string first with -e/-f */
+    for (int p = 0; matcher && p < num_patterns; p++) {
+        long n = 0;
+        for (int i = 0; i < num_workers; i++)
+            n += workers[i].counts.lines[p];
+        printf("The number of lines matching %s are %ld\n", patterns[p], n);
+    }
+    printf("The number of files are %ld and the number of matching lines are %ld\n",
+           files, lines);
+
+    if (index_file) {
+        struct index_record **recs = workers[0].recs;
+        size_t count = workers[0].nrecs;
+
+        /* Gather every worker's records behind the first worker's */
+        for (int i = 1; i < num_workers; i++) {
+            struct worker *w = &workers[i];
+            if (!w->nrecs)
+                continue;
+            recs = realloc(recs, (count + w->nrecs) * sizeof(*recs));
+            if (!recs)
+                out_of_memory();
+            memcpy(recs + count, w->recs, w->nrecs * sizeof(*recs));
+            count += w->nrecs;
+            free(w->recs);
+        }
+        fflush(stdout);
+        if (index_save(index_file, filesdir,
+                       (int64_t)run_start.tv_sec * 1000000000 + run_start.tv_nsec,
+                       recs, count) != 0)
+            fprintf(stderr, "finder: cannot write index %s: %s\n", index_file, strerror(errno));
+        for (size_t i = 0; i < count; i++)
+            index_record_free(recs[i]);
+        free(recs);
+        index_free();
+    }
+
+    if (pat.use_regex)
+        regfree(&pat.re);
+    ac_free(matcher);
+    return 0;
+}
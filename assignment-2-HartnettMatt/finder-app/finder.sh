@@ -14,6 +14,16 @@ if [ ! -d "$filesdir" ]; then
     exit 1
 fi
 
+# Use the native finder when it has been built, it walks the tree only once.
+# Setting FINDER_INDEX to a file makes repeated runs incremental.
+finder="$(dirname "$0")/finder"
+if [ -x "$finder" ]; then
+    if [ -n "${FINDER_INDEX:-}" ]; then
+        exec "$finder" -x "$FINDER_INDEX" "$filesdir" "$searchstr"
+    fi
+    exec "$finder" "$filesdir" "$searchstr"
+fi
+
 # Count the number of files in the directory and its subdirectories
 num_files=$(find "$filesdir" -type f | wc -l)
 
@@ -0,0 +1,230 @@
+/******************************************************************************
+ * finder_ac.c
+ *
+ * Author: Matt Hartnett
+ *
+ * Aho-Corasick matcher for finder, see finder_ac.h.
+ *
+ * Build: the patterns are inserted into a trie whose edges are stored
+ * straight in the transition table (0 means no edge, nothing points back to
+ * the start state). A breadth first pass then sets each state's failure link
+ * and fills the missing transitions from the failure state's row, which is
+ * already complete because it is shallower. Finally every entry is turned
+ * into the offset of the target row, plus AC_MATCH when the target ends a
+ * pattern, so the scan loop needs no multiply.
+ *
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "finder_ac.h"
+
+#define AC_MATCH 0x80000000u
+
+struct ac {
+    uint32_t  *next;            /* states * classes entries */
+    uint32_t   classes;
+    uint8_t    cls[256];        /* Byte to class, 0 for bytes in no pattern */
+    uint32_t  *out_start;       /* Per state, into out */
+    uint32_t  *out_len;
+    int       *out;             /* Pattern ids, a state includes its suffixes' */
+    int        npatterns;
+    int       *empty;           /* Empty patterns match every line */
+    int        nempty;
+};
+
+void ac_free(struct ac *ac)
+{
+    if (!ac)
+        return;
+    free(ac->next);
+    free(ac->out_start);
+    free(ac->out_len);
+    free(ac->out);
+    free(ac->empty);
+    free(ac);
+}
+
+struct ac *ac_build(const char *const *patterns, int n)
+{
+    struct ac *ac = calloc(1, sizeof(*ac));
+    uint32_t *fail = NULL, *queue = NULL;
+    int *own = NULL, *own_next = NULL;
+    size_t total = 1, nout = 0, cap_out = 0;
+    uint32_t states = 1, C;
+
+    if (!ac)
+        return NULL;
+    ac->npatterns = n;
+    ac->empty = malloc(n * sizeof(*ac->empty));
+    if (!ac->empty)
+        goto fail;
+
+    /* Byte classes */
+    for (int i = 0; i < n; i++) {
+        for (const unsigned char *p = (const unsigned char *)patterns[i]; *p; p++) {
+            if (!ac->cls[*p])
+                ac->cls[*p] = ++ac->classes;
+        }
+        total += strlen(patterns[i]);
+    }
+    C = ++ac->classes;
+    if (total > AC_MATCH / C)
+        goto fail;    /* Row offsets would collide with the flag */
+
+    ac->next = calloc(total * C, sizeof(*ac->next));
+    own = malloc(total * sizeof(*own));
+    own_next = malloc(n * sizeof(*own_next));
+    if (!ac->next || !own || !own_next)
+        goto fail;
+    for (size_t s = 0; s < total; s++)
+        own[s] = -1;
+
+    /* Trie */
+    for (int i = 0; i < n; i++) {
+        uint32_t s = 0;
+        const unsigned char *p = (const unsigned char *)patterns[i];
+
+        if (!*p) {
+            ac->empty[ac->nempty++] = i;
+            continue;
+        }
+        for (; *p; p++) {
+            uint32_t *e = &ac->next[s * C + ac->cls[*p]];
+            if (!*e)
+                *e = states++;
+            s = *e;
+        }
+        own_next[i] = own[s];
+        own[s] = i;
+    }
+
+    /* Failure links and the remaining transitions, breadth first */
+    fail = calloc(states, sizeof(*fail));
+    queue = malloc(states * sizeof(*queue));
+    ac->out_start = calloc(states, sizeof(*ac->out_start));
+    ac->out_len = calloc(states, sizeof(*ac->out_len));
+    if (!fail || !queue || !ac->out_start || !ac->out_len)
+        goto fail;
+    uint32_t head = 0, tail = 0;
+    queue[tail++] = 0;
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        uint32_t *row = &ac->next[s * C];
+        const uint32_t *frow = &ac->next[fail[s] * C];
+
+        /* Outputs: its own patterns, then everything its failure state has */
+        size_t need = nout + (fail[s] != s ? ac->out_len[fail[s]] : 0) + n;
+        if (need > cap_out) {
+            size_t cap = cap_out ? cap_out : 64;
+            int *out;
+            while (cap < need)
+                cap *= 2;
+            out = realloc(ac->out, cap * sizeof(*out));
+            if (!out)
+                goto fail;
+            ac->out = out;
+            cap_out = cap;
+        }
+        ac->out_start[s] = nout;
+        for (int id = own[s]; id >= 0; id = own_next[id])
+            ac->out[nout++] = id;
+        if (s) {
+            for (uint32_t k = 0; k < ac->out_len[fail[s]]; k++)
+                ac->out[nout++] = ac->out[ac->out_start[fail[s]] + k];
+        }
+        ac->out_len[s] = nout - ac->out_start[s];
+
+        for (uint32_t c = 1; c < C; c++) {
+            if (row[c]) {
+                fail[row[c]] = s ? frow[c] : 0;
+                queue[tail++] = row[c];
+            } else {
+                row[c] = s ? frow[c] : 0;
+            }
+        }
+    }
+
+    /* Entries become row offsets, flagged when the target ends a pattern */
+    for (size_t e = 0; e < (size_t)states * C; e++) {
+        uint32_t t = ac->next[e];
+        ac->next[e] = t * C | (ac->out_len[t] ? AC_MATCH : 0);
+    }
+
+    free(fail);
+    free(queue);
+    free(own);
+    free(own_next);
+    return ac;
+
+fail:
+    free(fail);
+    free(queue);
+    free(own);
+    free(own_next);
+    ac_free(ac);
+    return NULL;
+}
+
+int ac_counts_init(const struct ac *ac, struct ac_counts *counts)
+{
+    counts->lines = calloc(ac->npatterns, sizeof(*counts->lines));
+    counts->seen = calloc(ac->npatterns, sizeof(*counts->seen));
+    counts->line = 0;
+    return counts->lines && counts->seen ? 0 : -1;
+}
+
+/* Count each pattern ending in state row once per line */
+static void record(const struct ac *ac, uint32_t row, struct ac_counts *counts)
+{
+    uint32_t s = row / ac->classes;
+    const int *id = &ac->out[ac->out_start[s]];
+
+    for (uint32_t k = 0; k < ac->out_len[s]; k++) {
+        if (counts->seen[id[k]] != counts->line) {
+            counts->seen[id[k]] = counts->line;
+            counts->lines[id[k]]++;
+        }
+    }
+}
+
+long ac_count_lines(const struct ac *ac, const char *buf, size_t len,
+                    struct ac_counts *counts)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    const unsigned char *end = p + len;
+    const uint32_t *next = ac->next;
+    const uint8_t *cls = ac->cls;
+    uint32_t s = 0;
+    long lines = 0;
+
+    while (p < end) {
+        s = next[(s & ~AC_MATCH) + cls[*p++]];
+        if (!(s & AC_MATCH))
+            continue;
+
+        /* First match on this line: collect the rest of it, then restart */
+        counts->line++;
+        lines++;
+        record(ac, s & ~AC_MATCH, counts);
+        while (p < end && *p != '\n') {
+            s = next[(s & ~AC_MATCH) + cls[*p++]];
+            if (s & AC_MATCH)
+                record(ac, s & ~AC_MATCH, counts);
+        }
+        s = 0;
+    }
+
+    if (ac->nempty) {
+        /* Every line matches, not just those with another pattern in them */
+        long all = 0;
+        for (const char *q = buf; (q = memchr(q, '\n', (const char *)end - q)); q++)
+            all++;
+        if (len && buf[len - 1] != '\n')
+            all++;
+        for (int i = 0; i < ac->nempty; i++)
+            counts->lines[ac->empty[i]] += all;
+        lines = all;
+    }
+    return lines;
+}
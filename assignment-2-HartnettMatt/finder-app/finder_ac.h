@@ -0,0 +1,51 @@
+/******************************************************************************
+ * finder_ac.h
+ *
+ * Author: Matt Hartnett
+ *
+ * Aho-Corasick matcher for finder's multi-pattern mode (-e / -f). All the
+ * fixed strings are searched for in one pass over each file.
+ *
+ * The automaton is compiled into a dense DFA: bytes are first mapped to
+ * equivalence classes (one per byte that occurs in a pattern, plus one for
+ * every other byte), and the transitions are one flat array of
+ * states * classes entries, so each input byte costs a class lookup and a
+ * table load. A flag bit in the entry marks states that end a pattern. A
+ * newline always leads back to the start state, as matches never span lines.
+ *
+ *****************************************************************************/
+
+#ifndef FINDER_AC_H
+#define FINDER_AC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ac;
+
+/* Per-thread counters for ac_count_lines() */
+struct ac_counts {
+    long     *lines;        /* Matching lines per pattern */
+    uint64_t *seen;         /* Line a pattern was last counted on */
+    uint64_t  line;         /* Matching lines seen so far, the line "id" */
+};
+
+/*
+ * Build the matcher for n patterns, which must not contain newlines. Returns
+ * NULL when out of memory.
+ */
+struct ac *ac_build(const char *const *patterns, int n);
+
+/* Counters for a matcher, zeroed. Returns -1 when out of memory */
+int ac_counts_init(const struct ac *ac, struct ac_counts *counts);
+
+/*
+ * Count the lines of text (no NUL bytes) that contain at least one pattern,
+ * and add one per pattern found on a line to counts->lines.
+ */
+long ac_count_lines(const struct ac *ac, const char *buf, size_t len,
+                    struct ac_counts *counts);
+
+void ac_free(struct ac *ac);
+
+#endif /* FINDER_AC_H */
@@ -0,0 +1,344 @@
+/******************************************************************************
+ * finder_index.c
+ *
+ * Author: Matt Hartnett
+ *
+ * On-disk index for incremental finder runs, see finder_index.h.
+ *
+ * File layout:
+ *   struct index_header, the root path (NUL padded to 8 bytes), then
+ *   header.count records, each a struct index_record followed by its path.
+ * The whole file is read into one buffer and records from the previous run
+ * are used in place, through an open addressing hash table on the path.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "finder_index.h"
+
+#define INDEX_MAGIC   "FNDIDX1"
+#define INDEX_VERSION 1
+#define INDEX_RACY_NS 1000000000LL   /* Timestamp granularity allowance */
+
+struct index_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;       /* sizeof(struct index_record), catches ABI changes */
+    uint64_t count;
+    int64_t  started_ns;        /* When the run that wrote it started */
+    uint64_t root_dev;
+    uint64_t root_ino;
+    uint32_t root_len;
+    uint32_t pad;
+};
+
+static struct {
+    char                 *data;         /* Whole file */
+    size_t                size;
+    int64_t               started_ns;
+    struct index_record **table;        /* Power of two slots */
+    size_t                mask;
+} idx;
+
+static size_t padded(size_t len)
+{
+    return (len + 1 + 7) & ~(size_t)7;
+}
+
+static uint64_t hash_bytes(const char *s, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;    /* FNV-1a */
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t index_pattern_hash(const char *str)
+{
+    uint64_t h = hash_bytes(str, strlen(str));
+    return h ? h : 1;
+}
+
+static int64_t ts_ns(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------
+ * Trigram filter
+ *---------------------------------------------------------------------------*/
+
+static unsigned int trigram_bit(const unsigned char *p)
+{
+    uint32_t t = p[0] | p[1] << 8 | (uint32_t)p[2] << 16;
+    return (t * 2654435761u) % INDEX_BLOOM_BITS;
+}
+
+static void bloom_build(uint8_t *bloom, const char *buf, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+
+    memset(bloom, 0, INDEX_BLOOM_BITS / 8);
+    for (size_t i = 0; i + 3 <= len; i++) {
+        unsigned int bit = trigram_bit(p + i);
+        bloom[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+int index_may_contain(const struct index_record *r, const char *str, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)str;
+
+    if (r->flags & INDEX_BINARY)
+        return 0;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        unsigned int bit = trigram_bit(p + i);
+        if (!(r->bloom[bit / 8] & (1 << (bit % 8))))
+            return 0;
+    }
+    return 1;
+}
+
+long index_cached_lines(const struct index_record *r, uint64_t pat_hash)
+{
+    for (int i = 0; i < INDEX_PATTERNS; i++) {
+        if (r->pat_hash[i] == pat_hash)
+            return r->pat_lines[i];
+    }
+    return -1;
+}
+
+/*-----------------------------------------------------------------------------
+ * Loading and lookup
+ *---------------------------------------------------------------------------*/
+
+static int fail_load(const char *file, const char *why)
+{
+    fprintf(stderr, "finder: ignoring index %s: %s\n", file, why);
+    index_free();
+    return 0;
+}
+
+int index_load(const char *file, const char *root)
+{
+    const struct index_header *h;
+    struct stat st, root_st;
+    size_t off, done = 0;
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        if (errno != ENOENT)
+            fprintf(stderr, "finder: %s: %s\n", file, strerror(errno));
+        return 0;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*h) ||
+        !(idx.data = malloc(st.st_size))) {
+        close(fd);
+        return fail_load(file, "unreadable");
+    }
+    idx.size = st.st_size;
+    while (done < idx.size) {
+        ssize_t n = read(fd, idx.data + done, idx.size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    if (done != idx.size)
+        return fail_load(file, "short read");
+
+    h = (const struct index_header *)idx.data;
+    if (memcmp(h->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        h->version != INDEX_VERSION || h->record_size != sizeof(struct index_record))
+        return fail_load(file, "wrong format");
+    off = sizeof(*h) + padded(h->root_len);
+    if (off > idx.size || h->root_len != strlen(root) ||
+        memcmp(idx.data + sizeof(*h), root, h->root_len) != 0 ||
+        stat(root, &root_st) != 0 || root_st.st_dev != h->root_dev ||
+        root_st.st_ino != h->root_ino)
+        return fail_load(file, "built for another directory");
+    if (h->count > idx.size / sizeof(struct index_record))
+        return fail_load(file, "corrupt");
+    idx.started_ns = h->started_ns;
+
+    /* Hash table at most half full */
+    idx.mask = 1;
+    while (idx.mask < h->count * 2)
+        idx.mask <<= 1;
+    idx.table = calloc(idx.mask, sizeof(*idx.table));
+    if (!idx.table)
+        return fail_load(file, "out of memory");
+    idx.mask--;
+
+    for (uint64_t i = 0; i < h->count; i++) {
+        struct index_record *r = (struct index_record *)(idx.data + off);
+        size_t slot;
+
+        if (off + sizeof(*r) > idx.size ||
+            off + sizeof(*r) + padded(r->path_len) > idx.size ||
+            r->path[r->path_len] != '\0')
+            return fail_load(file, "corrupt");
+        off += sizeof(*r) + padded(r->path_len);
+        slot = hash_bytes(r->path, r->path_len) & idx.mask;
+        while (idx.table[slot])
+            slot = (slot + 1) & idx.mask;
+        idx.table[slot] = r;
+    }
+    return 0;
+}
+
+const struct index_record *index_lookup(const char *path, size_t len, const struct stat *st)
+{
+    const struct index_record *r;
+    size_t slot;
+
+    if (!idx.table)
+        return NULL;
+    slot = hash_bytes(path, len) & idx.mask;
+    while ((r = idx.table[slot])) {
+        if (r->path_len == len && memcmp(r->path, path, len) == 0)
+            break;
+        slot = (slot + 1) & idx.mask;
+    }
+    if (!r || r->ino != st->st_ino || r->size != st->st_size ||
+        r->mtime_ns != ts_ns(&st->st_mtim) || r->ctime_ns != ts_ns(&st->st_ctim))
+        return NULL;
+    /* Racily clean: could have been written again within the same tick */
+    if (r->mtime_ns >= idx.started_ns - INDEX_RACY_NS ||
+        r->ctime_ns >= idx.started_ns - INDEX_RACY_NS)
+        return NULL;
+    return r;
+}
+
+/*-----------------------------------------------------------------------------
+ * Records and saving
+ *---------------------------------------------------------------------------*/
+
+struct index_record *index_record_new(const char *path, size_t len, const struct stat *st,
+                                      const struct index_record *old,
+                                      const char *buf, size_t buf_len,
+                                      uint64_t pat_hash, long lines)
+{
+    struct index_record *r = malloc(sizeof(*r) + padded(len));
+    int keep;
+
+    if (!r)
+        return NULL;
+    if (old) {
+        memcpy(r, old, sizeof(*r));
+    } else {
+        memset(r, 0, sizeof(*r));
+        r->ino = st->st_ino;
+        r->size = st->st_size;
+        r->mtime_ns = ts_ns(&st->st_mtim);
+        r->ctime_ns = ts_ns(&st->st_ctim);
+        if (memchr(buf, '\0', buf_len))
+            r->flags |= INDEX_BINARY;
+        else
+            bloom_build(r->bloom, buf, buf_len);
+    }
+    r->path_len = len;
+    memset(r->path, 0, padded(len));
+    memcpy(r->path, path, len);
+
+    /* Move the pattern to the front of the cache, dropping the oldest */
+    r->pat_hash[0] = pat_hash;
+    r->pat_lines[0] = lines;
+    keep = 1;
+    if (old) {
+        for (int i = 0; i < INDEX_PATTERNS && keep < INDEX_PATTERNS; i++) {
+            if (!old->pat_hash[i] || old->pat_hash[i] == pat_hash)
+                continue;
+            r->pat_hash[keep] = old->pat_hash[i];
+            r->pat_lines[keep] = old->pat_lines[i];
+            keep++;
+        }
+    }
+    for (; keep < INDEX_PATTERNS; keep++)
+        r->pat_hash[keep] = 0;
+    return r;
+}
+
+void index_record_free(struct index_record *r)
+{
+    char *p = (char *)r;
+
+    if (idx.data && p >= idx.data && p < idx.data + idx.size)
+        return;
+    free(r);
+}
+
+int index_save(const char *file, const char *root, int64_t started_ns,
+               struct index_record *const *recs, size_t count)
+{
+    struct index_header h;
+    struct stat st;
+    char tmp[4096];
+    FILE *out;
+    int err;
+
+    if (stat(root, &st) != 0)
+        return -1;
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp.%d", file, (int)getpid()) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    out = fopen(tmp, "we");
+    if (!out)
+        return -1;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    h.version = INDEX_VERSION;
+    h.record_size = sizeof(struct index_record);
+    h.count = count;
+    h.started_ns = started_ns;
+    h.root_dev = st.st_dev;
+    h.root_ino = st.st_ino;
+    h.root_len = strlen(root);
+    fwrite(&h, sizeof(h), 1, out);
+    {
+        char pad[8] = {0};
+        size_t len = padded(h.root_len);
+        fwrite(root, h.root_len, 1, out);
+        fwrite(pad, len - h.root_len, 1, out);
+    }
+    for (size_t i = 0; i < count; i++)
+        fwrite(recs[i], sizeof(*recs[i]) + padded(recs[i]->path_len), 1, out);
+
+    err = ferror(out) ? EIO : 0;
+    if (fclose(out) != 0 && !err)
+        err = errno;
+    if (err) {
+        unlink(tmp);
+        errno = err;
+        return -1;
+    }
+    if (rename(tmp, file) != 0) {
+        err = errno;
+        unlink(tmp);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+void index_free(void)
+{
+    free(idx.table);
+    free(idx.data);
+    memset(&idx, 0, sizeof(idx));
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * finder_index.h
+ *
+ * Author: Matt Hartnett
+ *
+ * Persistent index for incremental finder runs (finder -x <indexfile>).
+ *
+ * The index holds one record per regular file from the previous run: its
+ * inode, size, mtime and ctime, whether it is binary, a bloom filter of the
+ * trigrams it contains, and the matching line counts for the last
+ * INDEX_PATTERNS search strings. On the next run a file whose stat data is
+ * unchanged is not opened when its count for the search string is cached,
+ * or when the bloom filter shows a plain search string cannot occur in it.
+ * Only new and changed files are read again.
+ *
+ * Files modified in the same clock tick as the previous run started are
+ * "racily clean" (their mtime can't tell a later write apart) and are always
+ * read again. The file is written in native byte order, it is a local cache
+ * and is simply rebuilt when it does not match.
+ *
+ *****************************************************************************/
+
+#ifndef FINDER_INDEX_H
+#define FINDER_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define INDEX_PATTERNS    4          /* Cached line counts per file */
+#define INDEX_BLOOM_BITS  2048       /* Trigram filter per file */
+#define INDEX_BINARY      0x1        /* Contains a NUL byte, never matches */
+
+struct index_record {
+    uint64_t ino;
+    int64_t  size;
+    int64_t  mtime_ns;
+    int64_t  ctime_ns;
+    uint64_t pat_hash[INDEX_PATTERNS];  /* Most recent first, 0 is unused */
+    int64_t  pat_lines[INDEX_PATTERNS];
+    uint32_t flags;
+    uint32_t path_len;                  /* Without the NUL */
+    uint8_t  bloom[INDEX_BLOOM_BITS / 8];
+    char     path[];                    /* NUL terminated, padded to 8 bytes */
+};
+
+/* Load the index written for root, returns 0 if there is none usable */
+int index_load(const char *file, const char *root);
+
+/* Previous record for path if its stat data still matches st, else NULL */
+const struct index_record *index_lookup(const char *path, size_t len, const struct stat *st);
+
+/* Hash identifying a search string in the count cache, never 0 */
+uint64_t index_pattern_hash(const char *str);
+
+/* Cached line count for the pattern, or -1 */
+long index_cached_lines(const struct index_record *r, uint64_t pat_hash);
+
+/* Whether a file with this filter can contain str (always for short strings) */
+int index_may_contain(const struct index_record *r, const char *str, size_t len);
+
+/*
+ * New record for path. With old, the filter and cached counts are copied
+ * from it, otherwise the filter is built from the file contents in buf.
+ * Then lines is cached for pat_hash. Returns NULL when out of memory.
+ */
+struct index_record *index_record_new(const char *path, size_t len, const struct stat *st,
+                                      const struct index_record *old,
+                                      const char *buf, size_t buf_len,
+                                      uint64_t pat_hash, long lines);
+
+/* Free a record, unless it belongs to the loaded index */
+void index_record_free(struct index_record *r);
+
+/*
+ * Replace the index file with the given records (atomically, via a
+ * temporary file and rename). started_ns is when this run started. Returns
+ * 0, or -1 with errno set.
+ */
+int index_save(const char *file, const char *root, int64_t started_ns,
+               struct index_record *const *recs, size_t count);
+
+/* Release the loaded index */
+void index_free(void);
+
+#endif /* FINDER_INDEX_H */
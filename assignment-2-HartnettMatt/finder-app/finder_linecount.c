@@ -0,0 +1,295 @@
+/******************************************************************************
+ * finder_linecount.c
+ *
+ * Author: Matt Hartnett
+ *
+ * Line counting kernel for finder, see finder_linecount.h.
+ *
+ * The search loop is written once, in count_blocks(), and is inlined into
+ * one function per instruction set. Each instruction set only supplies two
+ * primitives for a block of W bytes: the candidate mask (first and last byte
+ * of the string both match) and the newline mask. Masks have S bits per byte
+ * with only the top one of them set, so the byte offset of the lowest set
+ * bit is ctz / S and m &= m - 1 moves on to the next byte. SSE2 and AVX2
+ * have a byte movemask (S = 1), NEON does not, so it narrows the compare
+ * result to a nibble per byte instead (S = 4).
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "finder_linecount.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LC_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#define LC_ARM 1
+#include <arm_neon.h>
+#endif
+
+#define LC_INLINE static inline __attribute__((always_inline))
+
+typedef uint64_t (*cand_fn)(const unsigned char *p, size_t last_off,
+                            unsigned char first, unsigned char last);
+typedef uint64_t (*nl_fn)(const unsigned char *p);
+
+/*-----------------------------------------------------------------------------
+ * Scalar reference
+ *---------------------------------------------------------------------------*/
+
+static long count_scalar(const char *buf, size_t len, const char *pat, size_t plen)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    long lines = 0;
+
+    while (p < end) {
+        const char *hit = memmem(p, end - p, pat, plen);
+        if (!hit)
+            break;
+        lines++;
+        p = memchr(hit + plen, '\n', end - hit - plen);
+        if (!p)
+            break;
+        p++;
+    }
+    return lines;
+}
+
+/*-----------------------------------------------------------------------------
+ * Shared block loop
+ *---------------------------------------------------------------------------*/
+
+/* First newline at or after p, or NULL */
+LC_INLINE const unsigned char *find_nl(const unsigned char *p, const unsigned char *end,
+                                       size_t W, int S, nl_fn nl)
+{
+    for (; (size_t)(end - p) >= W; p += W) {
+        uint64_t m = nl(p);
+        if (m)
+            return p + __builtin_ctzll(m) / S;
+    }
+    return memchr(p, '\n', end - p);
+}
+
+/* Every line matches an empty string */
+LC_INLINE long count_all(const unsigned char *buf, size_t len, size_t W, nl_fn nl)
+{
+    const unsigned char *p = buf;
+    const unsigned char *end = buf + len;
+    long lines = 0;
+
+    for (; (size_t)(end - p) >= W; p += W)
+        lines += __builtin_popcountll(nl(p));
+    for (; p < end; p++)
+        lines += *p == '\n';
+    if (len && buf[len - 1] != '\n')
+        lines++;
+    return lines;
+}
+
+LC_INLINE long count_blocks(const char *buf, size_t len, const char *pat, size_t plen,
+                            size_t W, int S, cand_fn cand, nl_fn nl)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    const unsigned char *end = p + len;
+    const unsigned char *s = (const unsigned char *)pat;
+    long lines = 0;
+
+    if (!plen)
+        return count_all(p, len, W, nl);
+
+    while (p < end) {
+        const unsigned char *hit = NULL;
+
+        /* Too close to the end for a whole block at both offsets */
+        if ((size_t)(end - p) < plen - 1 + W)
+            return lines + count_scalar((const char *)p, end - p, pat, plen);
+
+        for (uint64_t m = cand(p, plen - 1, s[0], s[plen - 1]); m; m &= m - 1) {
+            const unsigned char *c = p + __builtin_ctzll(m) / S;
+            if (plen <= 2 || memcmp(c + 1, s + 1, plen - 2) == 0) {
+                hit = c;
+                break;
+            }
+        }
+        if (!hit) {
+            p += W;
+            continue;
+        }
+
+        /* Counted, the rest of the line doesn't matter */
+        lines++;
+        p = find_nl(hit + plen, end, W, S, nl);
+        if (!p)
+            break;
+        p++;
+    }
+    return lines;
+}
+
+/*-----------------------------------------------------------------------------
+ * SSE2 and AVX2
+ *---------------------------------------------------------------------------*/
+
+#ifdef LC_X86
+__attribute__((target("sse2")))
+static inline uint64_t cand_sse2(const unsigned char *p, size_t last_off,
+                                 unsigned char first, unsigned char last)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)p);
+    __m128i b = _mm_loadu_si128((const __m128i *)(p + last_off));
+    __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, _mm_set1_epi8(first)),
+                               _mm_cmpeq_epi8(b, _mm_set1_epi8(last)));
+    return (unsigned int)_mm_movemask_epi8(eq);
+}
+
+__attribute__((target("sse2")))
+static inline uint64_t nl_sse2(const unsigned char *p)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)p);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_set1_epi8('\n')));
+}
+
+__attribute__((target("sse2")))
+static long count_sse2(const char *buf, size_t len, const char *pat, size_t plen)
+{
+    return count_blocks(buf, len, pat, plen, 16, 1, cand_sse2, nl_sse2);
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t cand_avx2(const unsigned char *p, size_t last_off,
+                                 unsigned char first, unsigned char last)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(p + last_off));
+    __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, _mm256_set1_epi8(first)),
+                                  _mm256_cmpeq_epi8(b, _mm256_set1_epi8(last)));
+    return (uint32_t)_mm256_movemask_epi8(eq);
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t nl_avx2(const unsigned char *p)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, _mm256_set1_epi8('\n')));
+}
+
+__attribute__((target("avx2")))
+static long count_avx2(const char *buf, size_t len, const char *pat, size_t plen)
+{
+    return count_blocks(buf, len, pat, plen, 32, 1, cand_avx2, nl_avx2);
+}
+#endif /* LC_X86 */
+
+/*-----------------------------------------------------------------------------
+ * NEON
+ *---------------------------------------------------------------------------*/
+
+#ifdef LC_ARM
+/* Byte i of a compare result becomes bit 4 * i + 3 */
+static inline uint64_t neon_mask(uint8x16_t eq)
+{
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ULL;
+}
+
+static inline uint64_t cand_neon(const unsigned char *p, size_t last_off,
+                                 unsigned char first, unsigned char last)
+{
+    uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(p), vdupq_n_u8(first)),
+                             vceqq_u8(vld1q_u8(p + last_off), vdupq_n_u8(last)));
+    return neon_mask(eq);
+}
+
+static inline uint64_t nl_neon(const unsigned char *p)
+{
+    return neon_mask(vceqq_u8(vld1q_u8(p), vdupq_n_u8('\n')));
+}
+
+static long count_neon(const char *buf, size_t len, const char *pat, size_t plen)
+{
+    return count_blocks(buf, len, pat, plen, 16, 4, cand_neon, nl_neon);
+}
+#endif /* LC_ARM */
+
+/*-----------------------------------------------------------------------------
+ * Dispatch
+ *---------------------------------------------------------------------------*/
+
+static atomic_int best = -1;
+
+int lc_supported(enum lc_impl impl)
+{
+    switch (impl) {
+    case LC_SCALAR:
+        return 1;
+#ifdef LC_X86
+    case LC_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case LC_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef LC_ARM
+    case LC_NEON:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+enum lc_impl lc_best(void)
+{
+    int impl = atomic_load_explicit(&best, memory_order_relaxed);
+
+    if (impl < 0) {
+        static const enum lc_impl order[] = { LC_AVX2, LC_SSE2, LC_NEON };
+        impl = LC_SCALAR;
+        for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+            if (lc_supported(order[i])) {
+                impl = order[i];
+                break;
+            }
+        }
+        atomic_store_explicit(&best, impl, memory_order_relaxed);
+    }
+    return impl;
+}
+
+const char *lc_impl_name(enum lc_impl impl)
+{
+    static const char *const names[LC_IMPLS] = { "scalar", "sse2", "avx2", "neon" };
+
+    return (unsigned int)impl < LC_IMPLS ? names[impl] : "unknown";
+}
+
+long lc_count_lines_with(enum lc_impl impl, const char *buf, size_t len,
+                         const char *pat, size_t plen)
+{
+    switch (impl) {
+#ifdef LC_X86
+    case LC_SSE2:
+        return count_sse2(buf, len, pat, plen);
+    case LC_AVX2:
+        return count_avx2(buf, len, pat, plen);
+#endif
+#ifdef LC_ARM
+    case LC_NEON:
+        return count_neon(buf, len, pat, plen);
+#endif
+    default:
+        return count_scalar(buf, len, pat, plen);
+    }
+}
+
+long lc_count_lines(const char *buf, size_t len, const char *pat, size_t plen)
+{
+    return lc_count_lines_with(lc_best(), buf, len, pat, plen);
+}
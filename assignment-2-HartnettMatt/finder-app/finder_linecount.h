@@ -0,0 +1,54 @@
+/******************************************************************************
+ * finder_linecount.h
+ *
+ * Author: Matt Hartnett
+ *
+ * Line counting kernel for finder's single fixed string search: given a
+ * buffer (typically a whole file, read or mmap()ed), count the lines that
+ * contain the string, like grep -F | wc -l.
+ *
+ * Candidates are found a vector at a time by comparing one block with the
+ * first byte of the string and the block plen - 1 bytes further on with its
+ * last byte; only positions where both agree are checked with memcmp(). After
+ * a match the rest of the line is skipped with a vectorised newline scan, so
+ * lines are never split out unless they match.
+ *
+ * There is a portable scalar version (memmem() and memchr(), the reference
+ * the others are tested against) and SSE2, AVX2 and NEON versions. The best
+ * one the CPU supports is picked at run time, the first time it is needed.
+ *
+ *****************************************************************************/
+
+#ifndef FINDER_LINECOUNT_H
+#define FINDER_LINECOUNT_H
+
+#include <stddef.h>
+
+enum lc_impl {
+    LC_SCALAR,
+    LC_SSE2,
+    LC_AVX2,
+    LC_NEON,
+    LC_IMPLS
+};
+
+/*
+ * Count the lines of buf that contain pat, using the best implementation.
+ * An empty pat matches every line. A last line without a newline counts.
+ */
+long lc_count_lines(const char *buf, size_t len, const char *pat, size_t plen);
+
+/* The same with a given implementation, which must be supported */
+long lc_count_lines_with(enum lc_impl impl, const char *buf, size_t len,
+                         const char *pat, size_t plen);
+
+/* Whether this build and CPU can run impl */
+int lc_supported(enum lc_impl impl);
+
+/* The implementation lc_count_lines() uses */
+enum lc_impl lc_best(void);
+
+/* "scalar", "sse2", "avx2" or "neon" */
+const char *lc_impl_name(enum lc_impl impl);
+
+#endif /* FINDER_LINECOUNT_H */
@@ -0,0 +1,549 @@
+/******************************************************************************
+ * write_backend.c
+ *
+ * Author: Matt Hartnett
+ *
+ * Backend selection, durability policies (group commit and latency
+ * accounting) plus the sync and pool (pwrite thread pool) backends. The
+ * io_uring backend lives in write_uring.c.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "write_backend.h"
+
+#define POOL_MAX_THREADS 16
+
+enum write_durability write_durability;
+static write_done_fn write_done;
+static const struct write_ops *ops;
+static struct write_stats stats;
+
+/*-----------------------------------------------------------------------------
+ * Selection
+ *---------------------------------------------------------------------------*/
+
+static const struct write_ops *const backends[] = {
+    [WRITE_BACKEND_SYNC]  = &write_sync_ops,
+    [WRITE_BACKEND_POOL]  = &write_pool_ops,
+    [WRITE_BACKEND_URING] = &write_uring_ops,
+};
+
+static const char *const durability_names[] = {
+    [WRITE_DURABLE_NONE]      = "none",
+    [WRITE_DURABLE_FDATASYNC] = "fdatasync",
+    [WRITE_DURABLE_SYNCFS]    = "syncfs",
+    [WRITE_DURABLE_RANGE]     = "range",
+};
+
+int write_backend_parse(const char *name)
+{
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (strcmp(name, backends[i]->name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const char *write_backend_name(enum write_backend_kind kind)
+{
+    return backends[kind]->name;
+}
+
+int write_durability_parse(const char *name)
+{
+    for (size_t i = 0; i < sizeof(durability_names) / sizeof(durability_names[0]); i++) {
+        if (strcmp(name, durability_names[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const char *write_durability_name(enum write_durability durability)
+{
+    return durability_names[durability];
+}
+
+/*-----------------------------------------------------------------------------
+ * Group commit
+ *---------------------------------------------------------------------------*/
+
+/* A file written since the last commit, waiting to become durable */
+struct group_file {
+    char               *path;
+    size_t              len;
+    unsigned long long  submitted;
+};
+
+static struct {
+    unsigned int        size;       /* Files per commit */
+    unsigned int        submitted;  /* Files submitted since the last commit */
+    int                 dirfd;      /* Directory all of them were created in */
+    struct group_file  *files;      /* Completed ones, filled by write_complete() */
+    size_t              count;
+    size_t              cap;
+} group;
+
+static int group_commit(void)
+{
+    return write_durability == WRITE_DURABLE_SYNCFS ||
+           write_durability == WRITE_DURABLE_RANGE;
+}
+
+unsigned long long write_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record_latency(unsigned long long submitted, unsigned long long now)
+{
+    double latency = (now - submitted) / 1e9;
+
+    stats.files++;
+    stats.latency_sum += latency;
+    if (latency > stats.latency_max)
+        stats.latency_max = latency;
+}
+
+void write_complete(const char *path, const char *data, size_t len,
+                    enum write_stage stage, int err, unsigned long long submitted)
+{
+    if (err == 0 && group_commit()) {
+        struct group_file *f;
+
+        if (group.count == group.cap) {
+            size_t cap = group.cap ? group.cap * 2 : 64;
+            f = realloc(group.files, cap * sizeof(*f));
+            if (f) {
+                group.files = f;
+                group.cap = cap;
+            }
+        }
+        f = group.count < group.cap ? &group.files[group.count] : NULL;
+        if (f && (f->path = strdup(path))) {
+            f->len = len;
+            f->submitted = submitted;
+            group.count++;
+        } else {
+            /* Could not track it for the commit, so it cannot be promised */
+            stage = WRITE_STAGE_SYNC;
+            err = ENOMEM;
+        }
+    } else if (err == 0) {
+        record_latency(submitted, write_now_ns());
+    }
+    write_done(path, data, len, stage, err);
+}
+
+/* Wait for the writeback of one file started by the backend */
+static int range_wait(int dirfd, const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *name = dirfd == AT_FDCWD || !slash ? path : slash + 1;
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    int err = 0;
+
+    if (fd < 0)
+        return errno;
+    if (sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                                  SYNC_FILE_RANGE_WAIT_AFTER) != 0)
+        err = errno;
+    close(fd);
+    return err;
+}
+
+/* Make every file submitted since the last commit durable */
+static void commit(void)
+{
+    unsigned long long start, end;
+    int dirfd, err = 0;
+
+    if (!group.submitted)
+        return;
+    ops->flush();
+    start = write_now_ns();
+
+    dirfd = group.dirfd;
+    if (dirfd == AT_FDCWD)
+        dirfd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) {
+        err = errno;
+    } else if (write_durability == WRITE_DURABLE_SYNCFS) {
+        if (syncfs(dirfd) != 0)
+            err = errno;
+    } else {
+        for (size_t i = 0; i < group.count; i++) {
+            struct group_file *f = &group.files[i];
+            int ferr = range_wait(group.dirfd, f->path);
+            if (ferr) {
+                write_done(f->path, NULL, f->len, WRITE_STAGE_COMMIT, ferr);
+                free(f->path);
+                f->path = NULL;
+            }
+        }
+        /* One fsync makes all the new directory entries durable */
+        if (fsync(dirfd) != 0)
+            err = errno;
+    }
+    if (dirfd >= 0 && dirfd != group.dirfd)
+        close(dirfd);
+
+    end = write_now_ns();
+    for (size_t i = 0; i < group.count; i++) {
+        struct group_file *f = &group.files[i];
+        if (!f->path)
+            continue;
+        if (err)
+            write_done(f->path, NULL, f->len, WRITE_STAGE_COMMIT, err);
+        else
+            record_latency(f->submitted, end);
+        free(f->path);
+    }
+    stats.commits++;
+    if ((end - start) / 1e9 > stats.commit_max)
+        stats.commit_max = (end - start) / 1e9;
+    group.count = 0;
+    group.submitted = 0;
+}
+
+/*-----------------------------------------------------------------------------
+ * Dispatch
+ *---------------------------------------------------------------------------*/
+
+int write_backend_init(enum write_backend_kind kind, unsigned int depth,
+                       enum write_durability durability, unsigned int group_size,
+                       write_done_fn done)
+{
+    if (depth == 0 || depth > WRITE_MAX_DEPTH || group_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    write_done = done;
+    write_durability = durability;
+    group.size = group_size;
+    memset(&stats, 0, sizeof(stats));
+    if (backends[kind]->init(depth) == 0) {
+        ops = backends[kind];
+        return kind;
+    }
+    if (kind != WRITE_BACKEND_URING)
+        return -1;
+
+    /* No usable io_uring (old kernel, seccomp, sysctl): use the pool */
+    if (write_pool_ops.init(depth) != 0)
+        return -1;
+    ops = &write_pool_ops;
+    return WRITE_BACKEND_POOL;
+}
+
+int write_backend_submit(int dirfd, const char *name, const char *path,
+                         const char *data, size_t len, int data_stable)
+{
+    if (group_commit()) {
+        /* A group covers one directory, commit before moving on */
+        if (group.submitted && (group.submitted >= group.size || dirfd != group.dirfd))
+            commit();
+        group.dirfd = dirfd;
+        group.submitted++;
+    }
+    return ops->submit(dirfd, name, path, data, len, data_stable);
+}
+
+void write_backend_flush(void)
+{
+    if (!ops)
+        return;
+    if (group_commit())
+        commit();
+    else
+        ops->flush();
+}
+
+void write_backend_finish(void)
+{
+    if (!ops)
+        return;
+    write_backend_flush();
+    ops->finish();
+    ops = NULL;
+    free(group.files);
+    group.files = NULL;
+    group.cap = 0;
+}
+
+void write_backend_stats(struct write_stats *out)
+{
+    *out = stats;
+}
+
+/*-----------------------------------------------------------------------------
+ * Shared by sync and pool: create one file with blocking calls
+ *---------------------------------------------------------------------------*/
+
+static int write_one(int dirfd, const char *name, const char *data, size_t len,
+                     enum write_stage *stage)
+{
+    size_t done = 0;
+    int fd;
+
+    *stage = WRITE_STAGE_OPEN;
+    fd = openat(dirfd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return errno;
+
+    *stage = WRITE_STAGE_WRITE;
+    while (done < len) {
+        ssize_t n = pwrite(fd, data + done, len - done, done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            int err = errno;
+            close(fd);
+            return err;
+        }
+        done += n;
+    }
+
+    if (write_durability == WRITE_DURABLE_FDATASYNC) {
+        *stage = WRITE_STAGE_SYNC;
+        if (fdatasync(fd) != 0) {
+            int err = errno;
+            close(fd);
+            return err;
+        }
+        *stage = WRITE_STAGE_WRITE;
+    } else if (write_durability == WRITE_DURABLE_RANGE) {
+        /* Start writeback now, the group commit waits for it */
+        sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    }
+    if (close(fd) != 0)
+        return errno;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+ * sync
+ *---------------------------------------------------------------------------*/
+
+static int sync_init(unsigned int depth)
+{
+    (void)depth;
+    return 0;
+}
+
+static int sync_submit(int dirfd, const char *name, const char *path,
+                       const char *data, size_t len, int data_stable)
+{
+    unsigned long long submitted = write_now_ns();
+    enum write_stage stage;
+    int err = write_one(dirfd, name, data, len, &stage);
+
+    (void)data_stable;
+    write_complete(path, data, len, stage, err, submitted);
+    return 0;
+}
+
+static void sync_flush(void)
+{
+}
+
+const struct write_ops write_sync_ops = {
+    .name   = "sync",
+    .init   = sync_init,
+    .submit = sync_submit,
+    .flush  = sync_flush,
+    .finish = sync_flush,
+};
+
+/*-----------------------------------------------------------------------------
+ * pool
+ *---------------------------------------------------------------------------*/
+
+struct pool_job {
+    int         dirfd;
+    const char *name;       /* Points into path */
+    const char *data;
+    size_t      len;
+    int         own_data;
+    unsigned long long submitted;
+    char        path[];
+};
+
+static struct {
+    pthread_t        threads[POOL_MAX_THREADS];
+    int              nthreads;
+    pthread_mutex_t  lock;
+    pthread_cond_t   not_empty;
+    pthread_cond_t   not_full;
+    pthread_cond_t   idle;
+    pthread_mutex_t  done_lock;     /* Serialises write_complete() */
+    struct pool_job **queue;
+    unsigned int     depth;
+    unsigned int     head;
+    unsigned int     count;
+    unsigned int     busy;          /* Queued plus being written */
+    int              stopping;
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .not_empty = PTHREAD_COND_INITIALIZER,
+    .not_full = PTHREAD_COND_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+    .done_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void *pool_main(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        struct pool_job *job;
+        enum write_stage stage;
+        int err;
+
+        pthread_mutex_lock(&pool.lock);
+        while (!pool.count && !pool.stopping)
+            pthread_cond_wait(&pool.not_empty, &pool.lock);
+        if (!pool.count) {
+            pthread_mutex_unlock(&pool.lock);
+            return NULL;
+        }
+        job = pool.queue[pool.head];
+        pool.head = (pool.head + 1) % pool.depth;
+        pool.count--;
+        pthread_cond_signal(&pool.not_full);
+        pthread_mutex_unlock(&pool.lock);
+
+        err = write_one(job->dirfd, job->name, job->data, job->len, &stage);
+        pthread_mutex_lock(&pool.done_lock);
+        write_complete(job->path, job->data, job->len, stage, err, job->submitted);
+        pthread_mutex_unlock(&pool.done_lock);
+        if (job->own_data)
+            free((char *)job->data);
+        free(job);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.busy == 0)
+            pthread_cond_broadcast(&pool.idle);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+static int pool_init(unsigned int depth)
+{
+    cpu_set_t set;
+    int n = 4;
+
+    /* Threads mostly block in the filesystem, use a few per CPU */
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        n = CPU_COUNT(&set) * 2;
+    if (n < 2)
+        n = 2;
+    if (n > POOL_MAX_THREADS)
+        n = POOL_MAX_THREADS;
+    if ((unsigned int)n > depth)
+        n = depth;
+
+    pool.queue = calloc(depth, sizeof(*pool.queue));
+    if (!pool.queue)
+        return -1;
+    pool.depth = depth;
+    pool.head = pool.count = pool.busy = 0;
+    pool.stopping = 0;
+    for (pool.nthreads = 0; pool.nthreads < n; pool.nthreads++) {
+        int ret = pthread_create(&pool.threads[pool.nthreads], NULL, pool_main, NULL);
+        if (ret != 0) {
+            if (pool.nthreads)
+                break;    /* Carry on with fewer threads */
+            free(pool.queue);
+            errno = ret;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int pool_submit(int dirfd, const char *name, const char *path,
+                       const char *data, size_t len, int data_stable)
+{
+    unsigned long long submitted = write_now_ns();
+    size_t path_len = strlen(path) + 1;
+    struct pool_job *job = malloc(sizeof(*job) + path_len);
+    char *copy = NULL;
+
+    if (job && !data_stable) {
+        copy = malloc(len ? len : 1);
+        if (!copy) {
+            free(job);
+            job = NULL;
+        }
+    }
+    if (!job) {
+        pthread_mutex_lock(&pool.done_lock);
+        write_complete(path, data, len, WRITE_STAGE_OPEN, ENOMEM, submitted);
+        pthread_mutex_unlock(&pool.done_lock);
+        return -1;
+    }
+    if (copy) {
+        memcpy(copy, data, len);
+        data = copy;
+    }
+    memcpy(job->path, path, path_len);
+    job->name = job->path + (name - path);
+    job->dirfd = dirfd;
+    job->data = data;
+    job->len = len;
+    job->own_data = !data_stable;
+    job->submitted = submitted;
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.count == pool.depth)
+        pthread_cond_wait(&pool.not_full, &pool.lock);
+    pool.queue[(pool.head + pool.count) % pool.depth] = job;
+    pool.count++;
+    pool.busy++;
+    pthread_cond_signal(&pool.not_empty);
+    pthread_mutex_unlock(&pool.lock);
+    return 0;
+}
+
+static void pool_flush(void)
+{
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy)
+        pthread_cond_wait(&pool.idle, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static void pool_finish(void)
+{
+    pthread_mutex_lock(&pool.lock);
+    pool.stopping = 1;
+    pthread_cond_broadcast(&pool.not_empty);
+    pthread_mutex_unlock(&pool.lock);
+    for (int i = 0; i < pool.nthreads; i++)
+        pthread_join(pool.threads[i], NULL);
+    free(pool.queue);
+    pool.queue = NULL;
+}
+
+const struct write_ops write_pool_ops = {
+    .name   = "pool",
+    .init   = pool_init,
+    .submit = pool_submit,
+    .flush  = pool_flush,
+    .finish = pool_finish,
+};
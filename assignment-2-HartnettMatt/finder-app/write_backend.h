@@ -0,0 +1,140 @@
+/******************************************************************************
+ * write_backend.h
+ *
+ * Author: Matt Hartnett
+ *
+ * File creation backends for writer. Each submitted file is created (or
+ * truncated) relative to a directory descriptor, written and closed:
+ *  - sync   does it immediately with openat()/write()/close().
+ *  - pool   hands files to a pool of threads using pwrite(), with a bounded
+ *           queue of pending files.
+ *  - uring  submits open/write/close chains to io_uring in batches, using
+ *           registered buffers and direct descriptors, with a bounded number
+ *           of files in flight. It falls back to the pool when io_uring is
+ *           missing or disabled.
+ *
+ * Every file completes exactly once through the done callback, with the
+ * stage that failed and an errno value, or 0. Callbacks are never run
+ * concurrently, but with the pool they run on a worker thread.
+ *
+ * Durability policies, for every backend:
+ *  - none       Files are left in the page cache.
+ *  - fdatasync  Each file is fdatasync()ed before it is closed and reported.
+ *  - syncfs     Group commit: after every group of files (and on flush) one
+ *               syncfs() on the directory's filesystem.
+ *  - range      Group commit: writeback of each file is started with
+ *               sync_file_range() as it is closed, the commit waits for
+ *               each file's writeback and fsync()s the directory once. It
+ *               skips the filesystem-wide flush but only covers file data
+ *               and directory entries, so it relies on the filesystem
+ *               ordering inode updates after data (ext4 data=ordered does).
+ * With group commit a file is reported written when its data is in the page
+ * cache. If the commit then fails it is reported a second time, with stage
+ * WRITE_STAGE_COMMIT and data NULL, and should be counted as lost.
+ *
+ *****************************************************************************/
+
+#ifndef WRITE_BACKEND_H
+#define WRITE_BACKEND_H
+
+#include <stddef.h>
+
+#define WRITE_DEFAULT_DEPTH 64      /* Files in flight for pool and uring */
+#define WRITE_MAX_DEPTH     4096
+#define WRITE_DEFAULT_GROUP 256     /* Files per group commit */
+
+enum write_backend_kind {
+    WRITE_BACKEND_SYNC,
+    WRITE_BACKEND_POOL,
+    WRITE_BACKEND_URING
+};
+
+enum write_durability {
+    WRITE_DURABLE_NONE,
+    WRITE_DURABLE_FDATASYNC,
+    WRITE_DURABLE_SYNCFS,
+    WRITE_DURABLE_RANGE
+};
+
+enum write_stage {
+    WRITE_STAGE_OPEN,
+    WRITE_STAGE_WRITE,
+    WRITE_STAGE_SYNC,       /* Per-file fdatasync */
+    WRITE_STAGE_COMMIT      /* Group commit, after the file was reported */
+};
+
+/* Throughput and durability latency, see write_backend_stats() */
+struct write_stats {
+    unsigned long files;        /* Files that became durable (or completed with none) */
+    unsigned long commits;      /* Group commits */
+    double        latency_sum;  /* Seconds from submit until durable, summed */
+    double        latency_max;
+    double        commit_max;   /* Longest single group commit */
+};
+
+typedef void (*write_done_fn)(const char *path, const char *data, size_t len,
+                              enum write_stage stage, int err);
+
+/* Operations implemented by each backend */
+struct write_ops {
+    const char *name;
+    int  (*init)(unsigned int depth);
+    int  (*submit)(int dirfd, const char *name, const char *path,
+                   const char *data, size_t len, int data_stable);
+    void (*flush)(void);
+    void (*finish)(void);
+};
+
+extern const struct write_ops write_sync_ops;
+extern const struct write_ops write_pool_ops;
+extern const struct write_ops write_uring_ops;
+
+/*
+ * Select and start a backend. group is the number of files per group commit
+ * and is ignored by the other policies. Returns the backend actually in use
+ * (uring may fall back to pool), or -1 on failure with errno set.
+ */
+int write_backend_init(enum write_backend_kind kind, unsigned int depth,
+                       enum write_durability durability, unsigned int group,
+                       write_done_fn done);
+
+/* Look up a backend by name ("sync", "pool" or "uring"), -1 if unknown */
+int write_backend_parse(const char *name);
+
+const char *write_backend_name(enum write_backend_kind kind);
+
+/* Look up a policy by name ("none", "fdatasync", "syncfs" or "range") */
+int write_durability_parse(const char *name);
+
+const char *write_durability_name(enum write_durability durability);
+
+/*
+ * Queue one file. name is relative to dirfd, path is used for reporting
+ * and must end with name (the range policy reopens files by their last
+ * component, or by path with AT_FDCWD). Unless data_stable is set the data is copied, so the caller
+ * may reuse its buffer as soon as this returns. dirfd must stay open until
+ * the next write_backend_flush(). Returns 0, or -1 if the file could not
+ * be queued (it has then already been reported through the callback).
+ */
+int write_backend_submit(int dirfd, const char *name, const char *path,
+                         const char *data, size_t len, int data_stable);
+
+/* Wait until every submitted file has completed, and commit the group */
+void write_backend_flush(void);
+
+/* Flush and release the backend */
+void write_backend_finish(void);
+
+void write_backend_stats(struct write_stats *stats);
+
+/*
+ * For the backend implementations: the policy in use, a monotonic clock and
+ * the completion hook every backend reports through (serialised, like the
+ * done callback). submitted is write_now_ns() at submit time.
+ */
+extern enum write_durability write_durability;
+unsigned long long write_now_ns(void);
+void write_complete(const char *path, const char *data, size_t len,
+                    enum write_stage stage, int err, unsigned long long submitted);
+
+#endif /* WRITE_BACKEND_H */
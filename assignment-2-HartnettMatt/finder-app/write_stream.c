@@ -0,0 +1,184 @@
+/******************************************************************************
+ * write_stream.c
+ *
+ * Author: Matt Hartnett
+ *
+ * Zero-copy stream copy for writer's streaming mode, see write_stream.h.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include "write_stream.h"
+
+/* The method cannot be used for this pair of descriptors, try the next one */
+static int unsupported(int err)
+{
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP ||
+           err == EBADF || err == ESPIPE;
+}
+
+/*
+ * Each method copies until end of file and returns 1, returns 0 when it is
+ * not supported (possibly after copying some data), or -1 on a real error.
+ */
+
+static int copy_range(int in_fd, int out_fd, unsigned long long *copied)
+{
+    for (;;) {
+        ssize_t n = copy_file_range(in_fd, NULL, out_fd, NULL, WRITE_STREAM_CHUNK, 0);
+        if (n == 0)
+            return 1;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return unsupported(errno) ? 0 : -1;
+        *copied += n;
+    }
+}
+
+static int copy_sendfile(int in_fd, int out_fd, unsigned long long *copied)
+{
+    for (;;) {
+        ssize_t n = sendfile(out_fd, in_fd, NULL, WRITE_STREAM_CHUNK);
+        if (n == 0)
+            return 1;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return unsupported(errno) ? 0 : -1;
+        *copied += n;
+    }
+}
+
+/* Move n bytes already in a pipe into out_fd */
+static int drain_pipe(int pipe_fd, int out_fd, size_t n, unsigned long long *copied)
+{
+    while (n) {
+        ssize_t m = splice(pipe_fd, NULL, out_fd, NULL, n, SPLICE_F_MOVE);
+        if (m < 0 && errno == EINTR)
+            continue;
+        if (m <= 0)
+            return -1;    /* Data is stranded in the pipe, nothing can fall back */
+        n -= m;
+        *copied += m;
+    }
+    return 0;
+}
+
+static int copy_splice(int in_fd, int out_fd, unsigned long long *copied)
+{
+    struct stat st;
+    int p[2] = {-1, -1};
+    int ret = 0;
+
+    if (fstat(in_fd, &st) != 0)
+        return -1;
+    if (S_ISFIFO(st.st_mode)) {
+        /* Straight from the pipe into the file */
+        for (;;) {
+            ssize_t n = splice(in_fd, NULL, out_fd, NULL, WRITE_STREAM_CHUNK, SPLICE_F_MOVE);
+            if (n == 0)
+                return 1;
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                return unsupported(errno) ? 0 : -1;
+            *copied += n;
+        }
+    }
+
+    /* Sockets and devices go through a pipe of our own */
+    if (pipe2(p, O_CLOEXEC) != 0)
+        return 0;
+    fcntl(p[1], F_SETPIPE_SZ, WRITE_STREAM_BUFFER);
+    for (;;) {
+        ssize_t n = splice(in_fd, NULL, p[1], NULL, WRITE_STREAM_BUFFER, SPLICE_F_MOVE);
+        if (n == 0) {
+            ret = 1;
+            break;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            ret = unsupported(errno) ? 0 : -1;
+            break;
+        }
+        if (drain_pipe(p[0], out_fd, n, copied) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+    close(p[0]);
+    close(p[1]);
+    return ret;
+}
+
+static int copy_buffered(int in_fd, int out_fd, unsigned long long *copied)
+{
+    char *buf = malloc(WRITE_STREAM_BUFFER);
+    int ret = -1;
+
+    if (!buf)
+        return -1;
+    for (;;) {
+        ssize_t n = read(in_fd, buf, WRITE_STREAM_BUFFER);
+        ssize_t done = 0;
+        if (n == 0) {
+            ret = 1;
+            break;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            break;
+        while (done < n) {
+            ssize_t m = write(out_fd, buf + done, n - done);
+            if (m < 0 && errno == EINTR)
+                continue;
+            if (m < 0)
+                goto out;
+            done += m;
+            *copied += m;
+        }
+    }
+out:
+    free(buf);
+    return ret;
+}
+
+int write_stream(int in_fd, int out_fd, unsigned long long *copied, const char **method)
+{
+    static const struct {
+        const char *name;
+        int (*copy)(int in_fd, int out_fd, unsigned long long *copied);
+    } methods[] = {
+        { "copy_file_range", copy_range },
+        { "sendfile",        copy_sendfile },
+        { "splice",          copy_splice },
+        { "read/write",      copy_buffered },
+    };
+    struct stat st;
+    size_t first = 0;
+
+    *copied = 0;
+    /* The file to file methods only make sense from a regular file */
+    if (fstat(in_fd, &st) == 0 && !S_ISREG(st.st_mode))
+        first = 2;
+    for (size_t i = first; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        int ret = methods[i].copy(in_fd, out_fd, copied);
+        *method = methods[i].name;
+        if (ret > 0)
+            return 0;
+        if (ret < 0)
+            return -1;
+    }
+    return -1;    /* Not reached, read/write never reports unsupported */
+}
@@ -0,0 +1,30 @@
+/******************************************************************************
+ * write_stream.h
+ *
+ * Author: Matt Hartnett
+ *
+ * Copies a stream of any size between two descriptors in constant memory,
+ * letting the kernel move the data where it can:
+ *  - copy_file_range() between regular files (reflinks or in-kernel copy),
+ *  - sendfile() from a regular file,
+ *  - splice() from a pipe, or from a socket or device through a pipe,
+ *  - read()/write() with a WRITE_STREAM_BUFFER sized buffer otherwise.
+ * Every method uses and advances the file offsets, so when one is refused
+ * part way through the next one carries on from the same position.
+ *
+ *****************************************************************************/
+
+#ifndef WRITE_STREAM_H
+#define WRITE_STREAM_H
+
+#define WRITE_STREAM_BUFFER (1024 * 1024)   /* Fallback buffer */
+#define WRITE_STREAM_CHUNK  (1UL << 30)     /* Bytes per kernel copy call */
+
+/*
+ * Copy everything from in_fd until end of file into out_fd. Returns 0, or -1
+ * with errno set. copied is the number of bytes written either way, and
+ * method the name of the method that moved the last bytes.
+ */
+int write_stream(int in_fd, int out_fd, unsigned long long *copied, const char **method);
+
+#endif /* WRITE_STREAM_H */
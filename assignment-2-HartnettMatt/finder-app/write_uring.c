@@ -0,0 +1,487 @@
+/******************************************************************************
+ * write_uring.c
+ *
+ * Author: Matt Hartnett
+ *
+ * io_uring backend for writer, using the raw system calls so no liburing is
+ * needed on the target.
+ *
+ * Each file gets a slot, which owns one registered buffer and one direct
+ * descriptor (registered file table entry). A file is a linked chain:
+ *   OPENAT (into the slot's direct descriptor)
+ *   -> WRITE_FIXED (from the slot's registered buffer)
+ *   -> FSYNC (datasync) or SYNC_FILE_RANGE, for those durability policies
+ *   -> CLOSE (the direct descriptor)
+ * so it costs no system calls of its own. Chains are only handed to the
+ * kernel when all slots are busy, the submission queue is full or the
+ * caller flushes, which batches many files into one io_uring_enter(). The
+ * number of slots bounds the queue depth. Payloads bigger than a slot
+ * buffer use a plain WRITE from a heap copy.
+ *
+ * If a link fails (open error, short or failed write) the rest of the chain
+ * is cancelled; a cancelled close is resubmitted on its own so the direct
+ * descriptor is always released before the slot is reused.
+ *
+ * Needs Linux 5.17 or newer (direct descriptors for open and close, checked
+ * through IORING_FEAT_CQE_SKIP). write_backend_init() falls back to the
+ * pool backend when setup fails.
+ *
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include "write_backend.h"
+
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+#ifdef IORING_FEAT_CQE_SKIP
+
+#define URING_SLOT_SIZE (64 * 1024)    /* Registered buffer per slot */
+
+enum uring_op {
+    OP_OPEN,
+    OP_WRITE,
+    OP_SYNC,
+    OP_CLOSE,
+    OP_RECLOSE
+};
+
+/* user_data is the slot index shifted by OP_SHIFT, plus the op */
+#define OP_SHIFT 3
+#define OP_MASK  ((1 << OP_SHIFT) - 1)
+
+struct slot {
+    char        *path;          /* Copy, for reporting */
+    size_t       path_size;
+    char        *heap;          /* Payload copy when larger than the slot buffer */
+    const char  *data;          /* Payload as seen by the caller's callback */
+    size_t       len;
+    int          res[4];        /* Results of OP_OPEN up to OP_CLOSE */
+    int          pending;       /* Completions still expected */
+    unsigned long long submitted;
+    int          next_free;
+};
+
+static struct {
+    int              fd;
+    unsigned int     depth;
+    /* Submission ring */
+    void            *sq_ptr;
+    size_t           sq_size;
+    unsigned int    *sq_head;
+    unsigned int    *sq_tail;
+    unsigned int    *sq_mask;
+    unsigned int    *sq_array;
+    unsigned int     sq_entries;
+    unsigned int     to_submit;
+    struct io_uring_sqe *sqes;
+    size_t           sqes_size;
+    /* Completion ring */
+    void            *cq_ptr;
+    size_t           cq_size;
+    unsigned int    *cq_head;
+    unsigned int    *cq_tail;
+    unsigned int    *cq_mask;
+    struct io_uring_cqe *cqes;
+    /* Slots */
+    struct slot     *slots;
+    char            *buffers;
+    int              free_slot;
+    unsigned int     busy;
+} ring = { .fd = -1 };
+
+static int sys_setup(unsigned int entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    return syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_register(unsigned int opcode, void *arg, unsigned int nr)
+{
+    return syscall(__NR_io_uring_register, ring.fd, opcode, arg, nr);
+}
+
+static unsigned int sq_space(void)
+{
+    unsigned int head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    return ring.sq_entries - (*ring.sq_tail + ring.to_submit - head);
+}
+
+static struct io_uring_sqe *get_sqe(void)
+{
+    unsigned int tail = *ring.sq_tail + ring.to_submit;
+    unsigned int idx = tail & *ring.sq_mask;
+    struct io_uring_sqe *sqe = &ring.sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_array[idx] = idx;
+    ring.to_submit++;
+    return sqe;
+}
+
+static void complete_slot(int i);
+
+static void reap(void)
+{
+    unsigned int head = *ring.cq_head;
+    unsigned int tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        int i = cqe->user_data >> OP_SHIFT;
+        enum uring_op op = cqe->user_data & OP_MASK;
+
+        if (op != OP_RECLOSE)
+            ring.slots[i].res[op] = cqe->res;
+        if (--ring.slots[i].pending == 0)
+            complete_slot(i);
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* Hand queued entries to the kernel, optionally waiting for completions */
+static void enter(unsigned int wait)
+{
+    __atomic_store_n(ring.sq_tail, *ring.sq_tail + ring.to_submit, __ATOMIC_RELEASE);
+    ring.to_submit = 0;
+    for (;;) {
+        /* Everything published but not yet consumed, including leftovers */
+        unsigned int queued = *ring.sq_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+        int ret = sys_enter(queued, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+
+        if (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+            /* Completion queue full or interrupted, make room and retry */
+            reap();
+            continue;
+        }
+        if (ret < 0) {
+            perror("writer: io_uring_enter");
+            exit(1);
+        }
+        break;
+    }
+    reap();
+}
+
+static void complete_slot(int i)
+{
+    struct slot *s = &ring.slots[i];
+    enum write_stage stage = WRITE_STAGE_OPEN;
+    int err = 0;
+
+    if (s->res[OP_CLOSE] == -ECANCELED && s->res[OP_OPEN] >= 0) {
+        /* The chain broke after the open, release the direct descriptor.
+         * The ring holds four entries per slot, so there is always room. */
+        struct io_uring_sqe *sqe = get_sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = i + 1;
+        sqe->user_data = (uint64_t)i << OP_SHIFT | OP_RECLOSE;
+        s->res[OP_CLOSE] = 0;
+        s->pending = 1;
+        if (s->res[OP_WRITE] >= 0 && (size_t)s->res[OP_WRITE] != s->len)
+            s->res[OP_WRITE] = -EIO;    /* Short write */
+        return;
+    }
+
+    if (s->res[OP_OPEN] < 0) {
+        err = -s->res[OP_OPEN];
+    } else {
+        stage = WRITE_STAGE_WRITE;
+        if (s->res[OP_WRITE] < 0)
+            err = -s->res[OP_WRITE];
+        else if ((size_t)s->res[OP_WRITE] != s->len)
+            err = EIO;
+        else if (s->res[OP_CLOSE] < 0 && s->res[OP_CLOSE] != -ECANCELED)
+            err = -s->res[OP_CLOSE];
+        if (!err && s->res[OP_SYNC] < 0) {
+            stage = WRITE_STAGE_SYNC;
+            err = -s->res[OP_SYNC];
+        }
+    }
+    write_complete(s->path, s->data, s->len, stage, err, s->submitted);
+
+    free(s->heap);
+    s->heap = NULL;
+    s->next_free = ring.free_slot;
+    ring.free_slot = i;
+    ring.busy--;
+}
+
+static void release(void)
+{
+    if (ring.slots) {
+        for (unsigned int i = 0; i < ring.depth; i++)
+            free(ring.slots[i].path);
+        free(ring.slots);
+        ring.slots = NULL;
+    }
+    if (ring.buffers)
+        munmap(ring.buffers, (size_t)ring.depth * URING_SLOT_SIZE);
+    ring.buffers = NULL;
+    if (ring.sqes)
+        munmap(ring.sqes, ring.sqes_size);
+    if (ring.cq_ptr && ring.cq_ptr != ring.sq_ptr)
+        munmap(ring.cq_ptr, ring.cq_size);
+    if (ring.sq_ptr)
+        munmap(ring.sq_ptr, ring.sq_size);
+    ring.sqes = NULL;
+    ring.sq_ptr = ring.cq_ptr = NULL;
+    if (ring.fd >= 0)
+        close(ring.fd);
+    ring.fd = -1;
+}
+
+static int uring_init(unsigned int depth)
+{
+    struct io_uring_params p;
+    struct iovec *iov = NULL;
+    int *files = NULL;
+    unsigned int entries = 1;
+
+    /* Up to four entries per file, a stray close replaces a finished chain */
+    while (entries < depth * 4)
+        entries <<= 1;
+    memset(&p, 0, sizeof(p));
+    ring.fd = sys_setup(entries, &p);
+    if (ring.fd < 0)
+        return -1;
+    if (!(p.features & IORING_FEAT_CQE_SKIP)) {
+        errno = ENOSYS;    /* Kernel too old for direct descriptors */
+        goto fail;
+    }
+    ring.depth = depth;
+    ring.sq_entries = p.sq_entries;
+
+    ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring.cq_size > ring.sq_size)
+            ring.sq_size = ring.cq_size;
+        ring.cq_size = ring.sq_size;
+    }
+    ring.sq_ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ptr == MAP_FAILED) {
+        ring.sq_ptr = NULL;
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.cq_ptr = ring.sq_ptr;
+    } else {
+        ring.cq_ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+        if (ring.cq_ptr == MAP_FAILED) {
+            ring.cq_ptr = NULL;
+            goto fail;
+        }
+    }
+    ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        ring.sqes = NULL;
+        goto fail;
+    }
+    ring.sq_head = (unsigned int *)((char *)ring.sq_ptr + p.sq_off.head);
+    ring.sq_tail = (unsigned int *)((char *)ring.sq_ptr + p.sq_off.tail);
+    ring.sq_mask = (unsigned int *)((char *)ring.sq_ptr + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned int *)((char *)ring.sq_ptr + p.sq_off.array);
+    ring.cq_head = (unsigned int *)((char *)ring.cq_ptr + p.cq_off.head);
+    ring.cq_tail = (unsigned int *)((char *)ring.cq_ptr + p.cq_off.tail);
+    ring.cq_mask = (unsigned int *)((char *)ring.cq_ptr + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)((char *)ring.cq_ptr + p.cq_off.cqes);
+
+    /* One registered buffer and one empty direct descriptor per slot */
+    ring.slots = calloc(depth, sizeof(*ring.slots));
+    iov = calloc(depth, sizeof(*iov));
+    files = malloc(depth * sizeof(*files));
+    ring.buffers = mmap(NULL, (size_t)depth * URING_SLOT_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring.buffers == MAP_FAILED)
+        ring.buffers = NULL;
+    if (!ring.slots || !iov || !files || !ring.buffers) {
+        errno = ENOMEM;
+        goto fail;
+    }
+    for (unsigned int i = 0; i < depth; i++) {
+        iov[i].iov_base = ring.buffers + (size_t)i * URING_SLOT_SIZE;
+        iov[i].iov_len = URING_SLOT_SIZE;
+        files[i] = -1;
+        ring.slots[i].next_free = i + 1 < depth ? (int)i + 1 : -1;
+    }
+    if (sys_register(IORING_REGISTER_BUFFERS, iov, depth) < 0 ||
+        sys_register(IORING_REGISTER_FILES, files, depth) < 0)
+        goto fail;
+    free(iov);
+    free(files);
+    ring.free_slot = 0;
+    ring.busy = 0;
+    ring.to_submit = 0;
+    return 0;
+
+fail:
+    {
+        int err = errno;
+        free(iov);
+        free(files);
+        release();
+        errno = err;
+    }
+    return -1;
+}
+
+static int uring_submit(int dirfd, const char *name, const char *path,
+                        const char *data, size_t len, int data_stable)
+{
+    unsigned long long submitted = write_now_ns();
+    size_t path_size = strlen(path) + 1;
+    int chain = write_durability == WRITE_DURABLE_FDATASYNC ||
+                write_durability == WRITE_DURABLE_RANGE ? 4 : 3;
+    struct io_uring_sqe *sqe;
+    struct slot *s;
+    char *buf;
+    int i;
+
+    /* Bound the queue depth: wait for a slot, then make sure the chain fits */
+    while (ring.free_slot < 0)
+        enter(1);
+    if (sq_space() < (unsigned int)chain)
+        enter(0);
+    i = ring.free_slot;
+    s = &ring.slots[i];
+
+    if (s->path_size < path_size) {
+        char *p = realloc(s->path, path_size);
+        if (!p) {
+            write_complete(path, data, len, WRITE_STAGE_OPEN, ENOMEM, submitted);
+            return -1;
+        }
+        s->path = p;
+        s->path_size = path_size;
+    }
+    buf = ring.buffers + (size_t)i * URING_SLOT_SIZE;
+    if (len > URING_SLOT_SIZE && !data_stable) {
+        s->heap = malloc(len);
+        if (!s->heap) {
+            write_complete(path, data, len, WRITE_STAGE_OPEN, ENOMEM, submitted);
+            return -1;
+        }
+        memcpy(s->heap, data, len);
+    } else if (len <= URING_SLOT_SIZE) {
+        memcpy(buf, data, len);
+    }
+    memcpy(s->path, path, path_size);
+    s->data = len <= URING_SLOT_SIZE ? buf : s->heap ? s->heap : data;
+    s->len = len;
+    memset(s->res, 0, sizeof(s->res));
+    s->pending = chain;
+    s->submitted = submitted;
+    ring.free_slot = s->next_free;
+    ring.busy++;
+
+    /* name lives in the caller's buffer, the kernel copies it at submit */
+    sqe = get_sqe();
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = dirfd;
+    sqe->addr = (uintptr_t)(s->path + (name - path));
+    /* Direct descriptors are never inherited, the kernel rejects O_CLOEXEC */
+    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    sqe->len = 0666;
+    sqe->file_index = i + 1;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = (uint64_t)i << OP_SHIFT | OP_OPEN;
+
+    sqe = get_sqe();
+    sqe->opcode = len <= URING_SLOT_SIZE ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = i;
+    sqe->addr = (uintptr_t)s->data;
+    sqe->len = len;
+    sqe->off = 0;
+    sqe->buf_index = len <= URING_SLOT_SIZE ? i : 0;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+    sqe->user_data = (uint64_t)i << OP_SHIFT | OP_WRITE;
+
+    if (chain == 4) {
+        sqe = get_sqe();
+        if (write_durability == WRITE_DURABLE_FDATASYNC) {
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        } else {
+            /* Start writeback now, the group commit waits for it */
+            sqe->opcode = IORING_OP_SYNC_FILE_RANGE;
+            sqe->sync_range_flags = SYNC_FILE_RANGE_WRITE;
+        }
+        sqe->fd = i;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        sqe->user_data = (uint64_t)i << OP_SHIFT | OP_SYNC;
+    }
+
+    sqe = get_sqe();
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = i + 1;
+    sqe->user_data = (uint64_t)i << OP_SHIFT | OP_CLOSE;
+    return 0;
+}
+
+static void uring_flush(void)
+{
+    while (ring.busy || ring.to_submit)
+        enter(ring.busy ? 1 : 0);
+}
+
+static void uring_finish(void)
+{
+    uring_flush();
+    release();
+}
+
+#else /* !IORING_FEAT_CQE_SKIP */
+
+/* Headers too old for the io_uring backend, writer falls back to the pool */
+static int uring_init(unsigned int depth)
+{
+    (void)depth;
+    errno = ENOSYS;
+    return -1;
+}
+
+static int uring_submit(int dirfd, const char *name, const char *path,
+                        const char *data, size_t len, int data_stable)
+{
+    (void)dirfd; (void)name; (void)data_stable;
+    write_complete(path, data, len, WRITE_STAGE_OPEN, ENOSYS, write_now_ns());
+    return -1;
+}
+
+static void uring_flush(void)
+{
+}
+
+#define uring_finish uring_flush
+
+#endif /* IORING_FEAT_CQE_SKIP */
+
+const struct write_ops write_uring_ops = {
+    .name   = "uring",
+    .init   = uring_init,
+    .submit = uring_submit,
+    .flush  = uring_flush,
+    .finish = uring_finish,
+};
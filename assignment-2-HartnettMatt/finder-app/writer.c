@@ -1,66 +1,458 @@
 /******************************************************************************
  * writer.c
  *
- * Usage: writer <writefile> <writestr>
+ * Usage: writer [-b <backend>] [-q <depth>] [-d <durability>] [-g <group>] [-S]
+ *               <writefile> <writestr>
+ *        writer [...] -t <template> -n <count> [-s <start>] <writestr>
+ *        writer [...] -m < manifest
+ *        writer [...] -i <source|-> <writefile>
  *
  * Author: Matt Hartnett
  *
  * 1) Creates or overwrites the file <writefile> with the contents of <writestr>.
- * 2) Logs actions using syslog with LOG_USER facility.
+ * 2) Logs actions to syslog with LOG_USER facility, through the buffered
+ *    client in app_log.h.
  * 3) On error, prints an error message, logs the error, and returns with exit code 1.
  *
+ * Batch mode creates many files in one process:
+ *  -t  <template> is a printf-style path with one integer conversion, e.g.
+ *      /tmp/aeld-data/user%d.txt, filled in with <start> (default 1) up to
+ *      <start> + <count> - 1. Every file gets <writestr>.
+ *  -m  Reads a manifest from stdin, one "<writefile><TAB><writestr>" per line.
+ * Files are opened with openat() on a cached descriptor of their directory
+ * and written from reused buffers. The log is opened once; the first
+ * LOG_BURST files are logged individually, after that a progress summary is
+ * logged at most every LOG_INTERVAL seconds, plus a final summary. A failed
+ * file is reported and skipped, and the exit code is 1 if any file failed.
+ *
+ * Streaming mode (-i) copies the payload from <source>, or stdin for "-",
+ * instead of argv, so it is not limited by ARG_MAX and uses constant memory
+ * for any size. The data is moved by the kernel where possible, see
+ * write_stream.h. Any durability policy other than none fdatasync()s the
+ * file.
+ *
+ * Files are created by one of the backends in write_backend.h:
+ *  -b  sync (default), pool or uring. uring falls back to pool when the
+ *      kernel does not allow io_uring.
+ *  -q  Maximum files in flight for pool and uring (default WRITE_DEFAULT_DEPTH).
+ *  -d  Durability policy: none (default), fdatasync, syncfs or range.
+ *  -g  Files per group commit for syncfs and range (default WRITE_DEFAULT_GROUP).
+ *  -S  Print the backend, file count, bytes, elapsed time, files/s, MB/s and
+ *      the time until files were durable to stderr when done.
+ *
  *****************************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <syslog.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include "write_backend.h"
+#include "write_stream.h"
+#include "app_log.h"
 
-int main(int argc, char *argv[])
+#define LOG_BURST    10     /* Files logged individually before summarising */
+#define LOG_INTERVAL 1      /* Minimum seconds between progress summaries */
+
+/* Directory descriptor cache, batches usually write into one directory */
+static char cached_dir[PATH_MAX];
+static int cached_fd = -1;
+
+/* Batch statistics for the summary log */
+static unsigned long files_written;
+static unsigned long files_failed;
+static unsigned long long bytes_written;
+static unsigned long suppressed;
+static time_t last_summary;
+static const char *stream_method;   /* How streaming mode moved the data */
+
+static void log_summary(const char *what)
 {
-    /* Open a connection to syslog */
-    openlog("writer", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_USER);
-
-    /* Check for the correct number of arguments */
-    if (argc != 3) {
-        fprintf(stderr, "Error: Invalid number of arguments.\n");
-        syslog(LOG_ERR, "Invalid number of arguments. Expected 2, got %d", argc - 1);
-        closelog();
-        exit(1);
+    app_log(LOG_DEBUG, "%s: %lu files written, %llu bytes, %lu failed (%lu messages suppressed)",
+           what, files_written, bytes_written, files_failed, suppressed);
+    suppressed = 0;
+}
+
+/* Log a per-file message, or count it once the burst is used up */
+static int log_allowed(void)
+{
+    time_t now;
+
+    if (files_written + files_failed <= LOG_BURST)
+        return 1;
+    suppressed++;
+    now = time(NULL);
+    if (now - last_summary >= LOG_INTERVAL) {
+        last_summary = now;
+        log_summary("Progress");
+    }
+    return 0;
+}
+
+/* Get a descriptor for the directory containing path, and its last component */
+static int dir_for(const char *path, const char **name)
+{
+    const char *slash = strrchr(path, '/');
+    size_t len;
+
+    if (!slash) {
+        *name = path;
+        return AT_FDCWD;
+    }
+    *name = slash + 1;
+    len = slash == path ? 1 : (size_t)(slash - path);
+    if (len >= sizeof(cached_dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (cached_fd >= 0 && strncmp(cached_dir, path, len) == 0 && cached_dir[len] == '\0')
+        return cached_fd;
+
+    /* Files still in flight may be using the old descriptor */
+    if (cached_fd >= 0) {
+        write_backend_flush();
+        close(cached_fd);
+    }
+    memcpy(cached_dir, path, len);
+    cached_dir[len] = '\0';
+    cached_fd = open(cached_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return cached_fd;
+}
+
+/* Completion of one file, called by the backend */
+static void write_done_cb(const char *writefile, const char *writestr, size_t len,
+                          enum write_stage stage, int errnum)
+{
+    const char *err;
+
+    if (errnum == 0) {
+        files_written++;
+        bytes_written += len;
+        if (log_allowed())
+            app_log(LOG_DEBUG, "Writing %.*s to %s", (int)len, writestr, writefile);
+        return;
+    }
+
+    err = strerror(errnum);
+    if (stage == WRITE_STAGE_COMMIT) {
+        /* Already counted as written, but the group commit lost it */
+        files_written--;
+        bytes_written -= len;
+    }
+    if (stage == WRITE_STAGE_SYNC || stage == WRITE_STAGE_COMMIT) {
+        fprintf(stderr, "Error: Failed to sync file %s. Error: %s\n", writefile, err);
+        if (log_allowed())
+            app_log(LOG_ERR, "Failed to sync file %s: %s", writefile, err);
+    } else if (stage == WRITE_STAGE_OPEN) {
+        fprintf(stderr, "Error: Cannot open file %s for writing. Error: %s\n",
+                writefile, err);
+        if (log_allowed())
+            app_log(LOG_ERR, "Failed to open file %s: %s", writefile, err);
+    } else {
+        fprintf(stderr, "Error: Failed to write to file %s. Error: %s\n",
+                writefile, err);
+        if (log_allowed())
+            app_log(LOG_ERR, "Failed to write to file %s: %s", writefile, err);
+    }
+    files_failed++;
+}
+
+/*
+ * Errors found before a file reaches the backend are reported from the main
+ * thread, so wait for the pool callbacks to finish first. Only used on
+ * error paths.
+ */
+static void report_failure(void)
+{
+    write_backend_flush();
+    files_failed++;
+}
+
+/* Create or overwrite writefile with len bytes of writestr */
+static int write_file(const char *writefile, const char *writestr, size_t len,
+                      int stable)
+{
+    const char *name;
+    int dirfd = dir_for(writefile, &name);
+
+    if (dirfd == -1) {
+        int err = errno;
+        write_backend_flush();
+        write_done_cb(writefile, writestr, len, WRITE_STAGE_OPEN, err);
+        return -1;
+    }
+    return write_backend_submit(dirfd, name, writefile, writestr, len, stable);
+}
+
+/* Check that template has exactly one integer conversion and nothing else */
+static int valid_template(const char *template)
+{
+    int conversions = 0;
+
+    for (const char *p = template; *p; p++) {
+        if (*p != '%')
+            continue;
+        if (*++p == '%')
+            continue;
+        p += strspn(p, "-+ #0123456789");
+        if (*p != 'd' && *p != 'i' && *p != 'u')
+            return 0;
+        conversions++;
     }
+    return conversions == 1;
+}
 
-    const char *writefile = argv[1];
-    const char *writestr = argv[2];
+static void batch_template(const char *template, long start, long count, const char *writestr)
+{
+    char path[PATH_MAX];
+    size_t len = strlen(writestr);
 
-    /* Attempt to create or overwrite the file */
-    FILE *fp = fopen(writefile, "w");
-    if (fp == NULL) {
+    for (long i = start; i < start + count; i++) {
+        if (snprintf(path, sizeof(path), template, (int)i) >= (int)sizeof(path)) {
+            report_failure();
+            fprintf(stderr, "Error: Path for file %ld is too long\n", i);
+            continue;
+        }
+        write_file(path, writestr, len, 1);
+    }
+}
+
+static void batch_manifest(FILE *in)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    unsigned long lineno = 0;
+
+    /* getline() reuses and grows the same buffer for every line */
+    while ((len = getline(&line, &size, in)) >= 0) {
+        char *tab = memchr(line, '\t', len);
+        lineno++;
+        if (len && line[len - 1] == '\n')
+            line[--len] = '\0';
+        if (len == 0)
+            continue;
+        if (!tab) {
+            report_failure();
+            fprintf(stderr, "Error: Manifest line %lu has no tab separator\n", lineno);
+            if (log_allowed())
+                app_log(LOG_ERR, "Manifest line %lu has no tab separator", lineno);
+            continue;
+        }
+        *tab = '\0';
+        /* The line buffer is reused, so the backend has to copy it */
+        write_file(line, tab + 1, line + len - (tab + 1), 0);
+    }
+    free(line);
+}
+
+/* Stream source (a path, or "-" for stdin) into writefile */
+static int stream_file(const char *source, const char *writefile, int durability)
+{
+    unsigned long long copied = 0;
+    const char *method = "none";
+    const char *what = "write to";
+    int in_fd = STDIN_FILENO, out_fd;
+    int ret = -1;
+
+    if (strcmp(source, "-") != 0) {
+        in_fd = open(source, O_RDONLY | O_CLOEXEC);
+        if (in_fd < 0) {
+            const char *err = strerror(errno);
+            fprintf(stderr, "Error: Cannot open source %s. Error: %s\n", source, err);
+            app_log(LOG_ERR, "Failed to open source %s: %s", source, err);
+            files_failed++;
+            return -1;
+        }
+    }
+    out_fd = open(writefile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (out_fd < 0) {
+        const char *err = strerror(errno);
         fprintf(stderr, "Error: Cannot open file %s for writing. Error: %s\n",
-                writefile, strerror(errno));
-        syslog(LOG_ERR, "Failed to open file %s: %s", writefile, strerror(errno));
-        closelog();
+                writefile, err);
+        app_log(LOG_ERR, "Failed to open file %s: %s", writefile, err);
+        goto out;
+    }
+
+    if (write_stream(in_fd, out_fd, &copied, &method) == 0) {
+        stream_method = method;
+        what = "sync";
+        if (durability == WRITE_DURABLE_NONE || fdatasync(out_fd) == 0)
+            ret = 0;
+    }
+    if (close(out_fd) != 0 && ret == 0) {
+        what = "write to";
+        ret = -1;
+    }
+    if (ret != 0) {
+        const char *err = strerror(errno);
+        fprintf(stderr, "Error: Failed to %s file %s. Error: %s\n", what, writefile, err);
+        app_log(LOG_ERR, "Failed to %s file %s after %llu bytes: %s", what, writefile,
+               copied, err);
+    } else {
+        app_log(LOG_DEBUG, "Writing %llu bytes from %s to %s using %s", copied,
+               in_fd == STDIN_FILENO ? "stdin" : source, writefile, method);
+    }
+
+out:
+    if (in_fd != STDIN_FILENO)
+        close(in_fd);
+    bytes_written += copied;
+    if (ret == 0)
+        files_written++;
+    else
+        files_failed++;
+    return ret;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: writer [-b sync|pool|uring] [-q <depth>] "
+                    "[-d none|fdatasync|syncfs|range] [-g <group>] [-S]\n"
+                    "              <writefile> <writestr>\n"
+                    "       writer [...] -t <template> -n <count> [-s <start>] <writestr>\n"
+                    "       writer [...] -m < manifest\n"
+                    "       writer [...] -i <source|-> <writefile>\n");
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_stats(int backend, int durability, double elapsed)
+{
+    struct write_stats ws;
+
+    write_backend_stats(&ws);
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+    fprintf(stderr, "backend=%s durability=%s files=%lu failed=%lu bytes=%llu "
+                    "elapsed=%.6f files/s=%.0f MB/s=%.2f commits=%lu "
+                    "latency_avg_ms=%.3f latency_max_ms=%.3f commit_max_ms=%.3f\n",
+            write_backend_name(backend), write_durability_name(durability),
+            files_written, files_failed, bytes_written, elapsed,
+            files_written / elapsed, bytes_written / elapsed / 1e6, ws.commits,
+            ws.files ? ws.latency_sum / ws.files * 1e3 : 0.0,
+            ws.latency_max * 1e3, ws.commit_max * 1e3);
+    if (stream_method)
+        fprintf(stderr, "method=%s\n", stream_method);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *template = NULL, *source = NULL;
+    long count = -1, start = 1;
+    int manifest = 0, stats = 0;
+    int backend = WRITE_BACKEND_SYNC, requested;
+    long depth = WRITE_DEFAULT_DEPTH, group = WRITE_DEFAULT_GROUP;
+    int durability = WRITE_DURABLE_NONE;
+    double started;
+    int opt;
+
+    /* Open a connection to syslog, records are batched until closed */
+    app_log_open("writer", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_USER);
+
+    /* Options must come first, so single mode paths are never parsed */
+    while ((opt = getopt(argc, argv, "+t:n:s:mi:b:q:d:g:S")) != -1) {
+        switch (opt) {
+        case 't': template = optarg; break;
+        case 'n': count = atol(optarg); break;
+        case 's': start = atol(optarg); break;
+        case 'm': manifest = 1; break;
+        case 'i': source = optarg; break;
+        case 'b': backend = write_backend_parse(optarg); break;
+        case 'q': depth = atol(optarg); break;
+        case 'd': durability = write_durability_parse(optarg); break;
+        case 'g': group = atol(optarg); break;
+        case 'S': stats = 1; break;
+        default:
+            usage();
+            app_log_close();
+            exit(1);
+        }
+    }
+    if (backend < 0 || durability < 0 || depth < 1 || depth > WRITE_MAX_DEPTH ||
+        group < 1 || group > INT_MAX) {
+        fprintf(stderr, "Error: Unknown backend or durability, or depth not in 1..%d\n",
+                WRITE_MAX_DEPTH);
+        usage();
+        app_log_close();
         exit(1);
     }
 
-    /* Write the string to the file */
-    if (fputs(writestr, fp) == EOF) {
-        fprintf(stderr, "Error: Failed to write to file %s. Error: %s\n",
-                writefile, strerror(errno));
-        syslog(LOG_ERR, "Failed to write to file %s: %s", writefile, strerror(errno));
-        fclose(fp);
-        closelog();
+    requested = backend;
+    backend = write_backend_init(requested, depth, durability, group, write_done_cb);
+    if (backend < 0) {
+        fprintf(stderr, "Error: Cannot start the %s backend. Error: %s\n",
+                write_backend_name(requested), strerror(errno));
+        app_log(LOG_ERR, "Cannot start the %s backend: %m", write_backend_name(requested));
+        app_log_close();
         exit(1);
     }
+    if (backend != requested)
+        app_log(LOG_DEBUG, "Backend %s not available, using %s",
+               write_backend_name(requested), write_backend_name(backend));
+    started = now_sec();
 
-    /* Log debug message */
-    syslog(LOG_DEBUG, "Writing %s to %s", writestr, writefile);
+    if (source) {
+        if (manifest || template || optind != argc - 1) {
+            usage();
+            write_backend_finish();
+            app_log_close();
+            exit(1);
+        }
+        stream_file(source, argv[optind], durability);
+    } else if (manifest) {
+        if (template || optind != argc) {
+            usage();
+            write_backend_finish();
+            app_log_close();
+            exit(1);
+        }
+        last_summary = time(NULL);
+        batch_manifest(stdin);
+        write_backend_flush();
+        log_summary("Batch complete");
+    } else if (template) {
+        if (count < 0 || optind != argc - 1 || !valid_template(template)) {
+            fprintf(stderr, "Error: Template mode needs a template with one integer "
+                            "conversion, a count and <writestr>.\n");
+            app_log(LOG_ERR, "Invalid template arguments");
+            usage();
+            write_backend_finish();
+            app_log_close();
+            exit(1);
+        }
+        last_summary = time(NULL);
+        batch_template(template, start, count, argv[optind]);
+        write_backend_flush();
+        log_summary("Batch complete");
+    } else {
+        /* Check for the correct number of arguments */
+        if (argc - optind != 2) {
+            fprintf(stderr, "Error: Invalid number of arguments.\n");
+            app_log(LOG_ERR, "Invalid number of arguments. Expected 2, got %d", argc - optind);
+            write_backend_finish();
+            app_log_close();
+            exit(1);
+        }
+        write_file(argv[optind], argv[optind + 1], strlen(argv[optind + 1]), 1);
+    }
 
-    /* Clean up */
-    fclose(fp);
-    closelog();
+    /* Clean up, finishing the backend completes every file still in flight */
+    write_backend_finish();
+    if (stats)
+        print_stats(backend, durability, now_sec() - started);
+    if (cached_fd >= 0)
+        close(cached_fd);
+    app_log_close();
 
-    return 0;
+    return files_failed ? 1 : 0;
 }
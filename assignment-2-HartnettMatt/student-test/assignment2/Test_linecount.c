@@ -0,0 +1,111 @@
+#include "unity.h"
+#include "unity_bench.h"
+#include "unity_register.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../finder-app/finder_linecount.h"
+
+/**
+* Checks every line counting implementation the CPU supports against the scalar reference
+* (memmem() and memchr()) in finder-app/finder_linecount.c, on fixed cases around the
+* vector block boundaries and on random buffers, and times the implementation lc_best() picks
+* against the scalar one with TEST_BENCHMARK from Unity/extras/bench.
+*/
+
+static long count(enum lc_impl impl, const char *buf, const char *pat)
+{
+    return lc_count_lines_with(impl, buf, strlen(buf), pat, strlen(pat));
+}
+
+UNITY_TEST(test_linecount_fixed_cases)
+{
+    /* Lines of 40 bytes so matches land on both sides of 16 and 32 byte blocks */
+    const char *text =
+        "the quick brown fox jumps over the dog.\n"
+        "nothing to see here, move along please.\n"
+        "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxfox\n"
+        "fox fox fox fox fox fox fox fox fox fox\n"
+        "last line has no newline at all fo";
+    for (int impl = 0; impl < LC_IMPLS; impl++) {
+        char msg[64];
+        if (!lc_supported(impl))
+            continue;
+        snprintf(msg, sizeof(msg), "FAIL: %s", lc_impl_name(impl));
+        TEST_ASSERT_EQUAL_INT_MESSAGE(3, count(impl, text, "fox"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(1, count(impl, text, "the"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(1, count(impl, text, "at all fo"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, count(impl, text, "cat"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(3, count(impl, text, "e"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(5, count(impl, text, ""), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(1, count(impl, text, "nothing to see here, move along please."), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, count(impl, "", "fox"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, count(impl, "", ""), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(2, count(impl, "\n\n", ""), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, count(impl, "fo", "fox"), msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(1, count(impl, "fox", "fox"), msg);
+    }
+}
+
+UNITY_TEST(test_linecount_random_buffers)
+{
+    static const char alphabet[] = "aab\n";
+    uint64_t state = 1;
+    char buf[300];
+    char pat[8];
+
+    for (int iter = 0; iter < 20000; iter++) {
+        /* Random unaligned window of a buffer over a small alphabet */
+        size_t off = state % 16;
+        size_t len = (state >> 8) % (sizeof(buf) - 16);
+        size_t plen = (state >> 20) % sizeof(pat);
+        for (size_t i = 0; i < off + len; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            buf[i] = alphabet[state >> 62];
+        }
+        for (size_t i = 0; i < plen; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            pat[i] = alphabet[(state >> 62) % 2 + (i == plen / 2 ? 1 : 0)];
+        }
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        long expect = lc_count_lines_with(LC_SCALAR, buf + off, len, pat, plen);
+        for (int impl = 0; impl < LC_IMPLS; impl++) {
+            char msg[64];
+            if (!lc_supported(impl))
+                continue;
+            snprintf(msg, sizeof(msg), "FAIL: %s, iteration %d", lc_impl_name(impl), iter);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(expect, lc_count_lines_with(impl, buf + off, len, pat, plen), msg);
+        }
+    }
+}
+
+UNITY_TEST(test_linecount_best_is_supported)
+{
+    TEST_ASSERT_TRUE_MESSAGE(lc_supported(lc_best()), "FAIL: lc_best() picked an unsupported implementation");
+    TEST_ASSERT_TRUE_MESSAGE(lc_supported(LC_SCALAR), "FAIL: scalar must always be available");
+}
+
+UNITY_TEST(test_linecount_best_not_slower_than_scalar)
+{
+    static char text[64 * 1024];
+    uint64_t state = 1;
+
+    /* Lines of 2 to 80 random lower case letters, some of them containing the pattern */
+    for (size_t i = 0; i < sizeof(text); i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        text[i] = (state >> 58) < 2 ? '\n' : (char)('a' + (state >> 59) % 26);
+    }
+
+    TEST_BENCHMARK("linecount scalar 64KB") {
+        UNITY_BENCH_KEEP(lc_count_lines_with(LC_SCALAR, text, sizeof(text), "fox", 3));
+    }
+    double scalar_ns = UnityBenchLastResult()->MedianNs;
+
+    enum lc_impl best = lc_best();
+    TEST_BENCHMARK(lc_impl_name(best)) {
+        UNITY_BENCH_KEEP(lc_count_lines_with(best, text, sizeof(text), "fox", 3));
+    }
+    TEST_ASSERT_BENCH_FASTER_THAN_NS_MESSAGE(scalar_ns * 1.5, "FAIL: lc_best() is slower than the scalar reference");
+}
@@ -0,0 +1,88 @@
+/**
+ * @file bench_hotpath.c
+ * @brief Microbenchmark of the calls made from the real-time control loop.
+ * @author Matt Hartnett
+ * @details
+ * Times the bookkeeping the control loop does every iteration (watchdog
+ * heartbeat, energy accounting, telemetry publish) so changes to those paths can be checked
+ * for added latency. Runs against the simulator or the real drivers,
+ * whichever the benchmark was linked with.
+ *
+ * Usage: bench_hotpath [iterations]
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../whiteboard_wiper/inc/power.h"
+#include "../whiteboard_wiper/inc/watchdog.h"
+#include "../whiteboard_wiper/inc/telemetry.h"
+
+#define DEFAULT_ITERATIONS 1000000
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t ns, long iterations)
+{
+    printf("%-20s %8.1f ns/op\n", name, (double)ns / iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    long slow_iterations = iterations / 100 ? iterations / 100 : 1;
+    struct power_report r;
+    uint64_t t0;
+
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    power_init();
+    // Long period so the watchdog never trips during the run
+    if (watchdog_start(60000000) != 0) {
+        perror("watchdog_start");
+        return 1;
+    }
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+        watchdog_kick();
+    report("watchdog_kick", now_ns() - t0, iterations);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+        power_motor_set(i & 1);
+    report("power_motor_set", now_ns() - t0, iterations);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+        power_sensor_ping();
+    report("power_sensor_ping", now_ns() - t0, iterations);
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        struct telemetry_state *tm = telemetry_back();
+        tm->timestamp_us = i;
+        tm->range_m = 0.5f;
+        telemetry_publish();
+        telemetry_record_loop(100000, 50);
+    }
+    report("telemetry_publish", now_ns() - t0, iterations);
+
+    t0 = now_ns();
+    for (long i = 0; i < slow_iterations; i++)
+        power_get_report(&r);
+    report("power_get_report", now_ns() - t0, slow_iterations);
+
+    watchdog_stop();
+    return 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Run an instrumented whiteboard_wiper for a fixed time to collect PGO
+# profiles. The program is stopped with SIGINT so it exits through its
+# normal cleanup path and the profile data is written out.
+#
+# Usage: pgo-train.sh <whiteboard_wiper binary> <seconds>
+#
+# Author: Matt Hartnett
+
+if [ $# -ne 2 ]; then
+    echo "Error: Two arguments required: <binary> <seconds>"
+    exit 1
+fi
+
+echo "Training $1 for $2 seconds"
+timeout -s INT "$2" "$1"
+status=$?
+
+# timeout reports 124 when it had to stop the program, which is expected
+if [ $status -ne 0 ] && [ $status -ne 124 ]; then
+    echo "Error: training run failed with status $status"
+    exit $status
+fi
+exit 0
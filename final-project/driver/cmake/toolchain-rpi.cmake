@@ -0,0 +1,45 @@
+###############################################################################
+# Toolchain file for cross-compiling the driver for the Raspberry Pi
+#
+# Usage:
+#  cmake -DCMAKE_TOOLCHAIN_FILE=cmake/toolchain-rpi.cmake \
+#        -DCROSS_COMPILE=arm-linux-gnueabihf- -DSTAGING_DIR=<sysroot> ...
+#
+# CROSS_COMPILE and STAGING_DIR may also come from the environment, which
+# matches how the makefiles are driven (e.g. by Buildroot, where
+# STAGING_DIR is output/staging).
+#
+# Author: Matt Hartnett
+###############################################################################
+
+if(NOT CROSS_COMPILE AND DEFINED ENV{CROSS_COMPILE})
+    set(CROSS_COMPILE $ENV{CROSS_COMPILE})
+endif()
+if(NOT STAGING_DIR AND DEFINED ENV{STAGING_DIR})
+    set(STAGING_DIR $ENV{STAGING_DIR})
+endif()
+if(NOT CROSS_COMPILE)
+    message(FATAL_ERROR "CROSS_COMPILE must be set, e.g. arm-linux-gnueabihf-")
+endif()
+
+# try_compile() re-reads this file in a fresh project, pass the settings on
+list(APPEND CMAKE_TRY_COMPILE_PLATFORM_VARIABLES CROSS_COMPILE STAGING_DIR)
+
+string(REGEX MATCH "^[^-]+" WIPER_TARGET_ARCH "${CROSS_COMPILE}")
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR ${WIPER_TARGET_ARCH})
+
+set(CMAKE_C_COMPILER ${CROSS_COMPILE}gcc)
+set(CMAKE_AR ${CROSS_COMPILE}ar CACHE FILEPATH "Archiver")
+set(CMAKE_RANLIB ${CROSS_COMPILE}ranlib CACHE FILEPATH "Ranlib")
+
+if(STAGING_DIR)
+    set(CMAKE_SYSROOT ${STAGING_DIR})
+    set(CMAKE_FIND_ROOT_PATH ${STAGING_DIR})
+endif()
+
+# Programs come from the host, everything else from the target sysroot
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
@@ -0,0 +1,140 @@
+/**
+ * @file test_watchdog.c
+ * @brief Watchdog test against the simulator.
+ * @author Matt Hartnett
+ * @details
+ * Kicks the watchdog like a healthy control loop for a bit over one feed
+ * period, then stalls past the deadline and checks that the watchdog
+ * stopped the motors, counted the miss, measured the overrun on the next
+ * kick and exported it. The watchdog is built with WATCHDOG_DEV pointing
+ * at a plain file, which must hold one feed per feed period while the
+ * loop was healthy followed by the magic close.
+ *
+ * Usage: test_watchdog
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../whiteboard_wiper/inc/motor.h"
+#include "../whiteboard_wiper/inc/power.h"
+#include "../whiteboard_wiper/inc/watchdog.h"
+
+#define PERIOD_US   10000                        // Simulated loop period
+#define HEALTHY_US  (WATCHDOG_FEED_PERIOD + 200000)
+#define STALL_US    (PERIOD_US + WATCHDOG_SLACK + 150000)
+#define STATS_PATH  WATCHDOG_DEV ".loop"
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// Value of "key=" in an exported stats file, or -1
+static long long read_stat(const char *path, const char *key)
+{
+    char line[128];
+    size_t len = strlen(key);
+    long long value = -1;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp)
+        return -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, len) == 0 && line[len] == '=') {
+            value = atoll(line + len + 1);
+            break;
+        }
+    }
+    fclose(fp);
+    return value;
+}
+
+int main(void)
+{
+    struct watchdog_stats ws;
+    char dev[64];
+    ssize_t n;
+    int fd;
+
+    // The device file is opened write only by the watchdog, start it empty
+    fd = open(WATCHDOG_DEV, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    CHECK(fd >= 0);
+    if (fd >= 0)
+        close(fd);
+
+    // Stats must be readable before the watchdog was ever started
+    watchdog_get_stats(&ws);
+    CHECK(ws.kicks == 0 && ws.misses == 0 && ws.trips == 0);
+
+    power_init();
+    CHECK(motor_init() == 0);
+    motor_forward_start();
+    CHECK(watchdog_start(PERIOD_US) == 0);
+
+    // Healthy loop
+    for (uint64_t t0 = now_us(); now_us() - t0 < HEALTHY_US; ) {
+        CHECK(watchdog_kick() == 0);
+        usleep(PERIOD_US);
+    }
+    CHECK(motor_get_state() == MOTOR_FORWARD);
+    watchdog_get_stats(&ws);
+    CHECK(ws.misses == 0 && ws.trips == 0);
+
+    // Stall past the deadline
+    usleep(STALL_US);
+    CHECK(motor_get_state() == MOTOR_STOPPED);
+    watchdog_get_stats(&ws);
+    CHECK(ws.trips == 1);
+    CHECK(ws.misses == 1);
+
+    // The next kick reports the trip and measures the overrun
+    CHECK(watchdog_kick() == 1);
+    watchdog_get_stats(&ws);
+    CHECK(ws.misses == 1);
+    CHECK(ws.worst_overrun_us >= STALL_US - PERIOD_US - WATCHDOG_SLACK - PERIOD_US);
+    CHECK(ws.worst_overrun_us == ws.last_overrun_us);
+
+    CHECK(watchdog_export(STATS_PATH) == 0);
+    CHECK(read_stat(STATS_PATH, "loop_iterations") == (long long)ws.kicks);
+    CHECK(read_stat(STATS_PATH, "missed_deadlines") == 1);
+    CHECK(read_stat(STATS_PATH, "watchdog_trips") == 1);
+    CHECK(read_stat(STATS_PATH, "worst_overrun_us") == (long long)ws.worst_overrun_us);
+    unlink(STATS_PATH);
+
+    watchdog_stop();
+    motor_deinit();
+
+    // One feed at start and one per feed period, then the magic close
+    fd = open(WATCHDOG_DEV, O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+    n = fd >= 0 ? read(fd, dev, sizeof(dev)) : -1;
+    if (fd >= 0)
+        close(fd);
+    CHECK(n >= 3);
+    if (n >= 3) {
+        CHECK(memchr(dev, 'V', n - 1) == NULL);
+        CHECK(dev[n - 1] == 'V');
+        CHECK(n - 1 == 1 + HEALTHY_US / WATCHDOG_FEED_PERIOD);
+    }
+    unlink(WATCHDOG_DEV);
+
+    printf("test_watchdog: %s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -17,6 +17,7 @@
 #include "driver_hcsr04.h"
 #include "driver_hcsr04_interface.h"
 #include "gpiod.h"
+#include "power.h"
 
 // Internal libgpiod line requests
 static struct gpiod_line_request *trig_req = NULL;
@@ -124,6 +125,7 @@ int read_hcsr04(uint32_t *echo_time_us, float *distance_m) {
     uint32_t raw_us;
     float raw_m;
     int ret = hcsr04_read(&_hcsr04_handle, &raw_us, &raw_m);
+    power_sensor_ping();
     if (ret)
         return ret;
     // clamp reflections >1000us
@@ -1,10 +1,19 @@
 /**
  * @file motor.c
  * @brief Motor control implementation using libgpiod.
+ * @details
+ * The control loop and the watchdog thread both drive the motors, so
+ * every change of the four H-bridge lines is made under one priority
+ * inheritance mutex. The watchdog thread runs above the control loop and
+ * must not wait behind it while it is preempted.
  */
 #include "motor.h"
+#include "gpiod.h"
+#include "power.h"
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 static struct gpiod_line_request *mr1_req = NULL;
 static struct gpiod_line_request *mr2_req = NULL;
@@ -16,6 +25,20 @@ static unsigned int mr2_offset = MOTOR_RIGHT_2_OFFSET;
 static unsigned int ml1_offset = MOTOR_LEFT_1_OFFSET;
 static unsigned int ml2_offset = MOTOR_LEFT_2_OFFSET;
 
+static atomic_int state = MOTOR_STOPPED;
+static pthread_mutex_t lock;
+static pthread_once_t lock_once = PTHREAD_ONCE_INIT;
+
+static void lock_init(void)
+{
+    pthread_mutexattr_t mattr;
+
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&lock, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+}
+
 int motor_init(void)
 {
     enum gpiod_line_value inactive = GPIOD_LINE_VALUE_INACTIVE;
@@ -41,44 +64,56 @@ fail:
     return -1;
 }
 
+// Drive the H-bridge lines, serialised so a stop from the watchdog thread
+// can't interleave with the control loop and leave the bridge half driven
+static void set_drive(enum gpiod_line_value mr1, enum gpiod_line_value mr2,
+                      enum gpiod_line_value ml1, enum gpiod_line_value ml2,
+                      enum motor_state s)
+{
+    pthread_once(&lock_once, lock_init);
+    pthread_mutex_lock(&lock);
+    gpiod_line_request_set_value(mr1_req, mr1_offset, mr1);
+    gpiod_line_request_set_value(mr2_req, mr2_offset, mr2);
+    gpiod_line_request_set_value(ml1_req, ml1_offset, ml1);
+    gpiod_line_request_set_value(ml2_req, ml2_offset, ml2);
+    atomic_store(&state, s);
+    power_motor_set(s != MOTOR_STOPPED);
+    pthread_mutex_unlock(&lock);
+}
+
 void motor_forward_start(void)
 {
-    gpiod_line_request_set_value(mr1_req, mr1_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(mr2_req, mr2_offset, GPIOD_LINE_VALUE_ACTIVE);
-    gpiod_line_request_set_value(ml1_req, ml1_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(ml2_req, ml2_offset, GPIOD_LINE_VALUE_ACTIVE);
+    set_drive(GPIOD_LINE_VALUE_INACTIVE, GPIOD_LINE_VALUE_ACTIVE,
+              GPIOD_LINE_VALUE_INACTIVE, GPIOD_LINE_VALUE_ACTIVE, MOTOR_FORWARD);
 }
 
 void motor_stop(void)
 {
-    gpiod_line_request_set_value(mr1_req, mr1_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(mr2_req, mr2_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(ml1_req, ml1_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(ml2_req, ml2_offset, GPIOD_LINE_VALUE_INACTIVE);
+    set_drive(GPIOD_LINE_VALUE_INACTIVE, GPIOD_LINE_VALUE_INACTIVE,
+              GPIOD_LINE_VALUE_INACTIVE, GPIOD_LINE_VALUE_INACTIVE, MOTOR_STOPPED);
 }
 
 void motor_backward_start(void)
 {
-    gpiod_line_request_set_value(mr1_req, mr1_offset, GPIOD_LINE_VALUE_ACTIVE);
-    gpiod_line_request_set_value(mr2_req, mr2_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(ml1_req, ml1_offset, GPIOD_LINE_VALUE_ACTIVE);
-    gpiod_line_request_set_value(ml2_req, ml2_offset, GPIOD_LINE_VALUE_INACTIVE);
+    set_drive(GPIOD_LINE_VALUE_ACTIVE, GPIOD_LINE_VALUE_INACTIVE,
+              GPIOD_LINE_VALUE_ACTIVE, GPIOD_LINE_VALUE_INACTIVE, MOTOR_BACKWARD);
 }
 
 void motor_turn_cw_start(void)
 {
-    gpiod_line_request_set_value(mr1_req, mr1_offset, GPIOD_LINE_VALUE_ACTIVE);
-    gpiod_line_request_set_value(mr2_req, mr2_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(ml1_req, ml1_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(ml2_req, ml2_offset, GPIOD_LINE_VALUE_ACTIVE);
+    set_drive(GPIOD_LINE_VALUE_ACTIVE, GPIOD_LINE_VALUE_INACTIVE,
+              GPIOD_LINE_VALUE_INACTIVE, GPIOD_LINE_VALUE_ACTIVE, MOTOR_TURN_CW);
 }
 
 void motor_turn_ccw_start(void)
 {
-    gpiod_line_request_set_value(mr1_req, mr1_offset, GPIOD_LINE_VALUE_INACTIVE);
-    gpiod_line_request_set_value(mr2_req, mr2_offset, GPIOD_LINE_VALUE_ACTIVE);
-    gpiod_line_request_set_value(ml1_req, ml1_offset, GPIOD_LINE_VALUE_ACTIVE);
-    gpiod_line_request_set_value(ml2_req, ml2_offset, GPIOD_LINE_VALUE_INACTIVE);
+    set_drive(GPIOD_LINE_VALUE_INACTIVE, GPIOD_LINE_VALUE_ACTIVE,
+              GPIOD_LINE_VALUE_ACTIVE, GPIOD_LINE_VALUE_INACTIVE, MOTOR_TURN_CCW);
+}
+
+enum motor_state motor_get_state(void)
+{
+    return atomic_load(&state);
 }
 
 void motor_deinit(void)
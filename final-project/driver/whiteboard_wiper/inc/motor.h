@@ -20,7 +20,16 @@
 #define MOTOR_LEFT_1_OFFSET 23
 #define MOTOR_LEFT_2_OFFSET 24
 
-#include "gpiod.h"
+/**
+ * @brief Last commanded motor state.
+ */
+enum motor_state {
+    MOTOR_STOPPED = 0,
+    MOTOR_FORWARD,
+    MOTOR_BACKWARD,
+    MOTOR_TURN_CW,
+    MOTOR_TURN_CCW
+};
 
 
 /**
@@ -57,6 +66,15 @@ void motor_turn_cw_start(void);
  */
 void motor_turn_ccw_start(void);
 
+/**
+ * @brief Get the last commanded motor state.
+ *
+ * Safe to call from any thread.
+ *
+ * @return The state set by the most recent motor_*() call.
+ */
+enum motor_state motor_get_state(void);
+
 /**
  * @brief Start a counterclockwise turn.
  */
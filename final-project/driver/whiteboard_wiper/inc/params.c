@@ -0,0 +1,528 @@
+/**
+ * @file params.c
+ * @brief Runtime tunable parameters implementation.
+ * @details
+ * The current snapshot is an atomic pointer. The control loop loads it
+ * and records the version it is now using; the update thread is the only
+ * writer, so it copies the current snapshot, applies and validates the
+ * change, and publishes the copy with a single atomic store. Replaced
+ * snapshots go on a retire list and are freed once the loop reports a
+ * newer version, which proves it no longer holds a pointer to them.
+ *
+ * The update thread multiplexes a stop eventfd, the inotify descriptor,
+ * the control socket and its clients with poll().
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include "params.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define RECLAIM_POLL_MS 100    // Retry period while snapshots await reclaim
+#define MAX_FILE_SIZE   4096
+#define MAX_LINE        256
+
+struct params_node {
+    struct wiper_params p;      // First member, nodes are handed out as this
+    struct params_node *next;   // Retire list link
+};
+
+struct param_desc {
+    const char *name;
+    int         is_float;
+    size_t      offset;
+    double      min;
+    double      max;
+};
+
+static const struct param_desc descs[] = {
+    { "wall_range_m",       1, offsetof(struct wiper_params, wall_range_m),       0.005, 1.0 },
+    { "reverse_time_us",    0, offsetof(struct wiper_params, reverse_time_us),    0,     5000000 },
+    { "turnaround_time_us", 0, offsetof(struct wiper_params, turnaround_time_us), 0,     10000000 },
+    { "covered_range_m",    1, offsetof(struct wiper_params, covered_range_m),    0.0,   0.5 },
+    { "idle_samples",       0, offsetof(struct wiper_params, idle_samples),       1,     1000 },
+    { "filter_alpha",       1, offsetof(struct wiper_params, filter_alpha),       0.01,  1.0 },
+};
+#define NUM_PARAMS (sizeof(descs) / sizeof(descs[0]))
+
+struct client {
+    int    fd;
+    char   line[MAX_LINE];
+    size_t len;
+};
+
+static _Atomic(struct params_node *) current;
+static atomic_uint in_use;              // Version the control loop is using
+static struct params_node *retired;     // Update thread only
+
+static pthread_t params_thread;
+static int started;
+static int stop_fd = -1;
+static int inotify_fd = -1;
+static int listen_fd = -1;
+static struct client clients[PARAMS_MAX_CLIENTS];
+static char file_path_buf[256];
+static const char *file_name;           // Basename within file_path_buf's directory
+static char sock_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+//------------------------------------------------------------------------------
+// Control loop side
+
+const struct wiper_params *params_acquire(void)
+{
+    struct params_node *n = atomic_load(&current);
+    atomic_store(&in_use, n->p.version);
+    return &n->p;
+}
+
+void params_print(FILE *out)
+{
+    const struct wiper_params *p = &atomic_load(&current)->p;
+
+    fprintf(out, "version=%u\n", p->version);
+    for (size_t i = 0; i < NUM_PARAMS; i++) {
+        const void *v = (const char *)p + descs[i].offset;
+        if (descs[i].is_float)
+            fprintf(out, "%s=%g\n", descs[i].name, *(const float *)v);
+        else
+            fprintf(out, "%s=%u\n", descs[i].name, *(const uint32_t *)v);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Update side
+
+static void reclaim(void)
+{
+    unsigned int used = atomic_load(&in_use);
+    struct params_node **pp = &retired;
+
+    while (*pp) {
+        struct params_node *n = *pp;
+        if (n->p.version < used) {
+            *pp = n->next;
+            free(n);
+        } else {
+            pp = &n->next;
+        }
+    }
+}
+
+static int set_one(struct wiper_params *p, char *assign, char *err, size_t errlen)
+{
+    char *value = strchr(assign, '=');
+    char *end;
+    double v;
+
+    if (!value) {
+        snprintf(err, errlen, "expected key=value, got \"%s\"", assign);
+        return -1;
+    }
+    *value++ = '\0';
+    for (size_t i = 0; i < NUM_PARAMS; i++) {
+        const struct param_desc *d = &descs[i];
+        if (strcmp(assign, d->name) != 0)
+            continue;
+        errno = 0;
+        v = strtod(value, &end);
+        if (errno || end == value || *end != '\0') {
+            snprintf(err, errlen, "%s: \"%s\" is not a number", d->name, value);
+            return -1;
+        }
+        if (v < d->min || v > d->max || (!d->is_float && v != (uint32_t)v)) {
+            snprintf(err, errlen, "%s: %s out of range [%g, %g]%s", d->name, value,
+                     d->min, d->max, d->is_float ? "" : " or not an integer");
+            return -1;
+        }
+        if (d->is_float)
+            *(float *)((char *)p + d->offset) = (float)v;
+        else
+            *(uint32_t *)((char *)p + d->offset) = (uint32_t)v;
+        return 0;
+    }
+    snprintf(err, errlen, "unknown parameter \"%s\"", assign);
+    return -1;
+}
+
+/**
+ * @brief Apply whitespace separated key=value assignments as one update.
+ *
+ * @param text   Assignments, modified in place. '#' comments run to the
+ *               end of the line.
+ * @param source Name of the update source for the log.
+ * @param err    Reason on failure.
+ * @param errlen Size of err.
+ * @return New version, the unchanged version if nothing changed, or -1.
+ */
+static long apply(char *text, const char *source, char *err, size_t errlen)
+{
+    struct params_node *cur = atomic_load(&current);
+    struct params_node *n = malloc(sizeof(*n));
+    char *line, *tok, *save_line, *save_tok;
+
+    if (!n) {
+        snprintf(err, errlen, "out of memory");
+        return -1;
+    }
+    n->p = cur->p;
+    n->next = NULL;
+    for (line = strtok_r(text, "\n", &save_line); line;
+         line = strtok_r(NULL, "\n", &save_line)) {
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        for (tok = strtok_r(line, " \t\r", &save_tok); tok;
+             tok = strtok_r(NULL, " \t\r", &save_tok)) {
+            if (set_one(&n->p, tok, err, errlen) != 0) {
+                free(n);
+                return -1;
+            }
+        }
+    }
+
+    if (memcmp(&n->p, &cur->p, sizeof(n->p)) == 0) {
+        free(n);
+        return cur->p.version;
+    }
+    n->p.version = cur->p.version + 1;
+    atomic_store(&current, n);
+    cur->next = retired;
+    retired = cur;
+
+    printf("params: version %u from %s:", n->p.version, source);
+    for (size_t i = 0; i < NUM_PARAMS; i++) {
+        const char *a = (const char *)&cur->p + descs[i].offset;
+        const char *b = (const char *)&n->p + descs[i].offset;
+        if (memcmp(a, b, sizeof(uint32_t)) == 0)
+            continue;
+        if (descs[i].is_float)
+            printf(" %s=%g", descs[i].name, *(const float *)b);
+        else
+            printf(" %s=%u", descs[i].name, *(const uint32_t *)b);
+    }
+    printf("\n");
+    return n->p.version;
+}
+
+static void load_file(void)
+{
+    char buf[MAX_FILE_SIZE + 1];
+    char err[128];
+    ssize_t n;
+    int fd = open(file_path_buf, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        if (errno != ENOENT)
+            perror(file_path_buf);
+        return;
+    }
+    n = read(fd, buf, MAX_FILE_SIZE);
+    close(fd);
+    if (n < 0) {
+        perror(file_path_buf);
+        return;
+    }
+    buf[n] = '\0';
+    if (apply(buf, file_path_buf, err, sizeof(err)) < 0)
+        fprintf(stderr, "params: %s rejected: %s\n", file_path_buf, err);
+}
+
+static void handle_inotify(void)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len = read(inotify_fd, buf, sizeof(buf));
+    int changed = 0;
+
+    for (char *ptr = buf; len > 0 && ptr < buf + len; ) {
+        const struct inotify_event *ev = (const struct inotify_event *)ptr;
+        if (ev->len && strcmp(ev->name, file_name) == 0)
+            changed = 1;
+        ptr += sizeof(*ev) + ev->len;
+    }
+    if (changed)
+        load_file();
+}
+
+static void client_command(struct client *c, char *cmd)
+{
+    char reply[512];
+    char err[128];
+    int n = 0;
+
+    if (strcmp(cmd, "get") == 0) {
+        const struct wiper_params *p = &atomic_load(&current)->p;
+        n = snprintf(reply, sizeof(reply), "version=%u\n", p->version);
+        for (size_t i = 0; i < NUM_PARAMS && n < (int)sizeof(reply); i++) {
+            const void *v = (const char *)p + descs[i].offset;
+            if (descs[i].is_float)
+                n += snprintf(reply + n, sizeof(reply) - n, "%s=%g\n",
+                              descs[i].name, *(const float *)v);
+            else
+                n += snprintf(reply + n, sizeof(reply) - n, "%s=%u\n",
+                              descs[i].name, *(const uint32_t *)v);
+        }
+        if (n < (int)sizeof(reply))
+            n += snprintf(reply + n, sizeof(reply) - n, "\n");
+    } else if (strncmp(cmd, "set ", 4) == 0) {
+        long version = apply(cmd + 4, "socket", err, sizeof(err));
+        if (version < 0)
+            n = snprintf(reply, sizeof(reply), "error: %s\n", err);
+        else
+            n = snprintf(reply, sizeof(reply), "ok version=%ld\n", version);
+    } else {
+        n = snprintf(reply, sizeof(reply), "error: expected \"get\" or \"set key=value ...\"\n");
+    }
+    if (n > (int)sizeof(reply) - 1)
+        n = sizeof(reply) - 1;
+    if (send(c->fd, reply, n, MSG_NOSIGNAL | MSG_DONTWAIT) < 0 && errno != EAGAIN) {
+        close(c->fd);
+        c->fd = -1;
+    }
+}
+
+static void client_read(struct client *c)
+{
+    ssize_t n = recv(c->fd, c->line + c->len, sizeof(c->line) - 1 - c->len, MSG_DONTWAIT);
+    char *nl;
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        close(c->fd);
+        c->fd = -1;
+        return;
+    }
+    if (n < 0)
+        return;
+    c->len += n;
+    c->line[c->len] = '\0';
+
+    // Handle every complete line, keep the remainder
+    while (c->fd >= 0 && (nl = strchr(c->line, '\n'))) {
+        *nl = '\0';
+        if (nl > c->line && nl[-1] == '\r')
+            nl[-1] = '\0';
+        client_command(c, c->line);
+        c->len -= nl + 1 - c->line;
+        memmove(c->line, nl + 1, c->len + 1);
+    }
+    if (c->fd >= 0 && c->len == sizeof(c->line) - 1) {
+        close(c->fd);    // Line too long
+        c->fd = -1;
+    }
+}
+
+static void *params_main(void *arg)
+{
+    (void)arg;
+    struct pollfd pfds[PARAMS_MAX_CLIENTS + 3];
+    int pidx[PARAMS_MAX_CLIENTS];
+
+    for (;;) {
+        int nfds = 0;
+
+        pfds[nfds++] = (struct pollfd){ .fd = stop_fd, .events = POLLIN };
+        pfds[nfds++] = (struct pollfd){ .fd = inotify_fd, .events = POLLIN };
+        pfds[nfds++] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        for (int i = 0; i < PARAMS_MAX_CLIENTS; i++) {
+            pidx[i] = -1;
+            if (clients[i].fd < 0)
+                continue;
+            pidx[i] = nfds;
+            pfds[nfds++] = (struct pollfd){ .fd = clients[i].fd, .events = POLLIN };
+        }
+
+        if (poll(pfds, nfds, retired ? RECLAIM_POLL_MS : -1) < 0 && errno != EINTR) {
+            perror("params: poll");
+            break;
+        }
+        if (pfds[0].revents)
+            break;
+        if (pfds[1].revents & POLLIN)
+            handle_inotify();
+        if (pfds[2].revents & POLLIN) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < PARAMS_MAX_CLIENTS; i++) {
+                if (clients[i].fd < 0) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot >= 0) {
+                clients[slot].fd = fd;
+                clients[slot].len = 0;
+            } else if (fd >= 0) {
+                close(fd);    // Too many clients
+            }
+        }
+        for (int i = 0; i < PARAMS_MAX_CLIENTS; i++) {
+            if (pidx[i] >= 0 && pfds[pidx[i]].revents)
+                client_read(&clients[i]);
+        }
+        reclaim();
+    }
+    return NULL;
+}
+
+static int open_socket(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, PARAMS_MAX_CLIENTS) < 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    strcpy(sock_path, path);
+    return 0;
+}
+
+static int watch_file(const char *path)
+{
+    char dir[sizeof(file_path_buf)];
+
+    if (strlen(path) >= sizeof(file_path_buf)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(file_path_buf, path);
+    strcpy(dir, path);
+    file_name = strrchr(file_path_buf, '/') ? strrchr(file_path_buf, '/') + 1 : file_path_buf;
+
+    // Watch the directory so editors that replace the file are seen too
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+        return -1;
+    if (inotify_add_watch(inotify_fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int params_start(const struct wiper_params *defaults, const char *file_path,
+                 const char *socket_path)
+{
+    struct params_node *n = malloc(sizeof(*n));
+    pthread_attr_t attr;
+    struct sched_param sp = { .sched_priority = 0 };
+    cpu_set_t cpus;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int ret;
+
+    if (!n)
+        return -1;
+    n->p = *defaults;
+    n->p.version = 1;
+    n->next = NULL;
+    atomic_store(&current, n);
+    atomic_store(&in_use, 1);
+    for (int i = 0; i < PARAMS_MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0)
+        goto fail;
+    if (file_path) {
+        // Tuning by file is optional, carry on without the watch
+        if (watch_file(file_path) != 0)
+            perror("params: inotify");
+        load_file();
+    }
+    if (socket_path && open_socket(socket_path) != 0) {
+        perror("params: socket");
+        goto fail;
+    }
+
+    // Best effort: normal priority, and off the control core if possible
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    pthread_attr_setschedparam(&attr, &sp);
+    if (ncpu > 1) {
+        CPU_ZERO(&cpus);
+        for (long i = 1; i < ncpu && i < CPU_SETSIZE; i++)
+            CPU_SET(i, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    ret = pthread_create(&params_thread, &attr, params_main, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret) {
+        errno = ret;
+        goto fail;
+    }
+    started = 1;
+    return 0;
+
+fail:
+    ret = errno;
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(sock_path);
+    }
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+    if (stop_fd >= 0)
+        close(stop_fd);
+    listen_fd = inotify_fd = stop_fd = -1;
+    free(atomic_exchange(&current, NULL));
+    errno = ret;
+    return -1;
+}
+
+void params_stop(void)
+{
+    uint64_t one = 1;
+    struct params_node *n;
+
+    if (!started)
+        return;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one))
+        perror("params: stop");
+    pthread_join(params_thread, NULL);
+    started = 0;
+
+    for (int i = 0; i < PARAMS_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0)
+            close(clients[i].fd);
+        clients[i].fd = -1;
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(sock_path);
+    }
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+    close(stop_fd);
+    listen_fd = inotify_fd = stop_fd = -1;
+
+    while ((n = retired)) {
+        retired = n->next;
+        free(n);
+    }
+    free(atomic_exchange(&current, NULL));
+}
@@ -0,0 +1,94 @@
+/**
+ * @file params.h
+ * @brief Runtime tunable parameters for the control loop.
+ * @details
+ * Holds the tuning values that used to be compile time constants. The
+ * control loop takes a snapshot with params_acquire() at the top of each
+ * iteration and uses it until the next iteration, so every change is
+ * applied as a whole at a loop boundary. Snapshots are immutable;
+ * updates build a new copy and swap the shared pointer, and the old copy
+ * is freed once the loop has moved past it (epoch based reclamation).
+ * The hot path is a pair of atomic operations, no locks.
+ *
+ * Updates arrive from a background thread, either as commands on a local
+ * control socket or by editing a parameter file watched with inotify.
+ * Each update is validated as a whole and rejected if any value is out
+ * of range; accepted updates bump the version number.
+ *
+ * Control socket (SOCK_STREAM, one command per line):
+ *  - "get" replies with "version=N" and one "key=value" line per
+ *    parameter, followed by an empty line.
+ *  - "set key=value [key=value ...]" replies "ok version=N" or
+ *    "error: <reason>".
+ *
+ * Parameter file: "key=value" lines, '#' starts a comment. The file is
+ * applied on top of the current values when it is written or replaced.
+ */
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef PARAMS_SOCKET_PATH
+#define PARAMS_SOCKET_PATH "/tmp/whiteboard_wiper.ctl"
+#endif // PARAMS_SOCKET_PATH
+
+#ifndef PARAMS_FILE_PATH
+#define PARAMS_FILE_PATH "/etc/whiteboard_wiper.conf"
+#endif // PARAMS_FILE_PATH
+
+#define PARAMS_MAX_CLIENTS 2
+
+/**
+ * @brief One immutable set of parameters.
+ */
+struct wiper_params {
+    uint32_t version;             ///< Bumped on every accepted update
+    float    wall_range_m;        ///< Allowed deviation from the wall distance
+    uint32_t reverse_time_us;     ///< Reverse time at an edge
+    uint32_t turnaround_time_us;  ///< Turn time at an edge
+    float    covered_range_m;     ///< Closer than this the sensor is covered
+    uint32_t idle_samples;        ///< Consecutive samples to enter/leave idle
+    float    filter_alpha;        ///< Weight of a new sample in the filtered range
+};
+
+/**
+ * @brief Load the parameter file and start the update thread.
+ *
+ * @param defaults    Initial values, the version field is ignored.
+ * @param file_path   Parameter file to load and watch, or NULL for none.
+ *                    A missing file is not an error, it is picked up
+ *                    when it is created.
+ * @param socket_path Control socket path, or NULL for none.
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int params_start(const struct wiper_params *defaults, const char *file_path,
+                 const char *socket_path);
+
+/**
+ * @brief Get the current parameters.
+ *
+ * Control loop only. The returned snapshot stays valid until the next
+ * params_acquire() call, which also marks the previous one as released.
+ *
+ * @return The current parameters, never NULL after params_start().
+ */
+const struct wiper_params *params_acquire(void);
+
+/**
+ * @brief Print the current parameters as key=value lines.
+ *
+ * @param out Output stream.
+ */
+void params_print(FILE *out);
+
+/**
+ * @brief Stop the update thread and free all snapshots.
+ *
+ * The control loop must no longer use its snapshot.
+ */
+void params_stop(void);
+
+#endif // PARAMS_H
@@ -0,0 +1,152 @@
+/**
+ * @file power.c
+ * @brief Software energy accounting implementation.
+ * @details
+ * Counters are plain C11 atomics so the control loop, the ranging thread
+ * and any reporting thread can update and read them without locking.
+ * On-times are tracked as "on since" timestamps: 0 means off, anything
+ * else is the CLOCK_MONOTONIC time in microseconds at which the
+ * subsystem was switched on.
+ */
+
+#include "power.h"
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static uint64_t start_us;
+
+static atomic_uint_fast64_t motor_on_since;
+static atomic_uint_fast64_t motor_on_total;
+static atomic_uint_fast64_t idle_since;
+static atomic_uint_fast64_t idle_total;
+static atomic_uint_fast64_t sensor_pings;
+
+static const char *subsystem_names[POWER_NUM_SUBSYSTEMS] = {
+    "motor", "sensor", "cpu", "board"
+};
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    // Never return 0, it is used as the "off" marker
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 + 1;
+}
+
+// Switch an on-time tracker on or off and accumulate the elapsed time
+static void track_set(atomic_uint_fast64_t *since, atomic_uint_fast64_t *total, int on)
+{
+    if (on) {
+        uint_fast64_t off = 0;
+        atomic_compare_exchange_strong(since, &off, now_us());
+    } else {
+        uint64_t t0 = atomic_exchange(since, 0);
+        if (t0)
+            atomic_fetch_add(total, now_us() - t0);
+    }
+}
+
+// Accumulated on-time including a still running interval
+static uint64_t track_read(atomic_uint_fast64_t *since, atomic_uint_fast64_t *total, uint64_t now)
+{
+    uint64_t t0 = atomic_load(since);
+    uint64_t t = atomic_load(total);
+    if (t0 && now > t0)
+        t += now - t0;
+    return t;
+}
+
+int power_init(void)
+{
+    start_us = now_us();
+    atomic_store(&motor_on_since, 0);
+    atomic_store(&motor_on_total, 0);
+    atomic_store(&idle_since, 0);
+    atomic_store(&idle_total, 0);
+    atomic_store(&sensor_pings, 0);
+    return 0;
+}
+
+void power_motor_set(int on)
+{
+    track_set(&motor_on_since, &motor_on_total, on);
+}
+
+void power_sensor_ping(void)
+{
+    atomic_fetch_add_explicit(&sensor_pings, 1, memory_order_relaxed);
+}
+
+void power_idle_set(int idle)
+{
+    track_set(&idle_since, &idle_total, idle);
+}
+
+void power_get_report(struct power_report *report)
+{
+    struct rusage ru;
+    uint64_t now = now_us();
+
+    report->uptime_us = now - start_us;
+    report->motor_on_us = track_read(&motor_on_since, &motor_on_total, now);
+    report->idle_us = track_read(&idle_since, &idle_total, now);
+    report->sensor_pings = atomic_load(&sensor_pings);
+    report->cpu_busy_us = 0;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        report->cpu_busy_us =
+            (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+            (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+    }
+
+    report->joules[POWER_MOTOR] = POWER_MOTOR_W * report->motor_on_us / 1e6;
+    report->joules[POWER_SENSOR] = POWER_SENSOR_PING_J * report->sensor_pings;
+    report->joules[POWER_CPU] = POWER_CPU_BUSY_W * report->cpu_busy_us / 1e6;
+    report->joules[POWER_BOARD] = POWER_BOARD_IDLE_W * report->uptime_us / 1e6;
+
+    report->total_j = 0.0;
+    for (int i = 0; i < POWER_NUM_SUBSYSTEMS; i++)
+        report->total_j += report->joules[i];
+}
+
+void power_print_report(FILE *out)
+{
+    struct power_report r;
+    power_get_report(&r);
+
+    fprintf(out, "Energy report after %.1f s (%.1f s idle):\n",
+            r.uptime_us / 1e6, r.idle_us / 1e6);
+    for (int i = 0; i < POWER_NUM_SUBSYSTEMS; i++)
+        fprintf(out, "  %-6s %8.1f J\n", subsystem_names[i], r.joules[i]);
+    fprintf(out, "  total  %8.1f J (%.2f mWh)\n", r.total_j, r.total_j / 3.6);
+}
+
+int power_export(const char *path)
+{
+    struct power_report r;
+    char tmp_path[256];
+    FILE *fp;
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fp = fopen(tmp_path, "w");
+    if (!fp)
+        return -1;
+
+    power_get_report(&r);
+    fprintf(fp, "uptime_us=%llu\n", (unsigned long long)r.uptime_us);
+    fprintf(fp, "idle_us=%llu\n", (unsigned long long)r.idle_us);
+    fprintf(fp, "motor_on_us=%llu\n", (unsigned long long)r.motor_on_us);
+    fprintf(fp, "sensor_pings=%llu\n", (unsigned long long)r.sensor_pings);
+    fprintf(fp, "cpu_busy_us=%llu\n", (unsigned long long)r.cpu_busy_us);
+    for (int i = 0; i < POWER_NUM_SUBSYSTEMS; i++)
+        fprintf(fp, "%s_j=%.3f\n", subsystem_names[i], r.joules[i]);
+    fprintf(fp, "total_j=%.3f\n", r.total_j);
+
+    if (fclose(fp) != 0)
+        return -1;
+    return rename(tmp_path, path);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file power.h
+ * @brief Software energy accounting for the whiteboard wiper.
+ * @details
+ * Keeps a running estimate of the energy drawn from the battery by each
+ * subsystem (motors, HC-SR04 sensor, CPU). The estimate is built from
+ * motor on-time, the number of sensor pings and the process CPU time
+ * reported by getrusage(), scaled by the nominal power figures below.
+ * The numbers are only as good as the constants, so tune them against a
+ * bench supply measurement of your build.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Nominal power figures (5 V rail)
+#define POWER_MOTOR_W         1.50   // Both gear motors running, no stall
+#define POWER_SENSOR_PING_J   0.0045 // 15 mA for one 60 ms ranging window
+#define POWER_CPU_BUSY_W      1.10   // Pi core at full load above idle
+#define POWER_BOARD_IDLE_W    1.40   // Board baseline with the core idle
+
+#ifndef POWER_REPORT_PATH
+#define POWER_REPORT_PATH "/tmp/whiteboard_wiper.power"
+#endif // POWER_REPORT_PATH
+
+enum power_subsystem {
+    POWER_MOTOR = 0,
+    POWER_SENSOR,
+    POWER_CPU,
+    POWER_BOARD,
+    POWER_NUM_SUBSYSTEMS
+};
+
+/**
+ * @brief Snapshot of the energy estimate.
+ */
+struct power_report {
+    double   joules[POWER_NUM_SUBSYSTEMS]; ///< Energy per subsystem
+    double   total_j;                      ///< Sum of all subsystems
+    uint64_t uptime_us;                    ///< Time since power_init()
+    uint64_t motor_on_us;                  ///< Accumulated motor on-time
+    uint64_t sensor_pings;                 ///< Number of sensor pings
+    uint64_t cpu_busy_us;                  ///< User + system CPU time
+    uint64_t idle_us;                      ///< Time spent in low-power idle
+};
+
+/**
+ * @brief Start energy accounting.
+ *
+ * Records the reference timestamps used by all later estimates.
+ *
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int power_init(void);
+
+/**
+ * @brief Record a motor state change.
+ *
+ * Called by the motor driver whenever the motors are started or stopped.
+ * Repeated calls with the same state are ignored.
+ *
+ * @param on Non-zero if the motors are now driven, zero if stopped.
+ */
+void power_motor_set(int on);
+
+/**
+ * @brief Record a single HC-SR04 ping.
+ */
+void power_sensor_ping(void);
+
+/**
+ * @brief Record entering or leaving low-power idle mode.
+ *
+ * @param idle Non-zero when entering idle, zero when leaving.
+ */
+void power_idle_set(int idle);
+
+/**
+ * @brief Compute the current energy estimate.
+ *
+ * @param[out] report Filled with the estimate at the time of the call.
+ */
+void power_get_report(struct power_report *report);
+
+/**
+ * @brief Print a human readable energy report.
+ *
+ * @param out Stream to print to (e.g., stdout).
+ */
+void power_print_report(FILE *out);
+
+/**
+ * @brief Export the energy report as key=value lines.
+ *
+ * The file is written to a temporary name and renamed into place so a
+ * reader never sees a partial report.
+ *
+ * @param path Destination file (e.g., POWER_REPORT_PATH).
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int power_export(const char *path);
+
+#endif // POWER_H
@@ -0,0 +1,201 @@
+/**
+ * @file ranging.c
+ * @brief Background HC-SR04 ranging thread implementation.
+ * @details
+ * One mutex protects the published sample and the thread controls. The
+ * thread sleeps on a condition variable between pings so period changes,
+ * pauses and shutdown take effect without waiting out the full period.
+ * All timed waits use CLOCK_MONOTONIC.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include "ranging.h"
+#include "hcsr04.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+static pthread_t ranging_thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sample_cond;   // Signalled when a sample is published
+static pthread_cond_t ctl_cond;      // Signalled when the controls change
+
+static int running;
+static int paused;
+static int ctl_changed;
+static unsigned int period;
+static uint32_t generation;          // Bumped on resume to drop stale pings
+static uint32_t consumed_seq;
+static struct ranging_sample latest;
+
+static void deadline_after_us(struct timespec *ts, uint64_t us)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += us / 1000000;
+    ts->tv_nsec += (us % 1000000) * 1000;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void *ranging_main(void *arg)
+{
+    (void)arg;
+    struct timespec deadline;
+    uint32_t echo_time_us;
+    float distance_m;
+
+    pthread_mutex_lock(&lock);
+    while (running) {
+        while (paused && running)
+            pthread_cond_wait(&ctl_cond, &lock);
+        if (!running)
+            break;
+
+        // Ping without holding the lock, it busy-waits on the echo line
+        uint32_t gen = generation;
+        pthread_mutex_unlock(&lock);
+        int ret = read_hcsr04(&echo_time_us, &distance_m);
+        pthread_mutex_lock(&lock);
+
+        if (gen == generation && !paused) {
+            latest.status = ret;
+            latest.echo_time_us = echo_time_us;
+            latest.distance_m = distance_m;
+            latest.seq++;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            latest.timestamp_us = (uint64_t)deadline.tv_sec * 1000000ULL +
+                                  deadline.tv_nsec / 1000;
+            pthread_cond_broadcast(&sample_cond);
+        }
+
+        // Sleep until the next ping unless the controls change
+        ctl_changed = 0;
+        deadline_after_us(&deadline, period);
+        while (running && !ctl_changed) {
+            if (pthread_cond_timedwait(&ctl_cond, &lock, &deadline) == ETIMEDOUT)
+                break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+static int init_cond(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    int ret = pthread_condattr_init(&attr);
+    if (ret)
+        return ret;
+    ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (!ret)
+        ret = pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return ret;
+}
+
+int ranging_start(unsigned int period_us)
+{
+    pthread_attr_t attr;
+    struct sched_param sp;
+    int ret;
+
+    if (init_cond(&sample_cond) || init_cond(&ctl_cond)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    running = 1;
+    paused = 0;
+    period = period_us;
+    consumed_seq = latest.seq;
+
+    // Try to run at real-time priority, fall back to the default policy
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    sp.sched_priority = RANGING_PRIORITY;
+    pthread_attr_setschedparam(&attr, &sp);
+    ret = pthread_create(&ranging_thread, &attr, ranging_main, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret == EPERM) {
+        fprintf(stderr, "ranging: no permission for SCHED_FIFO, using default policy\n");
+        ret = pthread_create(&ranging_thread, NULL, ranging_main, NULL);
+    }
+    if (ret) {
+        running = 0;
+        errno = ret;
+        return -1;
+    }
+    return 0;
+}
+
+void ranging_set_period(unsigned int period_us)
+{
+    pthread_mutex_lock(&lock);
+    if (period != period_us) {
+        period = period_us;
+        ctl_changed = 1;
+        pthread_cond_signal(&ctl_cond);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void ranging_pause(void)
+{
+    pthread_mutex_lock(&lock);
+    paused = 1;
+    ctl_changed = 1;
+    pthread_cond_signal(&ctl_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void ranging_resume(void)
+{
+    pthread_mutex_lock(&lock);
+    paused = 0;
+    generation++;
+    consumed_seq = latest.seq;
+    ctl_changed = 1;
+    pthread_cond_signal(&ctl_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+int ranging_wait(struct ranging_sample *sample, unsigned int timeout_ms)
+{
+    struct timespec deadline;
+    int ret = 0;
+
+    deadline_after_us(&deadline, (uint64_t)timeout_ms * 1000);
+    pthread_mutex_lock(&lock);
+    while (running && latest.seq == consumed_seq) {
+        if (pthread_cond_timedwait(&sample_cond, &lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    if (!running || latest.seq == consumed_seq) {
+        ret = -1;
+    } else {
+        *sample = latest;
+        consumed_seq = latest.seq;
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+void ranging_stop(void)
+{
+    pthread_mutex_lock(&lock);
+    if (!running) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    running = 0;
+    pthread_cond_broadcast(&ctl_cond);
+    pthread_cond_broadcast(&sample_cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(ranging_thread, NULL);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file ranging.h
+ * @brief Background HC-SR04 ranging thread.
+ * @details
+ * Moves the blocking HC-SR04 measurement out of the control loop. The
+ * ranging thread pings the sensor at a configurable period and publishes
+ * each sample; the control loop blocks in ranging_wait() until a new
+ * sample arrives instead of polling. The period can be raised while the
+ * robot is idle and the thread can be paused entirely during maneuvers,
+ * which both save sensor and CPU energy.
+ */
+
+#ifndef RANGING_H
+#define RANGING_H
+
+#include <stdint.h>
+
+#define RANGING_PRIORITY        80       // SCHED_FIFO priority of the thread
+#define RANGING_ACTIVE_PERIOD   100000   // Ping period while wiping (us)
+#define RANGING_IDLE_PERIOD     1000000  // Ping period while idle (us)
+
+/**
+ * @brief A single published ranging sample.
+ */
+struct ranging_sample {
+    int      status;       ///< Return value of read_hcsr04()
+    uint32_t echo_time_us; ///< Echo time after clamping
+    float    distance_m;   ///< Distance after clamping
+    uint32_t seq;          ///< Sample sequence number
+    uint64_t timestamp_us; ///< CLOCK_MONOTONIC time the sample was published
+};
+
+/**
+ * @brief Start the ranging thread.
+ *
+ * The sensor must already be initialised with init_hcsr04(). The thread
+ * runs at SCHED_FIFO RANGING_PRIORITY if permitted, otherwise it falls
+ * back to the default policy.
+ *
+ * @param period_us Initial ping period in microseconds.
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int ranging_start(unsigned int period_us);
+
+/**
+ * @brief Change the ping period.
+ *
+ * Takes effect after the current sleep, or immediately if the thread is
+ * waiting for its next ping.
+ *
+ * @param period_us New ping period in microseconds.
+ */
+void ranging_set_period(unsigned int period_us);
+
+/**
+ * @brief Stop pinging until ranging_resume() is called.
+ */
+void ranging_pause(void);
+
+/**
+ * @brief Resume pinging after ranging_pause().
+ *
+ * Samples that were in flight when ranging_resume() was called are
+ * discarded, so the next ranging_wait() only returns fresh data.
+ */
+void ranging_resume(void);
+
+/**
+ * @brief Block until a new sample is available.
+ *
+ * @param[out] sample     The newest sample not yet returned.
+ * @param      timeout_ms Maximum time to wait in milliseconds.
+ * @return 0 on success, -1 on timeout or after ranging_stop().
+ */
+int ranging_wait(struct ranging_sample *sample, unsigned int timeout_ms);
+
+/**
+ * @brief Stop and join the ranging thread.
+ */
+void ranging_stop(void);
+
+#endif // RANGING_H
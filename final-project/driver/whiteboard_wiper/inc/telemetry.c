@@ -0,0 +1,433 @@
+/**
+ * @file telemetry.c
+ * @brief Live telemetry server implementation.
+ * @details
+ * The double buffer works like a seqlock with two slots. The control loop
+ * writes slot (seq + 1) & 1 while readers copy slot seq & 1, then bumps
+ * seq. A reader only retries if seq moved during its copy, because the
+ * slot after the next publish is the one being read. At the loop rate
+ * that is rare, so the writer never waits and readers rarely spin.
+ *
+ * The release increment in telemetry_publish() only orders the writes
+ * before it. telemetry_back() adds a release fence after the last
+ * increment, so the writes to the next slot can't become visible before
+ * it. A reader that copied any of those writes then sees seq moved on
+ * its second load, after its acquire fence, and retries.
+ *
+ * The server thread runs at SCHED_OTHER and off the control core when
+ * there is more than one CPU. It multiplexes the listening socket, the
+ * clients, a stop eventfd and an export eventfd with poll(), using the
+ * earliest client deadline as the poll timeout. The export eventfd is
+ * non-blocking, so the control loop can request an export with one
+ * write() and leave the file I/O to this thread.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include "telemetry.h"
+#include "motor.h"
+#include "power.h"
+#include "watchdog.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(struct telemetry_frame) == 264,
+               "telemetry_frame layout changed, bump TELEMETRY_VERSION");
+
+static struct telemetry_state slots[2];
+static atomic_uint state_seq;
+static atomic_uint period_hist[TELEMETRY_HIST_BUCKETS];
+static atomic_uint latency_hist[TELEMETRY_HIST_BUCKETS];
+
+struct client {
+    int      fd;
+    int      json;          // JSON lines instead of binary frames
+    uint64_t period_us;     // 0 until the request line has been read
+    uint64_t next_us;
+    char     req[32];
+    size_t   req_len;
+};
+
+static pthread_t telemetry_thread;
+static int listen_fd = -1;
+static int stop_fd = -1;
+static int export_fd = -1;
+static struct client clients[TELEMETRY_MAX_CLIENTS];
+static char sock_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static unsigned int hist_bucket(uint32_t us)
+{
+    unsigned int b = us ? 31 - __builtin_clz(us) : 0;
+    return b < TELEMETRY_HIST_BUCKETS ? b : TELEMETRY_HIST_BUCKETS - 1;
+}
+
+//------------------------------------------------------------------------------
+// Control loop side
+
+struct telemetry_state *telemetry_back(void)
+{
+    unsigned int seq = atomic_load_explicit(&state_seq, memory_order_relaxed);
+
+    // Order the last publish before the writes to the slot readers may hold
+    atomic_thread_fence(memory_order_release);
+    return &slots[(seq + 1) & 1];
+}
+
+void telemetry_publish(void)
+{
+    atomic_fetch_add_explicit(&state_seq, 1, memory_order_release);
+}
+
+void telemetry_request_export(void)
+{
+    uint64_t one = 1;
+
+    if (export_fd >= 0 && write(export_fd, &one, sizeof(one)) != sizeof(one))
+        perror("telemetry: export request");
+}
+
+void telemetry_record_loop(uint32_t period_us, uint32_t latency_us)
+{
+    atomic_fetch_add_explicit(&period_hist[hist_bucket(period_us)], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&latency_hist[hist_bucket(latency_us)], 1,
+                              memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Server side
+
+static unsigned int read_state(struct telemetry_state *out)
+{
+    unsigned int s1, s2;
+
+    do {
+        s1 = atomic_load_explicit(&state_seq, memory_order_acquire);
+        memcpy(out, &slots[s1 & 1], sizeof(*out));
+        // Pairs with the fence in telemetry_back()
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&state_seq, memory_order_relaxed);
+    } while (s2 != s1);
+    return s1;
+}
+
+static void build_frame(struct telemetry_frame *f)
+{
+    struct telemetry_state st;
+    struct power_report pr;
+    struct watchdog_stats ws;
+
+    memset(f, 0, sizeof(*f));
+    f->magic = TELEMETRY_MAGIC;
+    f->version = TELEMETRY_VERSION;
+    f->size = sizeof(*f);
+
+    f->seq = read_state(&st);
+    f->timestamp_us = st.timestamp_us;
+    f->echo_time_us = st.echo_time_us;
+    f->range_m = st.range_m;
+    f->filtered_range_m = st.filtered_range_m;
+    f->wall_dist_m = st.wall_dist_m;
+    f->idle = st.idle;
+    f->passes = st.passes;
+    f->motor_state = motor_get_state();
+
+    power_get_report(&pr);
+    f->energy_j = (float)pr.total_j;
+    f->motor_on_us = pr.motor_on_us;
+    watchdog_get_stats(&ws);
+    f->missed_deadlines = ws.misses;
+    f->worst_overrun_us = ws.worst_overrun_us;
+
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        f->period_hist[i] = atomic_load_explicit(&period_hist[i], memory_order_relaxed);
+        f->latency_hist[i] = atomic_load_explicit(&latency_hist[i], memory_order_relaxed);
+    }
+}
+
+static int append_hist(char *buf, size_t len, int n, const char *name, const uint32_t *hist)
+{
+    n += snprintf(buf + n, len - n, ",\"%s\":[", name);
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS && n < (int)len; i++)
+        n += snprintf(buf + n, len - n, i ? ",%u" : "%u", hist[i]);
+    if (n < (int)len)
+        n += snprintf(buf + n, len - n, "]");
+    return n;
+}
+
+static int frame_to_json(const struct telemetry_frame *f, char *buf, size_t len)
+{
+    int n = snprintf(buf, len,
+        "{\"seq\":%u,\"timestamp_us\":%llu,\"echo_time_us\":%u,"
+        "\"range_m\":%.4f,\"filtered_range_m\":%.4f,\"wall_dist_m\":%.4f,"
+        "\"motor_state\":%u,\"idle\":%u,\"passes\":%u,\"energy_j\":%.2f,"
+        "\"motor_on_us\":%llu,\"missed_deadlines\":%llu,\"worst_overrun_us\":%llu",
+        f->seq, (unsigned long long)f->timestamp_us, f->echo_time_us,
+        f->range_m, f->filtered_range_m, f->wall_dist_m,
+        f->motor_state, f->idle, f->passes, f->energy_j,
+        (unsigned long long)f->motor_on_us,
+        (unsigned long long)f->missed_deadlines,
+        (unsigned long long)f->worst_overrun_us);
+    if (n < (int)len)
+        n = append_hist(buf, len, n, "period_hist", f->period_hist);
+    if (n < (int)len)
+        n = append_hist(buf, len, n, "latency_hist", f->latency_hist);
+    if (n < (int)len)
+        n += snprintf(buf + n, len - n, "}\n");
+    return n < (int)len ? n : -1;
+}
+
+static void client_close(struct client *c)
+{
+    close(c->fd);
+    c->fd = -1;
+}
+
+// Read the request line "<mode> <rate>\n"
+static void client_read(struct client *c, uint64_t now)
+{
+    char mode, discard[64];
+    unsigned int rate;
+    ssize_t n;
+
+    // Anything sent after the request is read and ignored
+    if (c->period_us)
+        n = recv(c->fd, discard, sizeof(discard), MSG_DONTWAIT);
+    else
+        n = recv(c->fd, c->req + c->req_len, sizeof(c->req) - 1 - c->req_len,
+                 MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        client_close(c);
+        return;
+    }
+    if (n < 0 || c->period_us)
+        return;
+
+    c->req_len += n;
+    c->req[c->req_len] = '\0';
+    if (!strchr(c->req, '\n')) {
+        if (c->req_len == sizeof(c->req) - 1)
+            client_close(c);
+        return;
+    }
+    if (sscanf(c->req, " %c %u", &mode, &rate) != 2 ||
+        (mode != 'b' && mode != 'j') || rate == 0 || rate > TELEMETRY_MAX_RATE) {
+        static const char err[] = "error: expected \"<b|j> <rate 1-1000>\"\n";
+        send(c->fd, err, sizeof(err) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+        client_close(c);
+        return;
+    }
+    c->json = (mode == 'j');
+    c->period_us = 1000000 / rate;
+    c->next_us = now;
+}
+
+static void client_send(struct client *c, const struct telemetry_frame *f,
+                        const char *json, int json_len)
+{
+    const void *data = c->json ? (const void *)json : (const void *)f;
+    size_t len = c->json ? (size_t)json_len : sizeof(*f);
+
+    if (c->json && json_len < 0)
+        return;
+    // SOCK_SEQPACKET sends whole frames or nothing; a frame that doesn't
+    // fit is dropped, a slow client must not stall us
+    if (send(c->fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT) < 0 && errno != EAGAIN)
+        client_close(c);
+}
+
+// Write the power report and loop metrics files
+static void export_reports(void)
+{
+    uint64_t count;
+
+    if (read(export_fd, &count, sizeof(count)) != sizeof(count))
+        return;
+    if (power_export(POWER_REPORT_PATH) != 0)
+        perror("telemetry: power_export");
+    if (watchdog_export(WATCHDOG_STATS_PATH) != 0)
+        perror("telemetry: watchdog_export");
+}
+
+static void *telemetry_main(void *arg)
+{
+    (void)arg;
+    struct pollfd pfds[TELEMETRY_MAX_CLIENTS + 3];
+    int pidx[TELEMETRY_MAX_CLIENTS];
+    struct telemetry_frame frame;
+    char json[1024];
+
+    for (;;) {
+        uint64_t now = now_us();
+        int timeout = -1;
+        int nfds = 3;
+
+        pfds[0] = (struct pollfd){ .fd = stop_fd, .events = POLLIN };
+        pfds[1] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        pfds[2] = (struct pollfd){ .fd = export_fd, .events = POLLIN };
+        for (int i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+            struct client *c = &clients[i];
+            pidx[i] = -1;
+            if (c->fd < 0)
+                continue;
+            pidx[i] = nfds;
+            pfds[nfds++] = (struct pollfd){ .fd = c->fd, .events = POLLIN };
+            if (c->period_us) {
+                int wait_ms = c->next_us > now ? (int)((c->next_us - now + 999) / 1000) : 0;
+                if (timeout < 0 || wait_ms < timeout)
+                    timeout = wait_ms;
+            }
+        }
+
+        if (poll(pfds, nfds, timeout) < 0 && errno != EINTR) {
+            perror("telemetry: poll");
+            break;
+        }
+        if (pfds[0].revents)
+            break;
+
+        if (pfds[2].revents & POLLIN)
+            export_reports();
+
+        now = now_us();
+        if (pfds[1].revents & POLLIN) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < TELEMETRY_MAX_CLIENTS; i++) {
+                if (clients[i].fd < 0) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot >= 0) {
+                memset(&clients[slot], 0, sizeof(clients[slot]));
+                clients[slot].fd = fd;
+            } else if (fd >= 0) {
+                close(fd);    // Too many clients
+            }
+        }
+
+        // Build the frame at most once per wakeup and share it
+        int built = 0;
+        int json_len = -1;
+        for (int i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+            struct client *c = &clients[i];
+            if (c->fd < 0)
+                continue;
+            if (pidx[i] >= 0 && pfds[pidx[i]].revents)
+                client_read(c, now);
+            if (c->fd < 0 || !c->period_us || c->next_us > now)
+                continue;
+            if (!built) {
+                build_frame(&frame);
+                built = 1;
+            }
+            if (c->json && json_len < 0)
+                json_len = frame_to_json(&frame, json, sizeof(json));
+            client_send(c, &frame, json, json_len);
+            c->next_us += c->period_us;
+            if (c->next_us < now)
+                c->next_us = now + c->period_us;    // Fell behind, skip ahead
+        }
+    }
+    return NULL;
+}
+
+int telemetry_start(const char *socket_path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    pthread_attr_t attr;
+    struct sched_param sp = { .sched_priority = 0 };
+    cpu_set_t cpus;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int ret;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    strcpy(sock_path, socket_path);
+    for (int i = 0; i < TELEMETRY_MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0)
+        return -1;
+    export_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (export_fd < 0)
+        goto fail;
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        goto fail;
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, TELEMETRY_MAX_CLIENTS) < 0)
+        goto fail;
+
+    // Best effort: normal priority, and off the control core if possible
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    pthread_attr_setschedparam(&attr, &sp);
+    if (ncpu > 1) {
+        CPU_ZERO(&cpus);
+        for (long i = 1; i < ncpu && i < CPU_SETSIZE; i++)
+            CPU_SET(i, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    ret = pthread_create(&telemetry_thread, &attr, telemetry_main, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret) {
+        errno = ret;
+        goto fail;
+    }
+    return 0;
+
+fail:
+    if (listen_fd >= 0)
+        close(listen_fd);
+    if (export_fd >= 0)
+        close(export_fd);
+    close(stop_fd);
+    listen_fd = stop_fd = export_fd = -1;
+    return -1;
+}
+
+void telemetry_stop(void)
+{
+    uint64_t one = 1;
+
+    if (stop_fd < 0)
+        return;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one))
+        perror("telemetry: stop");
+    pthread_join(telemetry_thread, NULL);
+    for (int i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0)
+            client_close(&clients[i]);
+    }
+    close(listen_fd);
+    close(export_fd);
+    close(stop_fd);
+    listen_fd = stop_fd = export_fd = -1;
+    unlink(sock_path);
+}
@@ -0,0 +1,126 @@
+/**
+ * @file telemetry.h
+ * @brief Live telemetry server for the whiteboard wiper.
+ * @details
+ * A low priority thread serves the robot state over a UNIX domain
+ * SOCK_SEQPACKET socket, one frame per message. The control loop
+ * publishes its state through a double buffer: it fills the back buffer
+ * in place and flips an atomic index, so it never takes a lock or copies
+ * a snapshot. Loop timing is recorded into histograms of atomic
+ * counters. Everything else (motor state, energy, watchdog metrics) is
+ * read by the telemetry thread from its owner. The same thread writes the
+ * power report and loop metrics files when the loop asks for it, so the
+ * loop never does file I/O.
+ *
+ * Protocol: after connecting, the client sends one request line
+ * "<mode> <rate>\n", where mode is 'b' for binary frames or 'j' for
+ * JSON lines and rate is the frame rate in Hz (1 to TELEMETRY_MAX_RATE).
+ * The server then streams frames at that rate until the client closes
+ * the connection. Frames are dropped, not queued, if the client falls
+ * behind. Binary frames are struct telemetry_frame in host byte order.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+#ifndef TELEMETRY_SOCKET_PATH
+#define TELEMETRY_SOCKET_PATH "/tmp/whiteboard_wiper.sock"
+#endif // TELEMETRY_SOCKET_PATH
+
+#define TELEMETRY_MAGIC        0x45504957  // "WIPE"
+#define TELEMETRY_VERSION      1
+#define TELEMETRY_MAX_RATE     1000        // Max frame rate per client (Hz)
+#define TELEMETRY_MAX_CLIENTS  4
+#define TELEMETRY_HIST_BUCKETS 24          // Bucket i counts [2^i, 2^(i+1)) us
+
+/**
+ * @brief Control loop state, written by the control loop only.
+ */
+struct telemetry_state {
+    uint64_t timestamp_us;      ///< CLOCK_MONOTONIC time of the sample
+    uint32_t echo_time_us;      ///< Latest echo time
+    float    range_m;           ///< Latest distance
+    float    filtered_range_m;  ///< Low-pass filtered distance
+    float    wall_dist_m;       ///< Calibrated wall distance
+    uint32_t passes;            ///< Completed passes across the board
+    uint8_t  idle;              ///< Non-zero in low-power idle
+};
+
+/**
+ * @brief Binary frame sent to clients.
+ *
+ * All fields are naturally aligned so the layout has no padding.
+ */
+struct telemetry_frame {
+    uint32_t magic;                                ///< TELEMETRY_MAGIC
+    uint16_t version;                              ///< TELEMETRY_VERSION
+    uint16_t size;                                 ///< sizeof(struct telemetry_frame)
+    uint64_t timestamp_us;
+    uint32_t seq;                                  ///< Control loop publish count
+    uint32_t echo_time_us;
+    float    range_m;
+    float    filtered_range_m;
+    float    wall_dist_m;
+    uint8_t  motor_state;                          ///< enum motor_state
+    uint8_t  idle;
+    uint16_t reserved;
+    uint32_t passes;
+    float    energy_j;                             ///< Total energy estimate
+    uint64_t motor_on_us;
+    uint64_t missed_deadlines;
+    uint64_t worst_overrun_us;
+    uint32_t period_hist[TELEMETRY_HIST_BUCKETS];  ///< Loop period
+    uint32_t latency_hist[TELEMETRY_HIST_BUCKETS]; ///< Sample to loop wakeup
+};
+
+/**
+ * @brief Start the telemetry thread.
+ *
+ * @param socket_path Path of the UNIX socket (e.g., TELEMETRY_SOCKET_PATH).
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int telemetry_start(const char *socket_path);
+
+/**
+ * @brief Get the back buffer for the next publish.
+ *
+ * Control loop only. Every field must be written before
+ * telemetry_publish(), the buffer holds stale data.
+ *
+ * @return Pointer to the back buffer.
+ */
+struct telemetry_state *telemetry_back(void);
+
+/**
+ * @brief Publish the back buffer filled since telemetry_back().
+ */
+void telemetry_publish(void);
+
+/**
+ * @brief Ask the telemetry thread to export the power report and loop metrics.
+ *
+ * Safe to call from the control loop: it only signals the thread, which
+ * writes POWER_REPORT_PATH and WATCHDOG_STATS_PATH at normal priority.
+ * Does nothing if the telemetry thread is not running.
+ */
+void telemetry_request_export(void);
+
+/**
+ * @brief Record one control loop iteration in the timing histograms.
+ *
+ * Lock-free, safe to call from the control loop.
+ *
+ * @param period_us  Time since the previous iteration.
+ * @param latency_us Time from the sample being published to the loop
+ *                   handling it.
+ */
+void telemetry_record_loop(uint32_t period_us, uint32_t latency_us);
+
+/**
+ * @brief Stop the telemetry thread and remove the socket.
+ */
+void telemetry_stop(void);
+
+#endif // TELEMETRY_H
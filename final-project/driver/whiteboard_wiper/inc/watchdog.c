@@ -0,0 +1,279 @@
+/**
+ * @file watchdog.c
+ * @brief Deadline monitor implementation.
+ * @details
+ * Heartbeat state is protected by a priority inheritance mutex so the
+ * watchdog thread never waits behind a preempted lower priority holder.
+ * The critical sections only touch a few integers; motor_stop() is the
+ * one slow call made while holding the lock, so a kick cannot restart
+ * the motors halfway through a trip. The mutex is set up on first use,
+ * so the stats can be read and exported before watchdog_start() or
+ * after it failed.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include "watchdog.h"
+#include "motor.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static pthread_t watchdog_thread;
+static pthread_mutex_t lock;
+static pthread_once_t lock_once = PTHREAD_ONCE_INIT;
+static atomic_int running;
+static int timer_fd = -1;
+static int hw_fd = -1;
+
+static unsigned int period;
+static uint64_t deadline_us;
+static int tripped;                 // Motors stopped by the watchdog
+static int missed;                  // Current deadline already counted
+static struct watchdog_stats stats;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void lock_init(void)
+{
+    pthread_mutexattr_t mattr;
+
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&lock, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+}
+
+static void lock_acquire(void)
+{
+    pthread_once(&lock_once, lock_init);
+    pthread_mutex_lock(&lock);
+}
+
+static void hw_open(void)
+{
+#ifdef WATCHDOG_DEV
+    hw_fd = open(WATCHDOG_DEV, O_WRONLY | O_CLOEXEC);
+    if (hw_fd < 0)
+        perror("watchdog: open " WATCHDOG_DEV);
+#endif // WATCHDOG_DEV
+}
+
+static void hw_feed(void)
+{
+    if (hw_fd >= 0 && write(hw_fd, "\0", 1) != 1)
+        perror("watchdog: feed");
+}
+
+static void hw_close(void)
+{
+    if (hw_fd < 0)
+        return;
+    // Magic close: disarm the hardware watchdog on a clean exit
+    if (write(hw_fd, "V", 1) != 1)
+        perror("watchdog: magic close");
+    close(hw_fd);
+    hw_fd = -1;
+}
+
+static void *watchdog_main(void *arg)
+{
+    (void)arg;
+    uint64_t expirations;
+    uint64_t last_feed = 0;
+
+    while (atomic_load(&running)) {
+        if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("watchdog: timerfd read");
+            break;
+        }
+
+        uint64_t now = now_us();
+        int healthy;
+
+        lock_acquire();
+        if (now > deadline_us && !tripped) {
+            // The control loop is late: fail safe
+            motor_stop();
+            tripped = 1;
+            stats.trips++;
+            if (!missed) {
+                missed = 1;
+                stats.misses++;
+            }
+            fprintf(stderr, "watchdog: control loop missed its deadline, "
+                    "motors stopped (%llu us late)\n",
+                    (unsigned long long)(now - deadline_us));
+        }
+        healthy = !tripped;
+        pthread_mutex_unlock(&lock);
+
+        // Only feed the hardware while the loop is keeping up
+        if (healthy && now - last_feed >= WATCHDOG_FEED_PERIOD) {
+            hw_feed();
+            last_feed = now;
+        }
+    }
+    return NULL;
+}
+
+int watchdog_start(unsigned int period_us)
+{
+    pthread_attr_t attr;
+    struct sched_param sp;
+    struct itimerspec its = {
+        .it_interval = { 0, WATCHDOG_CHECK_PERIOD * 1000L },
+        .it_value    = { 0, WATCHDOG_CHECK_PERIOD * 1000L },
+    };
+    int ret;
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0)
+        return -1;
+    if (timerfd_settime(timer_fd, 0, &its, NULL) < 0)
+        goto fail_timer;
+
+    lock_acquire();
+    period = period_us;
+    deadline_us = now_us() + period_us + WATCHDOG_SLACK;
+    tripped = 0;
+    missed = 0;
+    pthread_mutex_unlock(&lock);
+    hw_open();
+    atomic_store(&running, 1);
+
+    // Run above the control loop, fall back to the default policy
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    sp.sched_priority = WATCHDOG_PRIORITY;
+    pthread_attr_setschedparam(&attr, &sp);
+    ret = pthread_create(&watchdog_thread, &attr, watchdog_main, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret == EPERM) {
+        fprintf(stderr, "watchdog: no permission for SCHED_FIFO, using default policy\n");
+        ret = pthread_create(&watchdog_thread, NULL, watchdog_main, NULL);
+    }
+    if (ret) {
+        atomic_store(&running, 0);
+        hw_close();
+        errno = ret;
+        goto fail_timer;
+    }
+    return 0;
+
+fail_timer:
+    close(timer_fd);
+    timer_fd = -1;
+    return -1;
+}
+
+void watchdog_set_period(unsigned int period_us)
+{
+    lock_acquire();
+    period = period_us;
+    pthread_mutex_unlock(&lock);
+}
+
+int watchdog_kick(void)
+{
+    uint64_t now = now_us();
+    int was_tripped;
+
+    lock_acquire();
+    stats.kicks++;
+    if (now > deadline_us) {
+        uint64_t overrun = now - deadline_us;
+        if (!missed)
+            stats.misses++;
+        stats.last_overrun_us = overrun;
+        if (overrun > stats.worst_overrun_us)
+            stats.worst_overrun_us = overrun;
+        fprintf(stderr, "watchdog: control loop overrun of %llu us\n",
+                (unsigned long long)overrun);
+    }
+    was_tripped = tripped;
+    tripped = 0;
+    missed = 0;
+    deadline_us = now + period + WATCHDOG_SLACK;
+    pthread_mutex_unlock(&lock);
+
+    return was_tripped;
+}
+
+void watchdog_expect(unsigned int extra_us)
+{
+    uint64_t deadline = now_us() + extra_us + WATCHDOG_SLACK;
+
+    lock_acquire();
+    if (deadline > deadline_us)
+        deadline_us = deadline;
+    pthread_mutex_unlock(&lock);
+}
+
+void watchdog_get_stats(struct watchdog_stats *out)
+{
+    lock_acquire();
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+void watchdog_print_stats(FILE *out)
+{
+    struct watchdog_stats s;
+    watchdog_get_stats(&s);
+
+    fprintf(out, "Loop metrics: %llu iterations, %llu missed deadlines "
+            "(%llu stopped the motors), worst overrun %llu us\n",
+            (unsigned long long)s.kicks, (unsigned long long)s.misses,
+            (unsigned long long)s.trips,
+            (unsigned long long)s.worst_overrun_us);
+}
+
+int watchdog_export(const char *path)
+{
+    struct watchdog_stats s;
+    char tmp_path[256];
+    FILE *fp;
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fp = fopen(tmp_path, "w");
+    if (!fp)
+        return -1;
+
+    watchdog_get_stats(&s);
+    fprintf(fp, "loop_iterations=%llu\n", (unsigned long long)s.kicks);
+    fprintf(fp, "missed_deadlines=%llu\n", (unsigned long long)s.misses);
+    fprintf(fp, "watchdog_trips=%llu\n", (unsigned long long)s.trips);
+    fprintf(fp, "worst_overrun_us=%llu\n", (unsigned long long)s.worst_overrun_us);
+    fprintf(fp, "last_overrun_us=%llu\n", (unsigned long long)s.last_overrun_us);
+
+    if (fclose(fp) != 0)
+        return -1;
+    return rename(tmp_path, path);
+}
+
+void watchdog_stop(void)
+{
+    if (!atomic_exchange(&running, 0))
+        return;
+    pthread_join(watchdog_thread, NULL);
+    hw_close();
+    close(timer_fd);
+    timer_fd = -1;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file watchdog.h
+ * @brief Deadline monitor for the real-time control loop.
+ * @details
+ * The control loop registers its period and calls watchdog_kick() once
+ * per iteration. A higher priority watchdog thread wakes from a timerfd
+ * every WATCHDOG_CHECK_PERIOD and, if the loop has missed its deadline,
+ * stops the motors and logs the miss. The overrun is measured when the
+ * loop finally kicks again. Miss counts and the worst overrun are kept
+ * as loop metrics.
+ *
+ * If WATCHDOG_DEV is defined (e.g., -DWATCHDOG_DEV=\"/dev/watchdog\"),
+ * the thread also feeds that device while the loop is healthy, so a hard
+ * stall of the whole process resets the board. Any writable file or FIFO
+ * can stand in for the device when testing off target.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define WATCHDOG_PRIORITY      90       // Above the control and ranging threads
+#define WATCHDOG_CHECK_PERIOD  10000    // Heartbeat check period (us)
+#define WATCHDOG_SLACK         50000    // Allowed lateness before a miss (us)
+#define WATCHDOG_FEED_PERIOD   1000000  // Hardware watchdog feed period (us)
+
+#ifndef WATCHDOG_STATS_PATH
+#define WATCHDOG_STATS_PATH "/tmp/whiteboard_wiper.loop"
+#endif // WATCHDOG_STATS_PATH
+
+/**
+ * @brief Control loop metrics collected by the watchdog.
+ */
+struct watchdog_stats {
+    uint64_t kicks;             ///< Heartbeats received
+    uint64_t misses;            ///< Deadlines missed
+    uint64_t trips;             ///< Misses that stopped the motors
+    uint64_t worst_overrun_us;  ///< Longest time past a deadline
+    uint64_t last_overrun_us;   ///< Most recent time past a deadline
+};
+
+/**
+ * @brief Start the watchdog thread.
+ *
+ * The first deadline is period_us + WATCHDOG_SLACK from now.
+ *
+ * @param period_us Expected time between two watchdog_kick() calls.
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int watchdog_start(unsigned int period_us);
+
+/**
+ * @brief Change the registered loop period.
+ *
+ * Takes effect from the next watchdog_kick().
+ *
+ * @param period_us New expected time between two kicks.
+ */
+void watchdog_set_period(unsigned int period_us);
+
+/**
+ * @brief Signal that the control loop completed an iteration.
+ *
+ * @return 1 if the watchdog stopped the motors since the last kick and
+ *         the caller must restore the motor state, 0 otherwise.
+ */
+int watchdog_kick(void);
+
+/**
+ * @brief Allow extra time before the next deadline.
+ *
+ * Use before a known long step (e.g., a turnaround maneuver); the next
+ * deadline becomes now + extra_us + WATCHDOG_SLACK.
+ *
+ * @param extra_us Time the next step is expected to take.
+ */
+void watchdog_expect(unsigned int extra_us);
+
+/**
+ * @brief Copy the current loop metrics.
+ *
+ * @param[out] stats Filled with the metrics at the time of the call.
+ */
+void watchdog_get_stats(struct watchdog_stats *stats);
+
+/**
+ * @brief Print the loop metrics.
+ *
+ * @param out Stream to print to (e.g., stdout).
+ */
+void watchdog_print_stats(FILE *out);
+
+/**
+ * @brief Export the loop metrics as key=value lines.
+ *
+ * @param path Destination file (e.g., WATCHDOG_STATS_PATH).
+ * @return 0 on success, -1 on failure (errno set).
+ */
+int watchdog_export(const char *path);
+
+/**
+ * @brief Stop and join the watchdog thread.
+ *
+ * Performs a magic close on the hardware watchdog, if one is fed.
+ */
+void watchdog_stop(void);
+
+#endif // WATCHDOG_H
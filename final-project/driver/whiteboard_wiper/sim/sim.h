@@ -0,0 +1,35 @@
+/**
+ * @file sim.h
+ * @brief Host simulator for the whiteboard wiper hardware.
+ * @details
+ * Replaces motor.c and hcsr04.c when building for the host (WIPER_SIM).
+ * A one dimensional model of the robot drives across a whiteboard of
+ * SIM_BOARD_WIDTH: the motor functions change the drive state, and the
+ * position and heading are integrated from the elapsed wall time. The
+ * simulated HC-SR04 reports SIM_WALL_DIST while the sensor is over the
+ * board and SIM_EDGE_DIST once it passes an edge, and takes as long as a
+ * real echo would. This is enough to run the unmodified control loop for
+ * debugging and for collecting PGO profiles.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#define SIM_BOARD_WIDTH   1.20   // Width of the whiteboard (m)
+#define SIM_SENSOR_OFFSET 0.10   // Sensor ahead of the wheel axle (m)
+#define SIM_WALL_DIST     0.08   // Sensor reading over the board (m)
+#define SIM_EDGE_DIST     0.60   // Sensor reading past an edge (m)
+#define SIM_NOISE         0.002  // Peak reading noise (m)
+#define SIM_SPEED         0.15   // Straight line speed (m/s)
+#define SIM_TURN_TIME     1.0    // Time for a 180 degree turn (s)
+#define SIM_SOUND_SPEED   343.0  // Speed of sound (m/s)
+
+/**
+ * @brief Position of the sensor across the board.
+ *
+ * @return Distance of the sensor from the left edge in meters; values
+ *         outside [0, SIM_BOARD_WIDTH] are past an edge.
+ */
+double sim_sensor_position(void);
+
+#endif // SIM_H
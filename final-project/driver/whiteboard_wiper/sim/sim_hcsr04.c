@@ -0,0 +1,40 @@
+/**
+ * @file sim_hcsr04.c
+ * @brief Simulated HC-SR04 sensor implementing hcsr04.h.
+ */
+
+#include "../inc/hcsr04.h"
+#include "../inc/power.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned int seed;
+
+int init_hcsr04(void)
+{
+    seed = (unsigned int)time(NULL);
+    return 0;
+}
+
+int read_hcsr04(uint32_t *echo_time_us, float *distance_m)
+{
+    double x = sim_sensor_position();
+    double d = (x < 0.0 || x > SIM_BOARD_WIDTH) ? SIM_EDGE_DIST : SIM_WALL_DIST;
+
+    d += SIM_NOISE * (2.0 * rand_r(&seed) / RAND_MAX - 1.0);
+
+    // A real read blocks for the round trip of the echo
+    uint32_t us = (uint32_t)(2.0 * d / SIM_SOUND_SPEED * 1e6);
+    usleep(us);
+    power_sensor_ping();
+
+    *echo_time_us = us;
+    *distance_m = (float)d;
+    return 0;
+}
+
+void deinit_hcsr04(void)
+{
+}
@@ -0,0 +1,123 @@
+/**
+ * @file sim_motor.c
+ * @brief Simulated motor driver implementing motor.h.
+ * @details
+ * The motor functions may be called from the control loop and from the
+ * watchdog thread, and the sensor reads the position from the ranging
+ * thread, so the robot state is protected by a mutex.
+ */
+
+#include "../inc/motor.h"
+#include "../inc/power.h"
+#include "sim.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static enum motor_state drive = MOTOR_STOPPED;
+static double position = SIM_BOARD_WIDTH / 2;   // Axle position (m)
+static double heading = 0.0;                    // 0 faces the right edge (rad)
+static double last_update;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Advance the model to the current time, lock must be held
+static void integrate(void)
+{
+    double now = now_s();
+    double dt = now - last_update;
+    last_update = now;
+
+    switch (drive) {
+    case MOTOR_FORWARD:
+        position += SIM_SPEED * cos(heading) * dt;
+        break;
+    case MOTOR_BACKWARD:
+        position -= SIM_SPEED * cos(heading) * dt;
+        break;
+    case MOTOR_TURN_CW:
+        heading += M_PI / SIM_TURN_TIME * dt;
+        break;
+    case MOTOR_TURN_CCW:
+        heading -= M_PI / SIM_TURN_TIME * dt;
+        break;
+    case MOTOR_STOPPED:
+        break;
+    }
+}
+
+static void set_drive(enum motor_state d)
+{
+    pthread_mutex_lock(&lock);
+    integrate();
+    drive = d;
+    pthread_mutex_unlock(&lock);
+    power_motor_set(d != MOTOR_STOPPED);
+}
+
+double sim_sensor_position(void)
+{
+    double x;
+
+    pthread_mutex_lock(&lock);
+    integrate();
+    x = position + SIM_SENSOR_OFFSET * cos(heading);
+    pthread_mutex_unlock(&lock);
+    return x;
+}
+
+int motor_init(void)
+{
+    pthread_mutex_lock(&lock);
+    last_update = now_s();
+    pthread_mutex_unlock(&lock);
+    printf("sim: motors on a %.2f m board\n", SIM_BOARD_WIDTH);
+    return 0;
+}
+
+void motor_forward_start(void)
+{
+    set_drive(MOTOR_FORWARD);
+}
+
+void motor_stop(void)
+{
+    set_drive(MOTOR_STOPPED);
+}
+
+void motor_backward_start(void)
+{
+    set_drive(MOTOR_BACKWARD);
+}
+
+void motor_turn_cw_start(void)
+{
+    set_drive(MOTOR_TURN_CW);
+}
+
+void motor_turn_ccw_start(void)
+{
+    set_drive(MOTOR_TURN_CCW);
+}
+
+enum motor_state motor_get_state(void)
+{
+    enum motor_state d;
+
+    pthread_mutex_lock(&lock);
+    d = drive;
+    pthread_mutex_unlock(&lock);
+    return d;
+}
+
+void motor_deinit(void)
+{
+    set_drive(MOTOR_STOPPED);
+}
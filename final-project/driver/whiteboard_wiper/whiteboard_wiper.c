@@ -10,7 +10,16 @@
  *  - Monitors distance to the wall
  *  - If deviation beyond a threshold is detected, stops, reverses,
  *    turns around, and resumes forward motion
+ *  - Drops into a low-power idle mode while the sensor is covered or the
+ *    robot is parked (SIGUSR1 toggles parking)
  *  - Responds to SIGINT (Ctrl+C) to cleanly exit the loop and deinitialize
+ *  - Kicks a watchdog thread every iteration; if the loop (or the sensor
+ *    feeding it) stalls past its deadline the watchdog stops the motors
+ *  - Publishes its state every iteration to the telemetry server
+ *  - Picks up tuning parameter changes (control socket or parameter
+ *    file) at the top of each iteration
+ * Distance samples come from the ranging thread; the loop blocks waiting
+ * for each sample instead of polling the sensor itself.
  */
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
@@ -21,16 +30,81 @@
 #include <unistd.h>
 #include <math.h>
 #include <signal.h>
+#include <time.h>
 #include "whiteboard_wiper.h"
 
 static volatile sig_atomic_t keep_running = 1;
 
+static volatile sig_atomic_t parked = 0;
+static int idle = 0;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
 static void handle_sigint(int sig)
 {
     (void)sig;            // unused
     keep_running = 0;
 }
 
+static void handle_sigusr1(int sig)
+{
+    (void)sig;            // unused
+    parked = !parked;
+}
+
+/**
+ * @brief Enter or leave low-power idle mode.
+ *
+ * The robot idles while it is parked or the sensor has been covered for
+ * idle_samples consecutive samples, and resumes once it is unparked and
+ * the sensor has been clear for idle_samples samples. While idle the
+ * motors are off and the ranging thread pings at RANGING_IDLE_PERIOD.
+ *
+ * @param prm    Parameters for this iteration.
+ * @param sample Newest sample, or NULL if none arrived (timeout).
+ * @return Non-zero while the robot is idle.
+ */
+static int update_idle(const struct wiper_params *prm, const struct ranging_sample *sample)
+{
+    static int covered = 0;
+    static int uncovered = 0;
+
+    if (sample) {
+        if (sample->distance_m < prm->covered_range_m) {
+            covered++;
+            uncovered = 0;
+        } else {
+            uncovered++;
+            covered = 0;
+        }
+    }
+
+    if (!idle && (parked || covered >= (int)prm->idle_samples)) {
+        printf("Entering low-power idle\n");
+        motor_stop();
+        ranging_set_period(RANGING_IDLE_PERIOD);
+        watchdog_set_period(RANGING_IDLE_PERIOD);
+        watchdog_expect(RANGING_IDLE_PERIOD);
+        power_idle_set(1);
+        // File I/O is left to the telemetry thread
+        telemetry_request_export();
+        idle = 1;
+    } else if (idle && !parked && uncovered >= (int)prm->idle_samples) {
+        printf("Leaving low-power idle\n");
+        power_idle_set(0);
+        ranging_set_period(RANGING_ACTIVE_PERIOD);
+        watchdog_set_period(RANGING_ACTIVE_PERIOD);
+        motor_forward_start();
+        idle = 0;
+    }
+    return idle;
+}
+
 int main(void)
 {
     // Increase scheduler priority and lock to a single core
@@ -49,6 +123,12 @@ int main(void)
     if (signal(SIGINT, handle_sigint) == SIG_ERR) {
         perror("signal");
     }
+    // Register with SIGUSR1 to park/unpark the robot
+    if (signal(SIGUSR1, handle_sigusr1) == SIG_ERR) {
+        perror("signal");
+    }
+
+    power_init();
 
     printf("Start init procedure...\n");
     // Init motor
@@ -90,21 +170,92 @@ int main(void)
     wall_dist_m = wall_dist_m / CAL_CYCLES;
     printf("Calibrated wall distance = %6.1f cm\n", dist_m * 100.0f);
 
-    // Start control loop
+    // Load the tuning parameters, then start ranging thread and control loop
+    const struct wiper_params defaults = {
+        .wall_range_m = WALL_RANGE,
+        .reverse_time_us = REVERSE_TIME,
+        .turnaround_time_us = TURNAROUND_TIME,
+        .covered_range_m = COVERED_RANGE,
+        .idle_samples = IDLE_SAMPLES,
+        .filter_alpha = FILTER_ALPHA,
+    };
+    if (params_start(&defaults, PARAMS_FILE_PATH, PARAMS_SOCKET_PATH) != 0) {
+        perror("params_start");
+        goto cal_fail;
+    }
+    const struct wiper_params *prm = params_acquire();
+    params_print(stdout);
+    if (ranging_start(RANGING_ACTIVE_PERIOD) != 0) {
+        perror("ranging_start");
+        params_stop();
+        goto cal_fail;
+    }
+    if (watchdog_start(RANGING_ACTIVE_PERIOD) != 0) {
+        perror("watchdog_start");
+        ranging_stop();
+        params_stop();
+        goto cal_fail;
+    }
+    // Telemetry is optional, keep wiping without it
+    if (telemetry_start(TELEMETRY_SOCKET_PATH) != 0) {
+        perror("telemetry_start");
+    }
     motor_forward_start();
 
+    struct ranging_sample sample;
+    struct telemetry_state *tm;
+    float filtered_m = wall_dist_m;
+    uint32_t passes = 0;
+    uint64_t last_loop_us = now_us();
     while(keep_running){
-        printf("Reading distance...\n");
-        if(read_hcsr04(&echo_time, &dist_m) != 0){
+        // Parameter updates take effect here, never mid-iteration
+        prm = params_acquire();
+
+        // Block until the ranging thread publishes a new sample. Only a
+        // fresh sample counts as a heartbeat, so a hung sensor trips the
+        // watchdog even though this loop keeps running.
+        if(ranging_wait(&sample, SAMPLE_TIMEOUT_MS) != 0){
+            update_idle(prm, NULL);
+            continue;
+        }
+        if(sample.status != 0){
             goto cleanup;
         }
-        if(fabs(dist_m - wall_dist_m) > WALL_RANGE){
+
+        uint64_t loop_us = now_us();
+        telemetry_record_loop(loop_us - last_loop_us, loop_us - sample.timestamp_us);
+        last_loop_us = loop_us;
+        filtered_m += prm->filter_alpha * (sample.distance_m - filtered_m);
+        tm = telemetry_back();
+        tm->timestamp_us = sample.timestamp_us;
+        tm->echo_time_us = sample.echo_time_us;
+        tm->range_m = sample.distance_m;
+        tm->filtered_range_m = filtered_m;
+        tm->wall_dist_m = wall_dist_m;
+        tm->passes = passes;
+        tm->idle = idle;
+        telemetry_publish();
+
+        if(update_idle(prm, &sample)){
+            watchdog_kick();
+            continue;
+        }
+        if(watchdog_kick()){
+            // The watchdog stopped the motors during a stall
+            printf("Recovered from stall, resuming\n");
+            motor_forward_start();
+        }
+        if(fabs(sample.distance_m - wall_dist_m) > prm->wall_range_m){
             // Edge of wall detected, turn around
             printf("Found edge, turning around...\n");
+            // No point pinging while maneuvering
+            ranging_pause();
+            watchdog_expect(prm->reverse_time_us + prm->turnaround_time_us +
+                            RANGING_ACTIVE_PERIOD);
             motor_stop();
             usleep(100);
             motor_backward_start();
-            usleep(REVERSE_TIME); // 100 ms
+            usleep(prm->reverse_time_us); // 100 ms
             if (!keep_running) {
                 // Interrupted during motor control loop
                 goto cleanup;
@@ -112,7 +263,7 @@ int main(void)
             motor_stop();
             usleep(100);
             motor_turn_cw_start();
-            usleep(TURNAROUND_TIME); // 100 ms
+            usleep(prm->turnaround_time_us); // 100 ms
             if (!keep_running) {
                 // Interrupted during motor control loop
                 goto cleanup;
@@ -120,17 +271,27 @@ int main(void)
             motor_stop();
             usleep(100);
             motor_forward_start();
-        }
-        usleep(100000);            // 100 ms
-        if (!keep_running) {
-            // Interrupted during motor control loop
-            goto cleanup;
+            ranging_resume();
+            passes++;
+            // Don't count the maneuver as one long loop period
+            last_loop_us = now_us();
         }
     }
 
     cleanup:
     printf("Cleaning up\n");
+    telemetry_stop();
+    watchdog_stop();
     motor_stop();
+    ranging_stop();
+    if (idle) {
+        power_idle_set(0);
+    }
+    power_print_report(stdout);
+    power_export(POWER_REPORT_PATH);
+    watchdog_print_stats(stdout);
+    watchdog_export(WATCHDOG_STATS_PATH);
+    params_stop();
     deinit_hcsr04();
     motor_deinit();
     printf("Done.\n");
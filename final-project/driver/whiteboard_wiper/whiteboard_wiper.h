@@ -6,14 +6,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "inc/gpiod.h"
 #include "inc/motor.h"
 #include "inc/hcsr04.h"
+#include "inc/power.h"
+#include "inc/ranging.h"
+#include "inc/watchdog.h"
+#include "inc/telemetry.h"
+#include "inc/params.h"
 
 #define CAL_CYCLES 10
+#define SAMPLE_TIMEOUT_MS 500   // Max wait for a sample before rechecking flags
+
+// Defaults for the runtime tunable parameters (see inc/params.h)
 #define WALL_RANGE 0.05
 #define TURNAROUND_TIME 1000000
 #define REVERSE_TIME 1000000
+#define COVERED_RANGE 0.03      // Closer than this the sensor is covered (m)
+#define IDLE_SAMPLES 5          // Consecutive samples to enter/leave idle
+#define FILTER_ALPHA 0.3f       // Weight of a new sample in the filtered range
 
 
 #endif // WHITEBOARD_WIPER_H
\ No newline at end of file
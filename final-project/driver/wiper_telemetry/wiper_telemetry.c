@@ -0,0 +1,165 @@
+/**
+ * @file wiper_telemetry.c
+ * @brief Command line client for the whiteboard wiper telemetry server.
+ * @author Matt Hartnett
+ * @details
+ * Connects to the telemetry socket, requests a stream at the given rate
+ * and prints each frame. In binary mode frames are decoded into one line
+ * of text each (or the raw frames are copied to stdout with -R, for
+ * logging); in JSON mode the server's JSON lines are passed through
+ * unchanged. SIGINT stops the stream and prints how many frames arrived.
+ *
+ * Usage: wiper_telemetry [-j] [-R] [-H] [-r rate] [-n count] [socket]
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../whiteboard_wiper/inc/telemetry.h"
+
+#define DEFAULT_RATE 10
+
+static const char *const motor_names[] = {
+    "stopped", "forward", "backward", "turn_cw", "turn_ccw"
+};
+
+static volatile sig_atomic_t keep_running = 1;
+
+static void handle_sigint(int sig)
+{
+    (void)sig;            // unused
+    keep_running = 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-j] [-R] [-H] [-r rate] [-n count] [socket]\n"
+            "  -j        JSON lines instead of binary frames\n"
+            "  -R        write raw binary frames to stdout\n"
+            "  -H        also print the loop timing histograms\n"
+            "  -r rate   frames per second, 1-%d (default %d)\n"
+            "  -n count  exit after count frames\n"
+            "  socket    server socket (default %s)\n",
+            prog, TELEMETRY_MAX_RATE, DEFAULT_RATE, TELEMETRY_SOCKET_PATH);
+}
+
+static void print_hist(const char *name, const uint32_t *hist)
+{
+    printf("  %s:", name);
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS; i++) {
+        if (hist[i])
+            printf(" <%uus:%u", 2u << i, hist[i]);
+    }
+    printf("\n");
+}
+
+static void print_frame(const struct telemetry_frame *f, int hist)
+{
+    const char *motor = f->motor_state < sizeof(motor_names) / sizeof(motor_names[0]) ?
+                        motor_names[f->motor_state] : "?";
+
+    printf("%10u %6.3f s  range %6.1f cm  filt %6.1f cm  wall %6.1f cm  "
+           "%-8s %s  passes %4u  %8.1f J  missed %llu\n",
+           f->seq, f->timestamp_us / 1e6, f->range_m * 100.0f,
+           f->filtered_range_m * 100.0f, f->wall_dist_m * 100.0f,
+           motor, f->idle ? "idle" : "wipe", f->passes, f->energy_j,
+           (unsigned long long)f->missed_deadlines);
+    if (hist) {
+        print_hist("period ", f->period_hist);
+        print_hist("latency", f->latency_hist);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    const char *path = TELEMETRY_SOCKET_PATH;
+    int json = 0, raw = 0, hist = 0, opt;
+    long rate = DEFAULT_RATE, count = 0, received = 0;
+    char req[32], buf[2048];
+    int fd, ret = 1;
+
+    while ((opt = getopt(argc, argv, "jRHr:n:h")) != -1) {
+        switch (opt) {
+        case 'j': json = 1; break;
+        case 'R': raw = 1; break;
+        case 'H': hist = 1; break;
+        case 'r': rate = atol(optarg); break;
+        case 'n': count = atol(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc)
+        path = argv[optind];
+    if (rate < 1 || rate > TELEMETRY_MAX_RATE || count < 0 || strlen(path) >= sizeof(addr.sun_path)) {
+        usage(argv[0]);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Stop cleanly on Ctrl+C, recv() returns EINTR
+    struct sigaction sa = { .sa_handler = handle_sigint };
+    sigaction(SIGINT, &sa, NULL);
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(path);
+        goto out;
+    }
+    int len = snprintf(req, sizeof(req), "%c %ld\n", json ? 'j' : 'b', rate);
+    if (send(fd, req, len, MSG_NOSIGNAL) != len) {
+        perror("send");
+        goto out;
+    }
+
+    while (keep_running && (!count || received < count)) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno != EINTR)
+                perror("recv");
+            break;
+        }
+        if (n == 0) {
+            fprintf(stderr, "Server closed the connection\n");
+            break;
+        }
+
+        if (json || raw) {
+            fwrite(buf, 1, n, stdout);
+        } else {
+            const struct telemetry_frame *f = (const struct telemetry_frame *)buf;
+            if (n != sizeof(*f) || f->magic != TELEMETRY_MAGIC ||
+                f->version != TELEMETRY_VERSION) {
+                // Error strings from the server are plain text
+                fprintf(stderr, "Unexpected message: %.*s", (int)n, buf);
+                break;
+            }
+            print_frame(f, hist);
+        }
+        received++;
+        if (rate <= 100)
+            fflush(stdout);
+    }
+    ret = 0;
+    fflush(stdout);
+    if (!raw)
+        fprintf(stderr, "%ld frames received\n", received);
+
+out:
+    close(fd);
+    return ret;
+}